@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 #include "axis.h"
 #include "spline.h"
 #include "utils.h"
@@ -17,6 +18,8 @@ struct axis_def{
   bool inverted;
   splines_def curve_defs;
   splines curves;
+  spline_lut table;
+  float l_k, r_k;
   bool valid;
   float factor;
   float l_limit, r_limit;
@@ -24,6 +27,21 @@ struct axis_def{
   char *prefix;
 };
 
+//What the per-frame path needs of an axis, frozen at publish time
+struct axis_snapshot{
+  bool enabled;
+  bool inverted;
+  float l_limit, r_limit;
+  float l_k, r_k;
+  float filter_factor;
+  spline_lut table;
+};
+
+struct ltr_axes_snapshot{
+  unsigned int version;
+  struct axis_snapshot axis[TZ + 1];
+};
+
 struct ltr_axes {
   struct axis_def pitch_axis;
   struct axis_def yaw_axis;
@@ -34,6 +52,10 @@ struct ltr_axes {
   bool initialized;
   bool axes_changed_flag;
   char *section;
+  struct ltr_axes_snapshot *snapshot;
+  unsigned int version;
+  unsigned int epoch;
+  unsigned int readers[2];
 };
 
 char *def_section[][2] = {
@@ -193,16 +215,79 @@ bool ltr_int_get_axes_ff(ltr_axes_t axes, double ffs[])
 }
 */
 
-float ltr_int_filter_axis(ltr_axes_t axes, enum axis_t id, float x, float *y_minus_1)
+//Folds the curve, sensitivity and limits into the lookup table;
+//  called under axes_mutex whenever the axis got invalidated.
+static void compile_axis(struct axis_def *axis)
 {
-  pthread_mutex_lock(&axes_mutex);
-  struct axis_def *axis = get_axis(axes, id);
-  if(!axis->enabled){
-    pthread_mutex_unlock(&axes_mutex);
+  ltr_int_curve2pts(&(axis->curve_defs), &(axis->curves));
+  ltr_int_spline_lut(&(axis->curves), &(axis->table));
+  axis->l_k = (axis->l_limit < 1e-5) ? 0.0f : axis->factor / axis->l_limit;
+  axis->r_k = (axis->r_limit < 1e-5) ? 0.0f : axis->factor / axis->r_limit;
+  axis->valid = true;
+}
+
+//Readers don't lock; they announce themselves in readers[epoch] instead.
+//  The writer swaps the pointer, then flips the epoch twice and waits for
+//  each of the two counters to drain before the old snapshot goes away.
+static void wait_for_readers(ltr_axes_t axes)
+{
+  int i;
+  for(i = 0; i < 2; ++i){
+    unsigned int old = __atomic_load_n(&(axes->epoch), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(axes->epoch), old ^ 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&(axes->readers[old]), __ATOMIC_SEQ_CST) != 0){
+      sched_yield();
+    }
+  }
+}
+
+//Called under axes_mutex after any change of the axes
+static void publish_snapshot(ltr_axes_t axes)
+{
+  struct ltr_axes_snapshot *snap = ltr_int_my_malloc(sizeof(struct ltr_axes_snapshot));
+  int id;
+  for(id = PITCH; id <= TZ; ++id){
+    struct axis_def *axis = get_axis(axes, id);
+    struct axis_snapshot *dst = &(snap->axis[id]);
+    if(!(axis->valid)){
+      compile_axis(axis);
+    }
+    dst->enabled = axis->enabled;
+    dst->inverted = axis->inverted;
+    dst->l_limit = axis->l_limit;
+    dst->r_limit = axis->r_limit;
+    dst->l_k = axis->l_k;
+    dst->r_k = axis->r_k;
+    dst->filter_factor = axis->filter_factor;
+    dst->table = axis->table;
+  }
+  snap->version = ++(axes->version);
+  struct ltr_axes_snapshot *old =
+    __atomic_exchange_n(&(axes->snapshot), snap, __ATOMIC_SEQ_CST);
+  if(old != NULL){
+    wait_for_readers(axes);
+    free(old);
+  }
+}
+
+ltr_axes_snapshot_t ltr_int_axes_snapshot_get(ltr_axes_t axes, unsigned int *ticket)
+{
+  *ticket = __atomic_load_n(&(axes->epoch), __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&(axes->readers[*ticket]), 1, __ATOMIC_SEQ_CST);
+  return __atomic_load_n(&(axes->snapshot), __ATOMIC_SEQ_CST);
+}
+
+void ltr_int_axes_snapshot_put(ltr_axes_t axes, unsigned int ticket)
+{
+  __atomic_sub_fetch(&(axes->readers[ticket]), 1, __ATOMIC_RELEASE);
+}
+
+float ltr_int_snapshot_filter_axis(ltr_axes_snapshot_t snap, enum axis_t id, float x, float *y_minus_1)
+{
+  if((snap == NULL) || !snap->axis[id].enabled){
     return 0.0f;
   }
-  
-  pthread_mutex_unlock(&axes_mutex);
+  const struct axis_snapshot *axis = &(snap->axis[id]);
   float trans_koef;
   switch(id){
 //    case TX:
@@ -218,43 +303,51 @@ float ltr_int_filter_axis(ltr_axes_t axes, enum axis_t id, float x, float *y_min
   return *y_minus_1 = ltr_int_nonlinfilt(x, *y_minus_1, ff);
 }
 
-float ltr_int_val_on_axis(ltr_axes_t axes, enum axis_t id, float x)
+float ltr_int_snapshot_val_on_axis(ltr_axes_snapshot_t snap, enum axis_t id, float x)
 {
-  pthread_mutex_lock(&axes_mutex);
-  struct axis_def *axis = get_axis(axes, id);
-  if(!axis->enabled){
-    pthread_mutex_unlock(&axes_mutex);
+  if((snap == NULL) || !snap->axis[id].enabled){
     return 0.0f;
   }
+  const struct axis_snapshot *axis = &(snap->axis[id]);
   if(axis->inverted){
     x = -x;
   }
-  if(!(axis->valid)){
-    ltr_int_curve2pts(&(axis->curve_defs), &(axis->curves));
-  }
-  float mf = axis->factor;
   float lim = x < 0 ? axis->l_limit : axis->r_limit;
   if(lim < 1e-5){
-    pthread_mutex_unlock(&axes_mutex);
     return 0.0;
   }
-  x *= mf; //apply factor (sensitivity)
-  x /= lim; //normalize to apply the spline
+  x *= x < 0 ? axis->l_k : axis->r_k; //apply sensitivity and normalize
   if(x < -1.0){
     x = -1.0;
   }
   if(x > 1.0){
     x = 1.0;
   }
-  float raw = ltr_int_spline_point(&(axis->curves), x) * lim;
-//  float res = ltr_int_nonlinfilt(raw, axis->last_val, axis->filter_factor);
-  pthread_mutex_unlock(&axes_mutex);
-  return raw;
+  return ltr_int_spline_lut_point(&(axis->table), x) * lim;
+}
+
+float ltr_int_filter_axis(ltr_axes_t axes, enum axis_t id, float x, float *y_minus_1)
+{
+  unsigned int ticket;
+  ltr_axes_snapshot_t snap = ltr_int_axes_snapshot_get(axes, &ticket);
+  float res = ltr_int_snapshot_filter_axis(snap, id, x, y_minus_1);
+  ltr_int_axes_snapshot_put(axes, ticket);
+  return res;
+}
+
+float ltr_int_val_on_axis(ltr_axes_t axes, enum axis_t id, float x)
+{
+  unsigned int ticket;
+  ltr_axes_snapshot_t snap = ltr_int_axes_snapshot_get(axes, &ticket);
+  float res = ltr_int_snapshot_val_on_axis(snap, id, x);
+  ltr_int_axes_snapshot_put(axes, ticket);
+  return res;
 }
 
 static void signal_change(ltr_axes_t axes)
 {
   axes->axes_changed_flag = true;
+  publish_snapshot(axes);
 }
 
 static bool save_val_flt(ltr_axes_t axes, enum axis_t id, axis_fields field, float val)
@@ -643,6 +736,10 @@ void ltr_int_init_axes(ltr_axes_t *axes, const char *profile)
   pthread_mutex_lock(&axes_mutex);
   bool res = true;
   (*axes)->axes_changed_flag = false;
+  (*axes)->snapshot = NULL;
+  (*axes)->version = 0;
+  (*axes)->epoch = 0;
+  (*axes)->readers[0] = (*axes)->readers[1] = 0;
   
   char *sec_name = ltr_int_prepare_section(profile);
   if(sec_name != NULL){
@@ -656,6 +753,7 @@ void ltr_int_init_axes(ltr_axes_t *axes, const char *profile)
     (*axes)->initialized = res;
     //now the section should exist anyway...
     (*axes)->section = sec_name;
+    publish_snapshot(*axes);
   }
   pthread_mutex_unlock(&axes_mutex);
 }
@@ -677,6 +775,10 @@ void ltr_int_close_axes(ltr_axes_t *axes)
   ltr_int_close_axis(*axes, TX);
   ltr_int_close_axis(*axes, TY);
   ltr_int_close_axis(*axes, TZ);
+  struct ltr_axes_snapshot *snap =
+    __atomic_exchange_n(&((*axes)->snapshot), NULL, __ATOMIC_SEQ_CST);
+  wait_for_readers(*axes);
+  free(snap);
   free((*axes)->section);
   free(*axes);
   *axes = NULL;
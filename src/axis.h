@@ -26,6 +26,14 @@ void ltr_int_close_axes(ltr_axes_t *axes);
 float ltr_int_val_on_axis(ltr_axes_t axes, enum axis_t id, float x);
 float ltr_int_filter_axis(ltr_axes_t axes, enum axis_t id, float x, float *y_minus_1);
 
+//Immutable copy of all six axes, republished whenever a parameter changes.
+//  Reading it takes no lock; keep it only between get and put.
+typedef const struct ltr_axes_snapshot *ltr_axes_snapshot_t;
+ltr_axes_snapshot_t ltr_int_axes_snapshot_get(ltr_axes_t axes, unsigned int *ticket);
+void ltr_int_axes_snapshot_put(ltr_axes_t axes, unsigned int ticket);
+float ltr_int_snapshot_val_on_axis(ltr_axes_snapshot_t snap, enum axis_t id, float x);
+float ltr_int_snapshot_filter_axis(ltr_axes_snapshot_t snap, enum axis_t id, float x, float *y_minus_1);
+
 bool ltr_int_is_symetrical(ltr_axes_t axes, enum axis_t id);
 
 bool ltr_int_set_axis_param(ltr_axes_t axes, enum axis_t id, enum axis_param_t param, float val);
@@ -0,0 +1,133 @@
+#include <string.h>
+#include "blob_track.h"
+
+// Blobs further than this from a prediction never match it (pixels)
+#define MIN_GATE 8.0f
+
+void ltr_int_blob_track_reset(blob_tracker_t *t)
+{
+  memset(t, 0, sizeof(blob_tracker_t));
+}
+
+void ltr_int_blob_track_lock(blob_tracker_t *t, const struct blob_type leds[3])
+{
+  int i;
+  for(i = 0; i < 3; ++i){
+    t->x[i] = leds[i].x;
+    t->y[i] = leds[i].y;
+    t->vx[i] = t->vy[i] = 0.0f;
+    t->missing[i] = 0;
+  }
+  t->locked = true;
+}
+
+static float dist2(float x1, float y1, float x2, float y2)
+{
+  return (x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2);
+}
+
+bool ltr_int_blob_track_match(blob_tracker_t *t, struct bloblist_type *bl)
+{
+  float px[3], py[3];
+  int i;
+  if(!t->locked){
+    return false;
+  }
+  for(i = 0; i < 3; ++i){
+    px[i] = t->x[i] + t->vx[i];
+    py[i] = t->y[i] + t->vy[i];
+  }
+  // half the closest LED spacing keeps neighbours from swapping
+  float gate2 = dist2(px[0], py[0], px[1], py[1]);
+  float d = dist2(px[0], py[0], px[2], py[2]);
+  gate2 = (d < gate2) ? d : gate2;
+  d = dist2(px[1], py[1], px[2], py[2]);
+  gate2 = (d < gate2) ? d : gate2;
+  gate2 *= 0.25f;
+  if(gate2 < MIN_GATE * MIN_GATE){
+    gate2 = MIN_GATE * MIN_GATE;
+  }
+
+  // exhaustive assignment; -1 means the LED wasn't seen, costing a full gate
+  int n = (bl->num_blobs < MAX_BLOBS) ? (int)bl->num_blobs : MAX_BLOBS;
+  float cost[3][MAX_BLOBS];
+  int j;
+  for(i = 0; i < 3; ++i){
+    for(j = 0; j < n; ++j){
+      cost[i][j] = dist2(px[i], py[i], bl->blobs[j].x, bl->blobs[j].y);
+    }
+  }
+  int best[3] = {-1, -1, -1};
+  float best_cost = 3.0f * gate2;
+  int a, b, c;
+  for(a = -1; a < n; ++a){
+    float ca = (a < 0) ? gate2 : cost[0][a];
+    if(ca > gate2){
+      continue;
+    }
+    for(b = -1; b < n; ++b){
+      float cb = (b < 0) ? gate2 : cost[1][b];
+      if((cb > gate2) || ((b >= 0) && (b == a))){
+        continue;
+      }
+      for(c = -1; c < n; ++c){
+        float cc = (c < 0) ? gate2 : cost[2][c];
+        if((cc > gate2) || ((c >= 0) && ((c == a) || (c == b)))){
+          continue;
+        }
+        if(ca + cb + cc < best_cost){
+          best_cost = ca + cb + cc;
+          best[0] = a;
+          best[1] = b;
+          best[2] = c;
+        }
+      }
+    }
+  }
+
+  int matched = 0;
+  float cx = 0.0f, cy = 0.0f;
+  for(i = 0; i < 3; ++i){
+    if(best[i] >= 0){
+      ++matched;
+      cx += bl->blobs[best[i]].x - px[i];
+      cy += bl->blobs[best[i]].y - py[i];
+    }
+  }
+  if(matched < 2){
+    for(i = 0; i < 3; ++i){
+      t->x[i] = px[i];
+      t->y[i] = py[i];
+      if(++(t->missing[i]) > BLOB_TRACK_COAST){
+        t->locked = false;
+      }
+    }
+    return false;
+  }
+  cx /= matched;
+  cy /= matched;
+
+  struct blob_type out[3];
+  for(i = 0; i < 3; ++i){
+    if(best[i] >= 0){
+      out[i] = bl->blobs[best[i]];
+      t->missing[i] = 0;
+    }else{
+      // unseen LED follows the ones we see
+      out[i].x = px[i] + cx;
+      out[i].y = py[i] + cy;
+      out[i].score = 0;
+      if(++(t->missing[i]) > BLOB_TRACK_COAST){
+        t->locked = false;
+        return false;
+      }
+    }
+    t->vx[i] = out[i].x - t->x[i];
+    t->vy[i] = out[i].y - t->y[i];
+    t->x[i] = out[i].x;
+    t->y[i] = out[i].y;
+  }
+  memcpy(bl->blobs, out, sizeof(out));
+  bl->num_blobs = 3;
+  return true;
+}
@@ -0,0 +1,37 @@
+#ifndef BLOB_TRACK__H
+#define BLOB_TRACK__H
+
+#include <stdbool.h>
+#include "cal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// How many frames an LED may stay unseen before the lock is dropped
+#define BLOB_TRACK_COAST 5
+
+// Keeps the identity of the three model LEDs from frame to frame. Each LED
+//   is predicted with constant velocity and the detected blobs are assigned
+//   to the predictions at the lowest total cost; LEDs that went missing are
+//   carried on their predicted track for a few frames.
+typedef struct {
+  bool locked;
+  float x[3], y[3];   // last position of each LED
+  float vx[3], vy[3]; // motion per frame
+  unsigned int missing[3];
+} blob_tracker_t;
+
+void ltr_int_blob_track_reset(blob_tracker_t *t);
+// Starts tracking from three blobs already in model order
+void ltr_int_blob_track_lock(blob_tracker_t *t, const struct blob_type leds[3]);
+// Assigns the blobs to the tracked LEDs. On success the list holds exactly
+//   the three LEDs in model order, unseen ones at their predicted position.
+//   Fails (leaving the list alone) when fewer than two LEDs can be matched.
+bool ltr_int_blob_track_match(blob_tracker_t *t, struct bloblist_type *bl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
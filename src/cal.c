@@ -75,6 +75,9 @@ int ltr_int_cal_run(struct camera_control_block *ccb, frame_callback_fun cbk)
     case mac_ps3eye_ft:
       libname = "libp3eft";
       break;
+    case replay:
+      libname = "libreplay";
+      break;
     default:
       assert(0);
       break;
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include "linuxtrack.h"
 #include "ltlib_int.h"
+#include "stripe_stream.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,8 +41,12 @@ struct frame_type {
   unsigned int width;
   unsigned int height;
   unsigned int counter;
-  int usec; /* save a precise timestamp at frame capture time for later pose extrapolation */
+  int64_t usec; /* capture time (ltr_int_get_ts() scale) for later pose extrapolation */
   unsigned char *bitmap; /* 8bits per pixel, monochrome 0x00 or 0xff */
+  bool want_runs; /* set by the frame callback to get runs with later frames */
+  bool runs_truncated;
+  unsigned int num_runs;
+  const ltr_stripe_run_t *runs; /* lit pixel runs the detector found */
 };
 
 typedef enum cal_device_category_type {
@@ -55,7 +60,8 @@ typedef enum cal_device_category_type {
   mac_webcam_ft,
   joystick,
   mac_ps3eye,
-  mac_ps3eye_ft
+  mac_ps3eye_ft,
+  replay
 } cal_device_category_type;
 
 struct cal_device_type {
@@ -0,0 +1,332 @@
+#include "frame_channel.h"
+#include "ipc_utils.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FRAME_CHANNEL_MAGIC 0x4c545246 // "LTRF"
+#define FRAME_READ_ATTEMPTS 4
+
+uint32_t ltr_int_frame_channel_clock(void) {
+  return (uint32_t)(ltr_int_get_ts() / 1000);
+}
+
+static size_t channel_size(uint32_t capacity) {
+  return sizeof(frame_channel_t) + (size_t)FRAME_CHANNEL_BUFFERS * capacity;
+}
+
+static uint8_t *buffer_data(frame_channel_t *ch, uint32_t index,
+                            uint32_t capacity) {
+  return (uint8_t *)ch + sizeof(frame_channel_t) + (size_t)index * capacity;
+}
+
+// Heartbeats from another process may be a bit ahead of our clock
+static bool recent(uint32_t now, uint32_t then) {
+  return (int32_t)(now - then) < FRAME_CHANNEL_IDLE;
+}
+
+void ltr_int_frame_writer_init(frame_writer_t *w, const char *fname) {
+  memset(w, 0, sizeof(frame_writer_t));
+  w->fname = (fname != NULL) ? ltr_int_my_strdup(fname)
+                             : ltr_int_get_default_file_name("frames.dat");
+  w->fd = -1;
+  w->writing = -1;
+  w->demand = ltr_int_frame_channel_clock() - FRAME_CHANNEL_IDLE;
+}
+
+void ltr_int_frame_writer_demand(frame_writer_t *w) {
+  __atomic_store_n(&(w->demand), ltr_int_frame_channel_clock(),
+                   __ATOMIC_RELAXED);
+}
+
+bool ltr_int_frame_writer_wanted(frame_writer_t *w) {
+  uint32_t now = ltr_int_frame_channel_clock();
+  if (recent(now, __atomic_load_n(&(w->demand), __ATOMIC_RELAXED))) {
+    return true;
+  }
+  frame_channel_t *ch = w->ch;
+  if (ch == NULL) {
+    return false;
+  }
+  if (recent(now, __atomic_load_n(&(ch->heartbeat), __ATOMIC_RELAXED))) {
+    return true;
+  }
+  if (__atomic_load_n(&(ch->active), __ATOMIC_RELAXED)) {
+    ltr_int_log_message("No frame viewers left, not publishing frames.\n");
+    // the last frame would be stale once publishing resumes
+    __atomic_store_n(&(ch->latest), FRAME_CHANNEL_NONE, __ATOMIC_RELEASE);
+    __atomic_store_n(&(ch->active), 0, __ATOMIC_RELEASE);
+  }
+  return false;
+}
+
+// Makes room for frames of the given size. The file only ever grows, as
+//   viewers may still have the old size mapped.
+static bool writer_reserve(frame_writer_t *w, uint32_t capacity) {
+  if ((w->ch != NULL) && (w->ch->capacity >= capacity)) {
+    return true;
+  }
+  if (w->fd < 0) {
+    if (w->fname == NULL) {
+      return false;
+    }
+    umask(S_IWGRP | S_IWOTH);
+    w->fd = open(w->fname, O_RDWR | O_CREAT | O_NOFOLLOW, 0700);
+    if (w->fd < 0) {
+      ltr_int_my_perror("open: ");
+      return false;
+    }
+  }
+  int i;
+  bool fresh = (w->ch == NULL);
+  if (!fresh) {
+    // copies in flight see the counters move and retry
+    __atomic_store_n(&(w->ch->latest), FRAME_CHANNEL_NONE, __ATOMIC_RELEASE);
+    for (i = 0; i < FRAME_CHANNEL_BUFFERS; ++i) {
+      ltr_int_seq_write_begin(&(w->ch->buf[i].seq));
+    }
+    munmap(w->ch, w->size);
+    w->ch = NULL;
+  }
+  size_t size = channel_size(capacity);
+  struct stat st;
+  if ((fstat(w->fd, &st) == 0) && ((size_t)st.st_size > size)) {
+    size = st.st_size;
+  } else if (ftruncate(w->fd, size) != 0) {
+    ltr_int_my_perror("ftruncate: ");
+    return false;
+  }
+  void *data =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+  if (data == MAP_FAILED) {
+    ltr_int_my_perror("mmap: ");
+    return false;
+  }
+  frame_channel_t *ch = (frame_channel_t *)data;
+  w->ch = ch;
+  w->size = size;
+  ch->capacity = (size - sizeof(frame_channel_t)) / FRAME_CHANNEL_BUFFERS;
+  if (fresh) {
+    // left over from an earlier master; a crash could leave a counter odd
+    if (ch->magic != FRAME_CHANNEL_MAGIC) {
+      ch->heartbeat = ltr_int_frame_channel_clock() - FRAME_CHANNEL_IDLE;
+    }
+    ch->latest = FRAME_CHANNEL_NONE;
+    ch->active = 0;
+    for (i = 0; i < FRAME_CHANNEL_BUFFERS; ++i) {
+      if (ch->buf[i].seq & 1) {
+        ltr_int_seq_write_end(&(ch->buf[i].seq));
+      }
+    }
+    __atomic_store_n(&(ch->magic), FRAME_CHANNEL_MAGIC, __ATOMIC_RELEASE);
+  } else {
+    for (i = 0; i < FRAME_CHANNEL_BUFFERS; ++i) {
+      ltr_int_seq_write_end(&(ch->buf[i].seq));
+    }
+  }
+  return true;
+}
+
+bool ltr_int_frame_writer_open(frame_writer_t *w, uint32_t capacity) {
+  return writer_reserve(w, capacity);
+}
+
+uint8_t *ltr_int_frame_writer_begin(frame_writer_t *w, uint32_t width,
+                                    uint32_t height) {
+  return ltr_int_frame_writer_begin_data(w, width, height, width * height);
+}
+
+uint8_t *ltr_int_frame_writer_begin_data(frame_writer_t *w, uint32_t width,
+                                         uint32_t height, uint32_t size) {
+  ltr_int_frame_writer_abort(w);
+  if (!writer_reserve(w, size)) {
+    return NULL;
+  }
+  frame_channel_t *ch = w->ch;
+  // the newest frame stays readable; the other two are written in turn
+  uint32_t latest = __atomic_load_n(&(ch->latest), __ATOMIC_RELAXED);
+  uint32_t index =
+      (latest >= FRAME_CHANNEL_BUFFERS) ? 0 : (latest + 1) % FRAME_CHANNEL_BUFFERS;
+  frame_channel_buf_t *b = &(ch->buf[index]);
+  ltr_int_seq_write_begin(&(b->seq));
+  b->width = width;
+  b->height = height;
+  b->size = size;
+  w->writing = index;
+  __atomic_store_n(&(ch->active), 1, __ATOMIC_RELEASE);
+  return buffer_data(ch, index, ch->capacity);
+}
+
+uint8_t *ltr_int_frame_writer_current(frame_writer_t *w, uint32_t *width,
+                                      uint32_t *height) {
+  if (w->writing < 0) {
+    return NULL;
+  }
+  frame_channel_buf_t *b = &(w->ch->buf[w->writing]);
+  *width = b->width;
+  *height = b->height;
+  return buffer_data(w->ch, w->writing, w->ch->capacity);
+}
+
+void ltr_int_frame_writer_publish(frame_writer_t *w, uint32_t counter) {
+  if (w->writing < 0) {
+    return;
+  }
+  frame_channel_buf_t *b = &(w->ch->buf[w->writing]);
+  b->counter = counter;
+  ltr_int_seq_write_end(&(b->seq));
+  __atomic_store_n(&(w->ch->latest), (uint32_t)w->writing, __ATOMIC_RELEASE);
+  w->writing = -1;
+}
+
+void ltr_int_frame_writer_abort(frame_writer_t *w) {
+  if (w->writing < 0) {
+    return;
+  }
+  // never the latest buffer, so nobody reads what was left in it
+  ltr_int_seq_write_end(&(w->ch->buf[w->writing].seq));
+  w->writing = -1;
+}
+
+void ltr_int_frame_writer_close(frame_writer_t *w) {
+  ltr_int_frame_writer_abort(w);
+  if (w->ch != NULL) {
+    // viewers drop their mapping of the file going away
+    __atomic_store_n(&(w->ch->active), 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&(w->ch->magic), 0, __ATOMIC_RELEASE);
+    munmap(w->ch, w->size);
+    w->ch = NULL;
+    w->size = 0;
+  }
+  if (w->fd >= 0) {
+    close(w->fd);
+    w->fd = -1;
+    unlink(w->fname);
+  }
+  free(w->fname);
+  w->fname = NULL;
+}
+
+static void reader_unmap(frame_reader_t *r) {
+  if (r->ch != NULL) {
+    munmap(r->ch, r->size);
+    r->ch = NULL;
+    r->size = 0;
+  }
+}
+
+static bool reader_map(frame_reader_t *r) {
+  if (r->ch != NULL) {
+    if ((__atomic_load_n(&(r->ch->magic), __ATOMIC_ACQUIRE) ==
+         FRAME_CHANNEL_MAGIC) &&
+        (channel_size(__atomic_load_n(&(r->ch->capacity), __ATOMIC_RELAXED)) <=
+         r->size)) {
+      return true;
+    }
+    reader_unmap(r);
+  }
+  if (r->fname == NULL) {
+    r->fname = ltr_int_get_default_file_name("frames.dat");
+    if (r->fname == NULL) {
+      return false;
+    }
+  }
+  int fd = open(r->fname, O_RDWR | O_NOFOLLOW);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) ||
+      ((size_t)st.st_size < sizeof(frame_channel_t))) {
+    close(fd);
+    return false;
+  }
+  void *data =
+      mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  r->ch = (frame_channel_t *)data;
+  r->size = st.st_size;
+  if (__atomic_load_n(&(r->ch->magic), __ATOMIC_ACQUIRE) !=
+      FRAME_CHANNEL_MAGIC) {
+    reader_unmap(r);
+    return false;
+  }
+  return true;
+}
+
+int ltr_int_frame_reader_get(frame_reader_t *r, int *width, int *height,
+                             size_t buf_size, uint8_t *buffer) {
+  frame_channel_buf_t info;
+  int res = ltr_int_frame_reader_read(r, &info, buf_size, buffer);
+  if ((res >= 0) && (info.size > 0)) {
+    *width = info.width;
+    *height = info.height;
+  }
+  return res;
+}
+
+int ltr_int_frame_reader_read(frame_reader_t *r, frame_channel_buf_t *info,
+                              size_t buf_size, uint8_t *buffer) {
+  info->size = 0;
+  if (!reader_map(r)) {
+    return -1;
+  }
+  frame_channel_t *ch = r->ch;
+  __atomic_store_n(&(ch->heartbeat), ltr_int_frame_channel_clock(),
+                   __ATOMIC_RELAXED);
+  if (!__atomic_load_n(&(ch->active), __ATOMIC_ACQUIRE)) {
+    return -1;
+  }
+  int i;
+  for (i = 0; i < FRAME_READ_ATTEMPTS; ++i) {
+    uint32_t index = __atomic_load_n(&(ch->latest), __ATOMIC_ACQUIRE);
+    if (index >= FRAME_CHANNEL_BUFFERS) {
+      return 0;
+    }
+    frame_channel_buf_t *b = &(ch->buf[index]);
+    uint32_t start = ltr_int_seq_read_begin(&(b->seq));
+    if (start & 1) {
+      continue;
+    }
+    uint32_t capacity = __atomic_load_n(&(ch->capacity), __ATOMIC_RELAXED);
+    frame_channel_buf_t tmp;
+    tmp.seq = start;
+    tmp.width = __atomic_load_n(&(b->width), __ATOMIC_RELAXED);
+    tmp.height = __atomic_load_n(&(b->height), __ATOMIC_RELAXED);
+    tmp.counter = __atomic_load_n(&(b->counter), __ATOMIC_RELAXED);
+    tmp.size = __atomic_load_n(&(b->size), __ATOMIC_RELAXED);
+    if ((tmp.size > capacity) || (channel_size(capacity) > r->size)) {
+      // torn, or the file grew; the next call maps it anew
+      if (ltr_int_seq_read_end(&(b->seq), start)) {
+        return 0;
+      }
+      continue;
+    }
+    if (buf_size < tmp.size) {
+      if (ltr_int_seq_read_end(&(b->seq), start)) {
+        *info = tmp;
+        return 0;
+      }
+      continue;
+    }
+    memcpy(buffer, buffer_data(ch, index, capacity), tmp.size);
+    if (ltr_int_seq_read_end(&(b->seq), start)) {
+      *info = tmp;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void ltr_int_frame_reader_close(frame_reader_t *r) {
+  reader_unmap(r);
+  free(r->fname);
+  r->fname = NULL;
+}
@@ -0,0 +1,95 @@
+#ifndef FRAME_CHANNEL__H
+#define FRAME_CHANNEL__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Camera frames for viewers in other processes, shared through a mmapped
+//   file. The master writes three buffers in turn, each guarded by its own
+//   sequence counter; viewers copy the newest complete one. Viewers stamp a
+//   heartbeat on every read, and the master stops copying frames once
+//   nobody has looked for FRAME_CHANNEL_IDLE ms.
+#define FRAME_CHANNEL_BUFFERS 3
+#define FRAME_CHANNEL_NONE 0xffffffffu
+#define FRAME_CHANNEL_IDLE 2000
+
+typedef struct {
+  uint32_t seq;
+  uint32_t width;
+  uint32_t height;
+  uint32_t counter;
+  uint32_t size; // bytes of data, width * height for plain frames
+} frame_channel_buf_t;
+
+// Only 32bit fields, so 32 and 64bit processes agree on the layout
+typedef struct {
+  uint32_t magic;
+  uint32_t capacity;  // bytes reserved for each buffer
+  uint32_t latest;    // newest complete buffer
+  uint32_t active;    // the master publishes frames
+  uint32_t heartbeat; // ms clock of the last viewer read
+  uint32_t pad;
+  frame_channel_buf_t buf[FRAME_CHANNEL_BUFFERS];
+} frame_channel_t;
+
+typedef struct {
+  char *fname;
+  int fd;
+  size_t size;
+  frame_channel_t *ch;
+  int writing;     // buffer handed out for the next frame, -1 if none
+  uint32_t demand; // ms clock of the last explicit request for frames
+} frame_writer_t;
+
+typedef struct {
+  char *fname;
+  size_t size;
+  frame_channel_t *ch;
+} frame_reader_t;
+
+// Millisecond clock used for heartbeats; wraps around
+uint32_t ltr_int_frame_channel_clock(void);
+
+// Master side. The file is created on first use; fname NULL means the
+//   default frames.dat.
+void ltr_int_frame_writer_init(frame_writer_t *w, const char *fname);
+// Tells whether anyone wants frames now (a viewer read recently, or one
+//   asked through ltr_int_frame_writer_demand).
+bool ltr_int_frame_writer_wanted(frame_writer_t *w);
+void ltr_int_frame_writer_demand(frame_writer_t *w);
+// Reserves the buffer the next frame goes to; NULL on failure.
+uint8_t *ltr_int_frame_writer_begin(frame_writer_t *w, uint32_t width,
+                                    uint32_t height);
+// Same for data other than a plain bitmap
+uint8_t *ltr_int_frame_writer_begin_data(frame_writer_t *w, uint32_t width,
+                                         uint32_t height, uint32_t size);
+// Creates the file up front, so viewers can ask for data by heartbeat alone
+bool ltr_int_frame_writer_open(frame_writer_t *w, uint32_t capacity);
+// The buffer handed out by begin, NULL if none
+uint8_t *ltr_int_frame_writer_current(frame_writer_t *w, uint32_t *width,
+                                      uint32_t *height);
+void ltr_int_frame_writer_publish(frame_writer_t *w, uint32_t counter);
+void ltr_int_frame_writer_abort(frame_writer_t *w);
+void ltr_int_frame_writer_close(frame_writer_t *w);
+
+// Viewer side. Returns 1 with the newest frame copied, 0 when there is none
+//   to copy right now and -1 when the master isn't publishing at all (no
+//   channel, or it went idle); width and height are set whenever known.
+int ltr_int_frame_reader_get(frame_reader_t *r, int *width, int *height,
+                             size_t buf_size, uint8_t *buffer);
+// Same, for any kind of data; info gets the header of the buffer read
+//   (its size even when buf_size is too small).
+int ltr_int_frame_reader_read(frame_reader_t *r, frame_channel_buf_t *info,
+                              size_t buf_size, uint8_t *buffer);
+void ltr_int_frame_reader_close(frame_reader_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+#include "frame_ring.h"
+#include "utils.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_SLOT UINT_MAX
+
+typedef struct {
+  struct frame_type frame;
+  unsigned char *buf; // bitmap owned by the slot
+  size_t buf_size;
+  ltr_stripe_run_t *runs; // runs owned by the slot
+  unsigned int max_runs;
+} frame_slot;
+
+// Slots change hands by index: the producer fills one, up to `depth` wait
+//   in the queue, the consumer holds one and the rest sit in the free
+//   queue. With depth + 2 slots the producer always finds a free one.
+struct frame_ring {
+  unsigned int depth;
+  unsigned int slots;
+  frame_slot *slot;
+  // queued frames, written by the producer, read by the consumer
+  _Atomic unsigned int *queue;
+  atomic_ulong head; // producer owned
+  atomic_ulong tail; // advanced by the consumer, or the producer dropping
+  // slots the consumer is done with
+  _Atomic unsigned int *free_queue;
+  atomic_ulong free_head; // consumer owned
+  atomic_ulong free_tail; // producer owned
+  unsigned int writing;   // slot being filled by the producer
+  unsigned int held;      // slot held by the consumer
+  atomic_ulong pushed;
+  atomic_ulong dropped;
+  atomic_uint max_depth;
+};
+
+frame_ring_t *ltr_int_frame_ring_create(unsigned int depth) {
+  assert(depth > 0);
+  frame_ring_t *ring = (frame_ring_t *)ltr_int_my_malloc(sizeof(frame_ring_t));
+  unsigned int i;
+  ring->depth = depth;
+  ring->slots = depth + 2;
+  ring->slot =
+      (frame_slot *)ltr_int_my_malloc(sizeof(frame_slot) * ring->slots);
+  ring->queue = (_Atomic unsigned int *)ltr_int_my_malloc(
+      sizeof(_Atomic unsigned int) * depth);
+  ring->free_queue = (_Atomic unsigned int *)ltr_int_my_malloc(
+      sizeof(_Atomic unsigned int) * ring->slots);
+  for (i = 0; i < ring->slots; ++i) {
+    frame_slot *s = &(ring->slot[i]);
+    s->frame.bloblist.blobs = (struct blob_type *)ltr_int_my_malloc(
+        sizeof(struct blob_type) * MAX_BLOBS);
+    s->frame.bloblist.num_blobs = MAX_BLOBS;
+    s->frame.bloblist.expected_blobs = 0;
+    s->frame.bitmap = NULL;
+    s->frame.want_runs = false;
+    s->frame.runs_truncated = false;
+    s->frame.num_runs = 0;
+    s->frame.runs = NULL;
+    s->buf = NULL;
+    s->buf_size = 0;
+    s->runs = NULL;
+    s->max_runs = 0;
+  }
+  for (i = 0; i < depth; ++i) {
+    atomic_init(&(ring->queue[i]), NO_SLOT);
+  }
+  // slot 0 goes to the producer, the rest is free
+  for (i = 0; i < ring->slots; ++i) {
+    atomic_init(&(ring->free_queue[i]), i);
+  }
+  ring->writing = 0;
+  ring->held = NO_SLOT;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->free_head, ring->slots);
+  atomic_init(&ring->free_tail, 1);
+  atomic_init(&ring->pushed, 0);
+  atomic_init(&ring->dropped, 0);
+  atomic_init(&ring->max_depth, 0);
+  return ring;
+}
+
+void ltr_int_frame_ring_free(frame_ring_t *ring) {
+  unsigned int i;
+  if (ring == NULL) {
+    return;
+  }
+  for (i = 0; i < ring->slots; ++i) {
+    free(ring->slot[i].frame.bloblist.blobs);
+    free(ring->slot[i].buf);
+    free(ring->slot[i].runs);
+  }
+  free(ring->slot);
+  free((void *)ring->queue);
+  free((void *)ring->free_queue);
+  free(ring);
+}
+
+struct frame_type *ltr_int_frame_ring_reserve(frame_ring_t *ring,
+                                              size_t bitmap_size) {
+  frame_slot *s = &(ring->slot[ring->writing]);
+  if (bitmap_size > s->buf_size) {
+    free(s->buf);
+    s->buf = (unsigned char *)ltr_int_my_malloc(bitmap_size);
+    s->buf_size = bitmap_size;
+  }
+  s->frame.bitmap = (bitmap_size > 0) ? s->buf : NULL;
+  s->frame.bloblist.num_blobs = MAX_BLOBS;
+  s->frame.runs_truncated = false;
+  s->frame.num_runs = 0;
+  s->frame.runs = NULL;
+  return &(s->frame);
+}
+
+void ltr_int_frame_ring_set_runs(frame_ring_t *ring,
+                                 const ltr_stripe_run_t *runs,
+                                 unsigned int num_runs, bool truncated) {
+  frame_slot *s = &(ring->slot[ring->writing]);
+  if (num_runs > s->max_runs) {
+    free(s->runs);
+    s->runs = (ltr_stripe_run_t *)ltr_int_my_malloc(sizeof(ltr_stripe_run_t) *
+                                                    num_runs);
+    s->max_runs = num_runs;
+  }
+  if (num_runs > 0) {
+    memcpy(s->runs, runs, sizeof(ltr_stripe_run_t) * num_runs);
+  }
+  s->frame.runs_truncated = truncated;
+  s->frame.num_runs = num_runs;
+  s->frame.runs = s->runs;
+}
+
+void ltr_int_frame_ring_push(frame_ring_t *ring) {
+  unsigned long h = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned long t = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  unsigned int next = NO_SLOT;
+  if (h - t == ring->depth) {
+    // Full - drop the oldest frame, unless the consumer just took it
+    if (atomic_compare_exchange_strong_explicit(&ring->tail, &t, t + 1,
+                                                memory_order_acq_rel,
+                                                memory_order_acquire)) {
+      next = atomic_load_explicit(&(ring->queue[t % ring->depth]),
+                                  memory_order_relaxed);
+      atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    }
+  }
+  atomic_store_explicit(&(ring->queue[h % ring->depth]), ring->writing,
+                        memory_order_relaxed);
+  atomic_store_explicit(&ring->head, h + 1, memory_order_release);
+  atomic_fetch_add_explicit(&ring->pushed, 1, memory_order_relaxed);
+
+  t = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  unsigned int depth = (unsigned int)(h + 1 - t);
+  if (depth > atomic_load_explicit(&ring->max_depth, memory_order_relaxed)) {
+    atomic_store_explicit(&ring->max_depth, depth, memory_order_relaxed);
+  }
+
+  if (next == NO_SLOT) {
+    unsigned long ft =
+        atomic_load_explicit(&ring->free_tail, memory_order_relaxed);
+    // the consumer returns its slot before taking another, so with the
+    //   queue holding at most `depth` frames one is always free here
+    assert(ft !=
+           atomic_load_explicit(&ring->free_head, memory_order_acquire));
+    next = atomic_load_explicit(&(ring->free_queue[ft % ring->slots]),
+                                memory_order_relaxed);
+    atomic_store_explicit(&ring->free_tail, ft + 1, memory_order_release);
+  }
+  ring->writing = next;
+}
+
+struct frame_type *ltr_int_frame_ring_pop(frame_ring_t *ring) {
+  if (ring->held != NO_SLOT) {
+    unsigned long fh =
+        atomic_load_explicit(&ring->free_head, memory_order_relaxed);
+    atomic_store_explicit(&(ring->free_queue[fh % ring->slots]), ring->held,
+                          memory_order_relaxed);
+    atomic_store_explicit(&ring->free_head, fh + 1, memory_order_release);
+    ring->held = NO_SLOT;
+  }
+  unsigned long t = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  while (t != atomic_load_explicit(&ring->head, memory_order_acquire)) {
+    unsigned int index = atomic_load_explicit(&(ring->queue[t % ring->depth]),
+                                              memory_order_relaxed);
+    // fails if the producer dropped this frame meanwhile
+    if (atomic_compare_exchange_weak_explicit(&ring->tail, &t, t + 1,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+      ring->held = index;
+      return &(ring->slot[index].frame);
+    }
+  }
+  return NULL;
+}
+
+void ltr_int_frame_ring_get_stats(frame_ring_t *ring,
+                                  ltr_int_frame_ring_stats_t *stats) {
+  unsigned long h = atomic_load_explicit(&ring->head, memory_order_acquire);
+  unsigned long t = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  stats->pushed = atomic_load_explicit(&ring->pushed, memory_order_relaxed);
+  stats->dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+  stats->depth = (h > t) ? (unsigned int)(h - t) : 0;
+  stats->max_depth =
+      atomic_load_explicit(&ring->max_depth, memory_order_relaxed);
+}
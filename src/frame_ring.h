@@ -0,0 +1,48 @@
+#ifndef FRAME_RING__H
+#define FRAME_RING__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cal.h"
+
+// Bounded single producer/single consumer queue of frames, handing whole
+//   frame slots between the capture and processing threads without locks.
+//   When the consumer falls behind, the oldest queued frame is dropped.
+typedef struct frame_ring frame_ring_t;
+
+typedef struct {
+  unsigned long pushed;  // frames queued
+  unsigned long dropped; // frames dropped to make room for newer ones
+  unsigned int depth;    // frames waiting right now
+  unsigned int max_depth;
+} ltr_int_frame_ring_stats_t;
+
+frame_ring_t *ltr_int_frame_ring_create(unsigned int depth);
+void ltr_int_frame_ring_free(frame_ring_t *ring);
+
+// Producer: frame to fill next; its bitmap holds bitmap_size bytes,
+//   or is NULL when bitmap_size is 0.
+struct frame_type *ltr_int_frame_ring_reserve(frame_ring_t *ring,
+                                              size_t bitmap_size);
+// Producer: copies the detector's runs into the reserved frame
+void ltr_int_frame_ring_set_runs(frame_ring_t *ring,
+                                 const ltr_stripe_run_t *runs,
+                                 unsigned int num_runs, bool truncated);
+// Producer: queues the reserved frame
+void ltr_int_frame_ring_push(frame_ring_t *ring);
+// Consumer: oldest queued frame or NULL if there is none. The frame stays
+//   valid until the next pop.
+struct frame_type *ltr_int_frame_ring_pop(frame_ring_t *ring);
+
+void ltr_int_frame_ring_get_stats(frame_ring_t *ring,
+                                  ltr_int_frame_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,424 @@
+#include "image_convert.h"
+#include <stdbool.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BW_X86 1
+#include <immintrin.h>
+#define BW_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define BW_NEON 1
+#include <arm_neon.h>
+#endif
+
+static inline unsigned char clamp_threshold(unsigned int threshold) {
+  return (threshold > 255) ? 255 : (unsigned char)threshold;
+}
+
+static inline unsigned char rgb_luma(unsigned int r, unsigned int g,
+                                     unsigned int b) {
+  return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+/*************************/
+/* Scalar reference code */
+/*************************/
+
+static void yuyv_scalar(const unsigned char *src, unsigned char *dest,
+                        size_t pixels, unsigned int threshold) {
+  size_t cntr;
+  for (cntr = 0; cntr < pixels; ++cntr) {
+    unsigned char y = src[2 * cntr];
+    dest[cntr] = (y > threshold) ? y : 0;
+  }
+}
+
+static void luma_scalar(const unsigned char *src, unsigned char *dest,
+                        size_t pixels, unsigned int threshold) {
+  size_t cntr;
+  for (cntr = 0; cntr < pixels; ++cntr) {
+    dest[cntr] = (src[cntr] > threshold) ? src[cntr] : 0;
+  }
+}
+
+static inline void packed_rgb_scalar(const unsigned char *src,
+                                     unsigned char *dest, size_t pixels,
+                                     unsigned int threshold, int r_off,
+                                     int b_off) {
+  size_t cntr;
+  for (cntr = 0; cntr < pixels; ++cntr, src += 3) {
+    unsigned char y = rgb_luma(src[r_off], src[1], src[b_off]);
+    dest[cntr] = (y > threshold) ? y : 0;
+  }
+}
+
+static void rgb_scalar(const unsigned char *src, unsigned char *dest,
+                       size_t pixels, unsigned int threshold) {
+  packed_rgb_scalar(src, dest, pixels, threshold, 0, 2);
+}
+
+static void bgr_scalar(const unsigned char *src, unsigned char *dest,
+                       size_t pixels, unsigned int threshold) {
+  packed_rgb_scalar(src, dest, pixels, threshold, 2, 0);
+}
+
+#ifdef BW_X86
+
+/********/
+/* SSE2 */
+/********/
+
+BW_TARGET("sse2")
+static inline __m128i keep_above_sse2(__m128i y, __m128i thr) {
+  // y > thr <=> saturated y - thr is nonzero
+  __m128i below = _mm_cmpeq_epi8(_mm_subs_epu8(y, thr), _mm_setzero_si128());
+  return _mm_andnot_si128(below, y);
+}
+
+BW_TARGET("sse2")
+static void yuyv_sse2(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  const __m128i thr = _mm_set1_epi8((char)clamp_threshold(threshold));
+  const __m128i lo_bytes = _mm_set1_epi16(0x00FF);
+  size_t cntr = 0;
+  for (; cntr + 16 <= pixels; cntr += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * cntr));
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + 2 * cntr + 16));
+    __m128i y = _mm_packus_epi16(_mm_and_si128(a, lo_bytes),
+                                 _mm_and_si128(b, lo_bytes));
+    _mm_storeu_si128((__m128i *)(dest + cntr), keep_above_sse2(y, thr));
+  }
+  yuyv_scalar(src + 2 * cntr, dest + cntr, pixels - cntr, threshold);
+}
+
+BW_TARGET("sse2")
+static void luma_sse2(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  const __m128i thr = _mm_set1_epi8((char)clamp_threshold(threshold));
+  size_t cntr = 0;
+  for (; cntr + 16 <= pixels; cntr += 16) {
+    __m128i y = _mm_loadu_si128((const __m128i *)(src + cntr));
+    _mm_storeu_si128((__m128i *)(dest + cntr), keep_above_sse2(y, thr));
+  }
+  luma_scalar(src + cntr, dest + cntr, pixels - cntr, threshold);
+}
+
+/*********/
+/* SSSE3 */
+/*********/
+
+// Eight packed pixels (24 bytes) are read as two overlapping 16 byte loads
+//   at offsets 0 and 8; pixels 0-4 come from the first, 5-7 from the second.
+//   The masks widen one component of each pixel to a 16bit lane.
+typedef struct {
+  __m128i lo[3];
+  __m128i hi[3];
+} rgb_masks_t;
+
+BW_TARGET("ssse3")
+static inline rgb_masks_t rgb_masks(void) {
+  rgb_masks_t m;
+  int comp, px;
+  for (comp = 0; comp < 3; ++comp) {
+    char lo[16], hi[16];
+    for (px = 0; px < 8; ++px) {
+      lo[2 * px] = (px < 5) ? (char)(3 * px + comp) : (char)0x80;
+      hi[2 * px] = (px < 5) ? (char)0x80 : (char)(3 * px + comp - 8);
+      lo[2 * px + 1] = hi[2 * px + 1] = (char)0x80;
+    }
+    m.lo[comp] = _mm_loadu_si128((const __m128i *)lo);
+    m.hi[comp] = _mm_loadu_si128((const __m128i *)hi);
+  }
+  return m;
+}
+
+BW_TARGET("ssse3")
+static inline __m128i component_ssse3(__m128i lo, __m128i hi,
+                                      const rgb_masks_t *m, int comp) {
+  return _mm_or_si128(_mm_shuffle_epi8(lo, m->lo[comp]),
+                      _mm_shuffle_epi8(hi, m->hi[comp]));
+}
+
+// Luma of eight pixels in 16bit lanes; all sums stay below 2^16
+BW_TARGET("ssse3")
+static inline __m128i luma8_ssse3(const unsigned char *src,
+                                  const rgb_masks_t *m, int r_off, int b_off) {
+  __m128i lo = _mm_loadu_si128((const __m128i *)src);
+  __m128i hi = _mm_loadu_si128((const __m128i *)(src + 8));
+  __m128i r = component_ssse3(lo, hi, m, r_off);
+  __m128i g = component_ssse3(lo, hi, m, 1);
+  __m128i b = component_ssse3(lo, hi, m, b_off);
+  __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                            _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+  y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+  y = _mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(128)), 8);
+  return _mm_add_epi16(y, _mm_set1_epi16(16));
+}
+
+BW_TARGET("ssse3")
+static inline void packed_rgb_ssse3(const unsigned char *src,
+                                    unsigned char *dest, size_t pixels,
+                                    unsigned int threshold, int r_off,
+                                    int b_off) {
+  const __m128i thr = _mm_set1_epi8((char)clamp_threshold(threshold));
+  const rgb_masks_t m = rgb_masks();
+  size_t cntr = 0;
+  for (; cntr + 16 <= pixels; cntr += 16) {
+    const unsigned char *p = src + 3 * cntr;
+    __m128i y = _mm_packus_epi16(luma8_ssse3(p, &m, r_off, b_off),
+                                 luma8_ssse3(p + 24, &m, r_off, b_off));
+    _mm_storeu_si128((__m128i *)(dest + cntr), keep_above_sse2(y, thr));
+  }
+  packed_rgb_scalar(src + 3 * cntr, dest + cntr, pixels - cntr, threshold,
+                    r_off, b_off);
+}
+
+BW_TARGET("ssse3")
+static void rgb_ssse3(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  packed_rgb_ssse3(src, dest, pixels, threshold, 0, 2);
+}
+
+BW_TARGET("ssse3")
+static void bgr_ssse3(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  packed_rgb_ssse3(src, dest, pixels, threshold, 2, 0);
+}
+
+/********/
+/* AVX2 */
+/********/
+
+BW_TARGET("avx2")
+static inline __m256i keep_above_avx2(__m256i y, __m256i thr) {
+  __m256i below =
+      _mm256_cmpeq_epi8(_mm256_subs_epu8(y, thr), _mm256_setzero_si256());
+  return _mm256_andnot_si256(below, y);
+}
+
+BW_TARGET("avx2")
+static inline __m256i load2x128(const unsigned char *a, const unsigned char *b) {
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+      _mm_loadu_si128((const __m128i *)b), 1);
+}
+
+BW_TARGET("avx2")
+static void yuyv_avx2(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  const __m256i thr = _mm256_set1_epi8((char)clamp_threshold(threshold));
+  const __m256i lo_bytes = _mm256_set1_epi16(0x00FF);
+  size_t cntr = 0;
+  for (; cntr + 32 <= pixels; cntr += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * cntr));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * cntr + 32));
+    __m256i y = _mm256_packus_epi16(_mm256_and_si256(a, lo_bytes),
+                                    _mm256_and_si256(b, lo_bytes));
+    // packus works per 128bit lane; restore pixel order
+    y = _mm256_permute4x64_epi64(y, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256((__m256i *)(dest + cntr), keep_above_avx2(y, thr));
+  }
+  yuyv_sse2(src + 2 * cntr, dest + cntr, pixels - cntr, threshold);
+}
+
+BW_TARGET("avx2")
+static void luma_avx2(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  const __m256i thr = _mm256_set1_epi8((char)clamp_threshold(threshold));
+  size_t cntr = 0;
+  for (; cntr + 32 <= pixels; cntr += 32) {
+    __m256i y = _mm256_loadu_si256((const __m256i *)(src + cntr));
+    _mm256_storeu_si256((__m256i *)(dest + cntr), keep_above_avx2(y, thr));
+  }
+  luma_sse2(src + cntr, dest + cntr, pixels - cntr, threshold);
+}
+
+BW_TARGET("avx2")
+static inline __m256i component_avx2(__m256i lo, __m256i hi,
+                                     const __m256i *mlo, const __m256i *mhi) {
+  return _mm256_or_si256(_mm256_shuffle_epi8(lo, *mlo),
+                         _mm256_shuffle_epi8(hi, *mhi));
+}
+
+// Two groups of eight pixels, one per 128bit lane
+BW_TARGET("avx2")
+static inline __m256i luma16_avx2(const unsigned char *a,
+                                  const unsigned char *b, const __m256i *mlo,
+                                  const __m256i *mhi, int r_off, int b_off) {
+  __m256i lo = load2x128(a, b);
+  __m256i hi = load2x128(a + 8, b + 8);
+  __m256i r = component_avx2(lo, hi, &mlo[r_off], &mhi[r_off]);
+  __m256i g = component_avx2(lo, hi, &mlo[1], &mhi[1]);
+  __m256i bl = component_avx2(lo, hi, &mlo[b_off], &mhi[b_off]);
+  __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)),
+                               _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+  y = _mm256_add_epi16(y, _mm256_mullo_epi16(bl, _mm256_set1_epi16(25)));
+  y = _mm256_srli_epi16(_mm256_add_epi16(y, _mm256_set1_epi16(128)), 8);
+  return _mm256_add_epi16(y, _mm256_set1_epi16(16));
+}
+
+BW_TARGET("avx2")
+static inline void packed_rgb_avx2(const unsigned char *src,
+                                   unsigned char *dest, size_t pixels,
+                                   unsigned int threshold, int r_off,
+                                   int b_off) {
+  const __m256i thr = _mm256_set1_epi8((char)clamp_threshold(threshold));
+  const rgb_masks_t m = rgb_masks();
+  __m256i mlo[3], mhi[3];
+  int comp;
+  for (comp = 0; comp < 3; ++comp) {
+    mlo[comp] = _mm256_broadcastsi128_si256(m.lo[comp]);
+    mhi[comp] = _mm256_broadcastsi128_si256(m.hi[comp]);
+  }
+  size_t cntr = 0;
+  for (; cntr + 32 <= pixels; cntr += 32) {
+    const unsigned char *p = src + 3 * cntr;
+    // lanes hold pixel groups 0|1 and 2|3
+    __m256i y01 = luma16_avx2(p, p + 24, mlo, mhi, r_off, b_off);
+    __m256i y23 = luma16_avx2(p + 48, p + 72, mlo, mhi, r_off, b_off);
+    __m256i y = _mm256_packus_epi16(y01, y23);
+    y = _mm256_permute4x64_epi64(y, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256((__m256i *)(dest + cntr), keep_above_avx2(y, thr));
+  }
+  packed_rgb_ssse3(src + 3 * cntr, dest + cntr, pixels - cntr, threshold,
+                   r_off, b_off);
+}
+
+BW_TARGET("avx2")
+static void rgb_avx2(const unsigned char *src, unsigned char *dest,
+                     size_t pixels, unsigned int threshold) {
+  packed_rgb_avx2(src, dest, pixels, threshold, 0, 2);
+}
+
+BW_TARGET("avx2")
+static void bgr_avx2(const unsigned char *src, unsigned char *dest,
+                     size_t pixels, unsigned int threshold) {
+  packed_rgb_avx2(src, dest, pixels, threshold, 2, 0);
+}
+
+#endif
+
+#ifdef BW_NEON
+
+/********/
+/* NEON */
+/********/
+
+static inline uint8x16_t keep_above_neon(uint8x16_t y, uint8x16_t thr) {
+  return vandq_u8(y, vcgtq_u8(y, thr));
+}
+
+static void yuyv_neon(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  const uint8x16_t thr = vdupq_n_u8(clamp_threshold(threshold));
+  size_t cntr = 0;
+  for (; cntr + 16 <= pixels; cntr += 16) {
+    uint8x16x2_t yuyv = vld2q_u8(src + 2 * cntr);
+    vst1q_u8(dest + cntr, keep_above_neon(yuyv.val[0], thr));
+  }
+  yuyv_scalar(src + 2 * cntr, dest + cntr, pixels - cntr, threshold);
+}
+
+static void luma_neon(const unsigned char *src, unsigned char *dest,
+                      size_t pixels, unsigned int threshold) {
+  const uint8x16_t thr = vdupq_n_u8(clamp_threshold(threshold));
+  size_t cntr = 0;
+  for (; cntr + 16 <= pixels; cntr += 16) {
+    vst1q_u8(dest + cntr, keep_above_neon(vld1q_u8(src + cntr), thr));
+  }
+  luma_scalar(src + cntr, dest + cntr, pixels - cntr, threshold);
+}
+
+static inline uint8x8_t luma8_neon(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+  uint16x8_t acc = vmull_u8(r, vdup_n_u8(66));
+  acc = vmlal_u8(acc, g, vdup_n_u8(129));
+  acc = vmlal_u8(acc, b, vdup_n_u8(25));
+  acc = vaddq_u16(acc, vdupq_n_u16(128));
+  return vadd_u8(vshrn_n_u16(acc, 8), vdup_n_u8(16));
+}
+
+static inline void packed_rgb_neon(const unsigned char *src,
+                                   unsigned char *dest, size_t pixels,
+                                   unsigned int threshold, int r_off,
+                                   int b_off) {
+  const uint8x16_t thr = vdupq_n_u8(clamp_threshold(threshold));
+  size_t cntr = 0;
+  for (; cntr + 16 <= pixels; cntr += 16) {
+    uint8x16x3_t px = vld3q_u8(src + 3 * cntr);
+    uint8x16_t r = px.val[r_off], g = px.val[1], b = px.val[b_off];
+    uint8x16_t y =
+        vcombine_u8(luma8_neon(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b)),
+                    luma8_neon(vget_high_u8(r), vget_high_u8(g),
+                               vget_high_u8(b)));
+    vst1q_u8(dest + cntr, keep_above_neon(y, thr));
+  }
+  packed_rgb_scalar(src + 3 * cntr, dest + cntr, pixels - cntr, threshold,
+                    r_off, b_off);
+}
+
+static void rgb_neon(const unsigned char *src, unsigned char *dest,
+                     size_t pixels, unsigned int threshold) {
+  packed_rgb_neon(src, dest, pixels, threshold, 0, 2);
+}
+
+static void bgr_neon(const unsigned char *src, unsigned char *dest,
+                     size_t pixels, unsigned int threshold) {
+  packed_rgb_neon(src, dest, pixels, threshold, 2, 0);
+}
+
+#endif
+
+/************/
+/* Dispatch */
+/************/
+
+// Ordered from slowest to fastest
+static const ltr_int_bw_kernels_t kernels[] = {
+    {"scalar", yuyv_scalar, luma_scalar, rgb_scalar, bgr_scalar},
+#ifdef BW_X86
+    {"sse2", yuyv_sse2, luma_sse2, rgb_scalar, bgr_scalar},
+    {"ssse3", yuyv_sse2, luma_sse2, rgb_ssse3, bgr_ssse3},
+    {"avx2", yuyv_avx2, luma_avx2, rgb_avx2, bgr_avx2},
+#endif
+#ifdef BW_NEON
+    {"neon", yuyv_neon, luma_neon, rgb_neon, bgr_neon},
+#endif
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static bool kernel_supported(unsigned int index) {
+#ifdef BW_X86
+  __builtin_cpu_init();
+  switch (index) {
+  case 1:
+    return __builtin_cpu_supports("sse2");
+  case 2:
+    return __builtin_cpu_supports("sse2") && __builtin_cpu_supports("ssse3");
+  case 3:
+    return __builtin_cpu_supports("sse2") && __builtin_cpu_supports("ssse3") &&
+           __builtin_cpu_supports("avx2");
+  default:
+    break;
+  }
+#endif
+  return index < NUM_KERNELS;
+}
+
+unsigned int ltr_int_bw_kernel_count(void) { return NUM_KERNELS; }
+
+const ltr_int_bw_kernels_t *ltr_int_bw_kernel(unsigned int index) {
+  if ((index >= NUM_KERNELS) || !kernel_supported(index)) {
+    return NULL;
+  }
+  return &kernels[index];
+}
+
+const ltr_int_bw_kernels_t *ltr_int_bw_select_kernels(void) {
+  unsigned int index = NUM_KERNELS;
+  while (index-- > 1) {
+    if (kernel_supported(index)) {
+      return &kernels[index];
+    }
+  }
+  return &kernels[0];
+}
@@ -0,0 +1,36 @@
+#ifndef IMAGE_CONVERT__H
+#define IMAGE_CONVERT__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+// Converts `pixels` source pixels to 8bit luma; values not above threshold
+//   are zeroed. RGB luma is integer BT.601: ((66R + 129G + 25B + 128) >> 8) + 16
+typedef void (*ltr_int_bw_kernel_t)(const unsigned char *src,
+                                    unsigned char *dest, size_t pixels,
+                                    unsigned int threshold);
+
+typedef struct {
+  const char *name;
+  ltr_int_bw_kernel_t yuyv;  // packed YUYV
+  ltr_int_bw_kernel_t luma;  // luma plane (YU12/YV12/GREY)
+  ltr_int_bw_kernel_t rgb;   // packed RGB3
+  ltr_int_bw_kernel_t bgr;   // packed BGR3
+} ltr_int_bw_kernels_t;
+
+// Fastest kernel set the running CPU supports
+const ltr_int_bw_kernels_t *ltr_int_bw_select_kernels(void);
+
+// All compiled in kernel sets; index 0 is the scalar reference.
+//   Returns NULL for sets the running CPU can't execute.
+unsigned int ltr_int_bw_kernel_count(void);
+const ltr_int_bw_kernels_t *ltr_int_bw_kernel(unsigned int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,41 +1,138 @@
 #include "image_process.h"
-#include "list.h"
 #include "utils.h"
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+
+#define NO_LABEL UINT_MAX
+#define MAX_BANDS 8
+// Bands thinner than this aren't worth a thread
+#define MIN_BAND_LINES 32
+// Runs kept per frame for the stripe stream
+#define MAX_KEPT_RUNS 16384
 
 typedef struct preblob_t {
-  float sum_x, sum_y; // sums of pixval and coord products
-  int sum;            // sum of pixel weights
-  int points;         // pixel count
-  bool added;
-  bool matched;
+  uint64_t sum_x, sum_y; // sums of pixval and coord products
+  unsigned int sum;      // sum of pixel weights
+  unsigned int points;   // pixel count
+  unsigned int parent;   // union-find link, roots point to themselves
+  unsigned int x1, y1, x2, y2; // bounding box
 } preblob_t;
 
-static plist preblobs = NULL;
-
 typedef struct {
   unsigned int x1, x2;
-  preblob_t *pb;
+  unsigned int label;
 } range;
 
 typedef struct {
   range *ranges;
   int limit;
+  int capacity;
+  bool sorted; // ranges come in ascending x1 order
 } stripe_array;
 
-static stripe_array current = {
-    .ranges = NULL,
-    .limit = 0,
-};
+// Labeling state of one horizontal band of the frame. Preblobs live in a
+//   frame scoped arena shared by all bands, each band owning its own slice
+//   of labels; merging two preblobs links their labels instead of freeing
+//   one and rewriting every range pointing to it.
+typedef struct {
+  preblob_t *blobs;   // the shared arena, indexed by label
+  unsigned int first; // first label of this band's slice
+  unsigned int end;   // one past the last label of the slice
+  unsigned int used;  // next free label
+  unsigned int dropped; // stripes lost to overflow this frame
+  stripe_array current, next;
+  stripe_array top; // ranges of the band's first line, for seam merging
+  unsigned int current_vline;
+  // first range of the current array that can still touch incoming stripes
+  int current_pos;
+  int y1, y2; // lines [y1, y2) belong to the band
+  unsigned char *row_buf;
+  ltr_stripe_run_t *runs; // this band's slice of the kept runs
+  unsigned int num_runs, max_runs;
+} band_ctx;
+
+typedef struct {
+  preblob_t *blobs;
+  unsigned int capacity;
+  int w, h;
+  int threads;   // requested bands for full frame scans
+  int num_bands; // bands used by the frame in progress
+  band_ctx bands[MAX_BANDS];
+  ltr_stripe_run_t *runs; // runs of the last frame, NULL unless kept
+  unsigned int num_runs;
+  bool runs_truncated;
+} blob_detector;
+
+typedef struct {
+  int x1, y1, x2, y2;
+} window_t;
+
+// Region of interest tracking - once all expected blobs are found, only
+//   padded windows around them are scanned in the following frames.
+typedef struct {
+  bool enabled;
+  int padding;
+  int interval;     // frames between forced full scans
+  bool locked;      // windows are valid for the next frame
+  bool scanning;    // this frame was scanned through the windows only
+  int since_full;
+  int num_windows;
+  window_t windows[MAX_BLOBS];
+  ltr_int_roi_stats_t stats;
+} roi_state;
+
+typedef struct {
+  const unsigned char *src; // NULL when scanning img->bitmap
+  size_t stride;
+  ltr_int_bw_kernel_t kernel;
+  unsigned int threshold;
+  image_t *img;
+  int bands; // bands in use, workers past them just check in
+} band_job;
+
+struct ltr_blob_detector;
+
+typedef struct {
+  struct ltr_blob_detector *d;
+  int index;
+} band_worker_arg;
+
+typedef struct {
+  pthread_t threads[MAX_BANDS - 1];
+  band_worker_arg args[MAX_BANDS - 1];
+  int num_threads;
+  pthread_mutex_t mx;
+  pthread_cond_t start_cv;
+  pthread_cond_t done_cv;
+  unsigned int generation;
+  int pending;
+  bool quit;
+  band_job job;
+} band_pool;
 
-static stripe_array next = {
-    .ranges = NULL,
-    .limit = 0,
+// Everything one detector instance needs; instances don't share anything,
+//   so several can process frames at once.
+struct ltr_blob_detector {
+  blob_detector det;
+  roi_state roi;
+  band_pool pool;
 };
 
-static unsigned int current_vline = -2;
+static void detector_init(ltr_blob_detector_t *d) {
+  memset(d, 0, sizeof(ltr_blob_detector_t));
+  d->det.threads = 1;
+  d->det.num_bands = 1;
+  d->roi.padding = 16;
+  d->roi.interval = 30;
+  pthread_mutex_init(&(d->pool.mx), NULL);
+  pthread_cond_init(&(d->pool.start_cv), NULL);
+  pthread_cond_init(&(d->pool.done_cv), NULL);
+}
 
 static void clip_coord(int *coord, int min, int max) {
   int tmp = *coord;
@@ -164,89 +261,110 @@ static bool stripe_in_range(stripe_t *stripe, range *rng) {
   return false;
 }
 
-static void merge_preblobs(preblob_t *b1, preblob_t *b2) {
+static unsigned int find_root(preblob_t *b, unsigned int label) {
+  while (b[label].parent != label) {
+    // path halving
+    b[label].parent = b[b[label].parent].parent;
+    label = b[label].parent;
+  }
+  return label;
+}
+
+// The lower label stays the root, so roots keep the order they were found in
+static unsigned int merge_preblobs(preblob_t *b, unsigned int l1,
+                                   unsigned int l2) {
 #ifdef DBG_MSG
-  printf("Merging %p and %p\n", b1, b2);
+  printf("Merging %u and %u\n", l1, l2);
 #endif
-  assert(b1 != NULL);
-  assert(b2 != NULL);
+  if (l1 > l2) {
+    unsigned int tmp = l1;
+    l1 = l2;
+    l2 = tmp;
+  }
+  preblob_t *b1 = &(b[l1]);
+  preblob_t *b2 = &(b[l2]);
   b1->sum_x += b2->sum_x;
   b1->sum_y += b2->sum_y;
   b1->sum += b2->sum;
   b1->points += b2->points;
+  b1->x1 = (b2->x1 < b1->x1) ? b2->x1 : b1->x1;
+  b1->y1 = (b2->y1 < b1->y1) ? b2->y1 : b1->y1;
+  b1->x2 = (b2->x2 > b1->x2) ? b2->x2 : b1->x2;
+  b1->y2 = (b2->y2 > b1->y2) ? b2->y2 : b1->y2;
+  b2->parent = l1;
+  return l1;
 }
 
 static void add_stripe_to_preblob(preblob_t *pb, stripe_t *stripe) {
 #ifdef DBG_MSG
   printf("Adding stripe to blob %p\n", pb);
 #endif
-  pb->sum_x += ((float)stripe->sum * stripe->hstart) + stripe->sum_x;
-  pb->sum_y += (float)stripe->sum * stripe->vline;
+  pb->sum_x += ((uint64_t)stripe->sum * stripe->hstart) + stripe->sum_x;
+  pb->sum_y += (uint64_t)stripe->sum * stripe->vline;
   pb->sum += stripe->sum;
   pb->points += stripe->points;
+  pb->x1 = (stripe->hstart < pb->x1) ? stripe->hstart : pb->x1;
+  pb->x2 = (stripe->hstop > pb->x2) ? stripe->hstop : pb->x2;
+  pb->y2 = stripe->vline; // stripes come line by line
 }
 
-static preblob_t *preblob_from_stripe(stripe_t *stripe) {
-  preblob_t *pb = (preblob_t *)ltr_int_my_malloc(sizeof(preblob_t));
-  pb->sum_x = ((float)stripe->sum * stripe->hstart) + stripe->sum_x;
-  pb->sum_y = (float)stripe->sum * stripe->vline;
+static unsigned int preblob_from_stripe(band_ctx *band, stripe_t *stripe) {
+  if (band->used >= band->end) {
+    return NO_LABEL;
+  }
+  unsigned int label = band->used++;
+  preblob_t *pb = &(band->blobs[label]);
+  pb->sum_x = ((uint64_t)stripe->sum * stripe->hstart) + stripe->sum_x;
+  pb->sum_y = (uint64_t)stripe->sum * stripe->vline;
   pb->sum = stripe->sum;
   pb->points = stripe->points;
-  pb->added = false;
-  pb->matched = true;
+  pb->parent = label;
+  pb->x1 = stripe->hstart;
+  pb->x2 = stripe->hstop;
+  pb->y1 = pb->y2 = stripe->vline;
 #ifdef DBG_MSG
-  printf("Creating new blob %p\n", pb);
+  printf("Creating new blob %u\n", label);
 #endif
-  return pb;
+  return label;
 }
 
-static bool store_preblobs(bool all) {
-  if (preblobs == NULL) {
-    preblobs = ltr_int_create_list();
-  }
-  int i;
-  for (i = 0; i < current.limit; ++i) {
-#ifdef DBG_MSG
-    printf("Checking current %p m:%c a:%c: ", current.ranges[i].pb,
-           current.ranges[i].pb->matched ? 't' : 'f',
-           current.ranges[i].pb->added ? 't' : 'f');
-#endif
-    if (!(current.ranges[i].pb->matched)) {
-      if (!current.ranges[i].pb->added) {
-#ifdef DBG_MSG
-        printf("Added!");
-#endif
-        current.ranges[i].pb->added = true;
-        ltr_int_add_element(preblobs, current.ranges[i].pb);
-      }
-    }
-#ifdef DBG_MSG
-    printf("\n");
-#endif
+static void reset_ranges(stripe_array *sa) {
+  sa->limit = 0;
+  sa->sorted = true;
+}
+
+static void copy_ranges(stripe_array *dest, stripe_array *src) {
+  memcpy(dest->ranges, src->ranges, sizeof(range) * src->limit);
+  dest->limit = src->limit;
+  dest->sorted = src->sorted;
+}
+
+// The band's first line is complete once the band leaves it
+static void band_leave_line(band_ctx *band) {
+  if (band->current_vline == (unsigned int)band->y1) {
+    copy_ranges(&(band->top), &(band->next));
   }
-  for (i = 0; i < next.limit; ++i) {
-    next.ranges[i].pb->matched = false;
-    if (all) {
-#ifdef DBG_MSG
-      printf("Checking next %p: ", current.ranges[i].pb);
-#endif
-      if (!next.ranges[i].pb->added) {
-#ifdef DBG_MSG
-        printf("Added!\n");
-#endif
-        next.ranges[i].pb->added = true;
-        ltr_int_add_element(preblobs, next.ranges[i].pb);
-      }
-    }
-#ifdef DBG_MSG
-    printf("\n");
-#endif
+}
+
+static void keep_run(band_ctx *band, stripe_t *stripe, image_t *img) {
+  // runs past the slice are only counted
+  if (band->num_runs++ >= band->max_runs) {
+    return;
   }
-  return true;
+  ltr_stripe_run_t *run = &(band->runs[band->num_runs - 1]);
+  unsigned int x1 = stripe->hstart / img->ratio;
+  unsigned int x2 = stripe->hstop / img->ratio;
+  unsigned int value =
+      (stripe->points > 0) ? stripe->sum / stripe->points : 0xFF;
+  run->y = stripe->vline;
+  run->x = x1;
+  run->len = x2 - x1 + 1;
+  run->value = (value > 0xFF) ? 0xFF : value;
+  run->pad = 0;
 }
 
-bool ltr_int_add_stripe(stripe_t *stripe, image_t *img) {
-  assert(current.ranges != NULL);
+static bool band_add_stripe(band_ctx *band, stripe_t *stripe, image_t *img) {
+  assert(band->current.ranges != NULL);
   assert(stripe != NULL);
   assert(img != NULL);
 
@@ -283,209 +401,742 @@ bool ltr_int_add_stripe(stripe_t *stripe, image_t *img) {
   if (img->bitmap != NULL) {
     draw_stripe(img, stripe->hstart, stripe->vline, stripe->hstop, 0x80);
   }
+  if (band->runs != NULL) {
+    keep_run(band, stripe, img);
+  }
 #ifdef DBG_MSG
   printf("Adding stripe: y:%d   x:%d - %d (%d   %d)\n", stripe->vline,
          stripe->hstart, stripe->hstop, stripe->sum, stripe->sum_x);
 #endif
+  stripe_array *current = &(band->current);
+  stripe_array *next = &(band->next);
   int i;
   // First of all check if we aren't on a different line
-  if (current_vline != stripe->vline) {
+  if (band->current_vline != stripe->vline) {
+    band_leave_line(band);
     // Line differs - check if it isn't next line
-    if ((current_vline + 1) != stripe->vline) {
-      store_preblobs(true);
-      current.limit = 0;
-      next.limit = 0;
+    if ((band->current_vline + 1) != stripe->vline) {
+      reset_ranges(current);
+      reset_ranges(next);
     } else {
       // I'm on the next line, so put next to current and clean next
-      /*      printf("Next line!\n");
-            for(i = 0; i < next.limit; ++i){
-              printf("Next: %d - %d, %p, %s\n", next.ranges[i].x1,
-         next.ranges[i].x2, next.ranges[i].pb, next.ranges[i].matched ? "1" :
-         "0");
-            }
-      */
-      store_preblobs(false);
       stripe_array tmp;
-      tmp = current;
-      current = next;
-      next = tmp;
-      next.limit = 0;
+      tmp = *current;
+      *current = *next;
+      *next = tmp;
+      reset_ranges(next);
 #ifdef DBG_MSG
-      for (i = 0; i < current.limit; ++i) {
-        printf("Current: %d - %d, %p, %s\n", current.ranges[i].x1,
-               current.ranges[i].x2, current.ranges[i].pb,
-               current.ranges[i].pb->matched ? "1" : "0");
+      for (i = 0; i < current->limit; ++i) {
+        printf("Current: %d - %d, %u\n", current->ranges[i].x1,
+               current->ranges[i].x2, current->ranges[i].label);
       }
 #endif
     }
-    current_vline = stripe->vline;
-  }
-  range *rng = NULL;
-  for (i = 0; i < current.limit; ++i) {
-    if (stripe_in_range(stripe, &(current.ranges[i]))) {
-      current.ranges[i].pb->matched = true;
-      if (rng == NULL) {
-        rng = &(current.ranges[i]);
-      } else {
-        if (rng->pb != current.ranges[i].pb) {
-          merge_preblobs(rng->pb, current.ranges[i].pb);
-          preblob_t *merged = current.ranges[i].pb;
-          int j;
-          for (j = 0; j < current.limit; ++j) {
-            if (current.ranges[j].pb == merged) {
-              current.ranges[j].pb = rng->pb;
-            }
-          }
-          for (j = 0; j < next.limit; ++j) {
-            if (next.ranges[j].pb == merged) {
-              next.ranges[j].pb = rng->pb;
-            }
-          }
-          free(merged);
-        }
+    band->current_vline = stripe->vline;
+    band->current_pos = 0;
+  }
+  if (next->limit >= next->capacity) {
+    ++band->dropped;
+    return false;
+  }
+  if ((next->limit > 0) &&
+      (next->ranges[next->limit - 1].x1 > stripe->hstart)) {
+    // stripes of this line came out of order
+    next->sorted = false;
+    band->current_pos = 0;
+  }
+  unsigned int label = NO_LABEL;
+  if (current->sorted && next->sorted) {
+    // Ranges left of this stripe can't touch any later stripe either
+    while ((band->current_pos < current->limit) &&
+           ((int)current->ranges[band->current_pos].x2 <
+            (int)stripe->hstart - 1)) {
+      ++band->current_pos;
+    }
+    i = band->current_pos;
+  } else {
+    i = 0;
+  }
+  for (; i < current->limit; ++i) {
+    if (current->sorted && (current->ranges[i].x1 > stripe->hstop + 1)) {
+      break;
+    }
+    if (stripe_in_range(stripe, &(current->ranges[i]))) {
+      unsigned int l = find_root(band->blobs, current->ranges[i].label);
+      if (label == NO_LABEL) {
+        label = l;
+      } else if (label != l) {
+        label = merge_preblobs(band->blobs, label, l);
       }
     }
   }
-  preblob_t *pb = NULL;
-  if (rng == NULL) {
-    pb = preblob_from_stripe(stripe);
+  if (label == NO_LABEL) {
+    label = preblob_from_stripe(band, stripe);
+    if (label == NO_LABEL) {
+      ++band->dropped;
+      return false;
+    }
   } else {
-    pb = rng->pb;
-    add_stripe_to_preblob(pb, stripe);
+    add_stripe_to_preblob(&(band->blobs[label]), stripe);
   }
-  range *new_rng = &(next.ranges[next.limit++]);
+  range *new_rng = &(next->ranges[next->limit++]);
   new_rng->x1 = stripe->hstart;
   new_rng->x2 = stripe->hstop;
-  new_rng->pb = pb;
+  new_rng->label = label;
   return true;
 }
 
+bool ltr_int_detector_add_stripe(ltr_blob_detector_t *d, stripe_t *stripe,
+                                 image_t *img) {
+  return band_add_stripe(&(d->det.bands[0]), stripe, img);
+}
+
+// A band of l lines can't hold more preblobs than this
+static unsigned int band_capacity(ltr_blob_detector_t *d, int lines) {
+  // A line holds at most w/2 + 1 stripes; a new preblob needs a stripe
+  //   not touching anything on the line above, so at most every other
+  //   line can add a full line of them.
+  return ((d->det.w / 2) + 1) * (((lines + 1) / 2) + 1);
+}
+
+static void reset_band(band_ctx *band) {
+  band->used = band->first;
+  band->dropped = 0;
+  reset_ranges(&(band->current));
+  reset_ranges(&(band->next));
+  reset_ranges(&(band->top));
+  band->current_vline = -2;
+  band->current_pos = 0;
+  band->num_runs = 0;
+}
+
+// Splits the frame into n bands, each with its own slice of the arena
+static void setup_bands(ltr_blob_detector_t *d, int n) {
+  int i;
+  unsigned int label = 0;
+  for (i = 0; i < n; ++i) {
+    band_ctx *band = &(d->det.bands[i]);
+    band->y1 = (d->det.h * i) / n;
+    band->y2 = (d->det.h * (i + 1)) / n;
+    band->first = label;
+    label += band_capacity(d, band->y2 - band->y1);
+    band->end = (label < d->det.capacity) ? label : d->det.capacity;
+    band->max_runs = MAX_KEPT_RUNS / n;
+    band->runs = (d->det.runs != NULL) ? d->det.runs + (i * band->max_runs) : NULL;
+    reset_band(band);
+  }
+  d->det.num_bands = n;
+}
+
+// Gathers the runs of all bands at the start of the array, in line order
+static void collect_runs(ltr_blob_detector_t *d) {
+  int b;
+  d->det.num_runs = 0;
+  d->det.runs_truncated = false;
+  for (b = 0; b < d->det.num_bands; ++b) {
+    band_ctx *band = &(d->det.bands[b]);
+    if (band->runs == NULL) {
+      continue;
+    }
+    unsigned int n = band->num_runs;
+    if (n > band->max_runs) {
+      n = band->max_runs;
+      d->det.runs_truncated = true;
+    }
+    memmove(d->det.runs + d->det.num_runs, band->runs, sizeof(ltr_stripe_run_t) * n);
+    d->det.num_runs += n;
+  }
+}
+
+static bool alloc_ranges(stripe_array *sa, int capacity) {
+  sa->capacity = capacity;
+  sa->ranges = (range *)ltr_int_my_malloc(sizeof(range) * capacity);
+  reset_ranges(sa);
+  return sa->ranges != NULL;
+}
+
+static void free_ranges(stripe_array *sa) {
+  free(sa->ranges);
+  sa->ranges = NULL;
+  sa->capacity = 0;
+  reset_ranges(sa);
+}
+
+/***************/
+/* Band worker */
+/***************/
+
+static void span_to_stripes(band_ctx *band, const unsigned char *row, int y,
+                            int x1, int x2, unsigned int threshold,
+                            image_t *img);
+
+static void scan_band(band_ctx *band, const band_job *job) {
+  image_t *img = job->img;
+  int y;
+  for (y = band->y1; y < band->y2; ++y) {
+    const unsigned char *row;
+    unsigned int threshold = 0;
+    if (job->src == NULL) {
+      row = img->bitmap + (y * img->w);
+    } else if (job->kernel == NULL) {
+      // luma plane scanned in place
+      row = job->src + y * job->stride;
+      threshold = job->threshold;
+    } else {
+      unsigned char *dest =
+          (img->bitmap != NULL) ? img->bitmap + (y * img->w) : band->row_buf;
+      job->kernel(job->src + y * job->stride, dest, img->w, job->threshold);
+      row = dest;
+    }
+    span_to_stripes(band, row, y, 0, img->w - 1, threshold, img);
+  }
+  band_leave_line(band);
+}
+
+static void *band_worker(void *param) {
+  ltr_blob_detector_t *d = ((band_worker_arg *)param)->d;
+  int index = ((band_worker_arg *)param)->index;
+  unsigned int seen = 0;
+  pthread_mutex_lock(&d->pool.mx);
+  while (1) {
+    while ((!d->pool.quit) && (d->pool.generation == seen)) {
+      pthread_cond_wait(&d->pool.start_cv, &d->pool.mx);
+    }
+    if (d->pool.quit) {
+      break;
+    }
+    seen = d->pool.generation;
+    bool active = index < d->pool.job.bands;
+    pthread_mutex_unlock(&d->pool.mx);
+    if (active) {
+      scan_band(&(d->det.bands[index]), &d->pool.job);
+    }
+    pthread_mutex_lock(&d->pool.mx);
+    if (--d->pool.pending == 0) {
+      pthread_cond_signal(&d->pool.done_cv);
+    }
+  }
+  pthread_mutex_unlock(&d->pool.mx);
+  return NULL;
+}
+
+static void stop_pool(ltr_blob_detector_t *d) {
+  int i;
+  if (d->pool.num_threads == 0) {
+    return;
+  }
+  pthread_mutex_lock(&d->pool.mx);
+  d->pool.quit = true;
+  pthread_cond_broadcast(&d->pool.start_cv);
+  pthread_mutex_unlock(&d->pool.mx);
+  for (i = 0; i < d->pool.num_threads; ++i) {
+    pthread_join(d->pool.threads[i], NULL);
+  }
+  d->pool.num_threads = 0;
+  d->pool.quit = false;
+  // fresh workers start out waiting for generation 1
+  d->pool.generation = 0;
+}
+
+static void start_pool(ltr_blob_detector_t *d, int threads) {
+  int i;
+  stop_pool(d);
+  for (i = 0; i < threads; ++i) {
+    // worker i takes band i + 1, the caller does band 0
+    d->pool.args[i].d = d;
+    d->pool.args[i].index = i + 1;
+    if (pthread_create(&(d->pool.threads[i]), NULL, band_worker,
+                       &(d->pool.args[i])) != 0) {
+      ltr_int_log_message("Can't start band worker %d!\n", i + 1);
+      break;
+    }
+    d->pool.num_threads = i + 1;
+  }
+}
+
+// Merges preblobs touching across the seam between two adjacent bands
+static void merge_seam(ltr_blob_detector_t *d, band_ctx *upper,
+                       band_ctx *lower) {
+  if ((upper->current_vline + 1) != (unsigned int)lower->y1) {
+    return;
+  }
+  stripe_array *a = &(upper->next);
+  stripe_array *b = &(lower->top);
+  int i, j, start = 0;
+  bool sorted = a->sorted && b->sorted;
+  for (i = 0; i < a->limit; ++i) {
+    range *ra = &(a->ranges[i]);
+    stripe_t s = {.vline = lower->y1, .hstart = ra->x1, .hstop = ra->x2};
+    for (j = sorted ? start : 0; j < b->limit; ++j) {
+      range *rb = &(b->ranges[j]);
+      if (sorted && ((int)rb->x2 < (int)ra->x1 - 1)) {
+        start = j + 1;
+        continue;
+      }
+      if (sorted && (rb->x1 > ra->x2 + 1)) {
+        break;
+      }
+      if (stripe_in_range(&s, rb)) {
+        unsigned int l1 = find_root(d->det.blobs, ra->label);
+        unsigned int l2 = find_root(d->det.blobs, rb->label);
+        if (l1 != l2) {
+          merge_preblobs(d->det.blobs, l1, l2);
+        }
+      }
+    }
+  }
+}
+
+// Labels a whole frame, split into bands when worker threads are available.
+//   Labels grow with the band index and seams are merged keeping the lower
+//   label, so blobs come out exactly as from a single band.
+static void scan_bands(ltr_blob_detector_t *d, band_job *job) {
+  int i;
+  int n = (d->pool.num_threads > 0) ? d->pool.num_threads + 1 : 1;
+  if (n > job->img->h / MIN_BAND_LINES) {
+    n = job->img->h / MIN_BAND_LINES;
+  }
+  if (n < 2) {
+    scan_band(&(d->det.bands[0]), job);
+    return;
+  }
+  setup_bands(d, n);
+  pthread_mutex_lock(&d->pool.mx);
+  d->pool.job = *job;
+  d->pool.job.bands = n;
+  d->pool.pending = d->pool.num_threads;
+  ++d->pool.generation;
+  pthread_cond_broadcast(&d->pool.start_cv);
+  pthread_mutex_unlock(&d->pool.mx);
+
+  scan_band(&(d->det.bands[0]), job);
+
+  pthread_mutex_lock(&d->pool.mx);
+  while (d->pool.pending > 0) {
+    pthread_cond_wait(&d->pool.done_cv, &d->pool.mx);
+  }
+  pthread_mutex_unlock(&d->pool.mx);
+  for (i = 1; i < n; ++i) {
+    merge_seam(d, &(d->det.bands[i - 1]), &(d->det.bands[i]));
+  }
+}
+
 static dbg_flag_type img_dbg_flag = DBG_CHECK;
 
-void ltr_int_prepare_for_processing(int w, int h) {
-  // h = 0;
-  (void)h;
-  if (current.ranges == NULL) {
-    current.ranges = (range *)ltr_int_my_malloc(sizeof(range) * ((w / 2) + 1));
-    next.ranges = (range *)ltr_int_my_malloc(sizeof(range) * ((w / 2) + 1));
+void ltr_int_detector_prepare(ltr_blob_detector_t *d, int w, int h) {
+  int i;
+  if (d->det.blobs == NULL) {
+    d->det.w = w;
+    d->det.h = h;
+    // room for the worst case of every band
+    d->det.capacity = ((w / 2) + 1) * ((h / 2) + (2 * MAX_BANDS) + 1);
+    d->det.blobs =
+        (preblob_t *)ltr_int_my_malloc(sizeof(preblob_t) * d->det.capacity);
+    for (i = 0; i < MAX_BANDS; ++i) {
+      band_ctx *band = &(d->det.bands[i]);
+      band->blobs = d->det.blobs;
+      alloc_ranges(&(band->current), (w / 2) + 1);
+      alloc_ranges(&(band->next), (w / 2) + 1);
+      alloc_ranges(&(band->top), (w / 2) + 1);
+      band->row_buf = (unsigned char *)ltr_int_my_malloc(w);
+    }
   }
+  setup_bands(d, 1);
   if (img_dbg_flag == DBG_CHECK) {
     img_dbg_flag = ltr_int_get_dbg_flag('p');
   }
+  if ((d->det.threads > 1) && (d->pool.num_threads == 0)) {
+    start_pool(d, d->det.threads - 1);
+  }
 }
 
-void ltr_int_cleanup_after_processing() {
-  if (current.ranges != NULL) {
-    free(current.ranges);
-    current.ranges = NULL;
+void ltr_int_detector_set_threads(ltr_blob_detector_t *d, int threads) {
+  threads = (threads < 1) ? 1 : threads;
+  threads = (threads > MAX_BANDS) ? MAX_BANDS : threads;
+  if (threads == d->det.threads) {
+    return;
   }
-  if (next.ranges != NULL) {
-    free(next.ranges);
-    next.ranges = NULL;
+  d->det.threads = threads;
+  stop_pool(d);
+  if ((threads > 1) && (d->det.blobs != NULL)) {
+    start_pool(d, threads - 1);
   }
-  current.limit = 0;
-  next.limit = 0;
 }
 
-void ltr_int_to_stripes(image_t *img) {
-  assert(img != NULL);
-  int x, y;
-  unsigned char *ptr;
+void ltr_int_detector_cleanup(ltr_blob_detector_t *d) {
+  int i;
+  if (d->roi.stats.frames > 0) {
+    ltr_int_log_message(
+        "ROI: %lu of %lu frames windowed; full scans forced by lost blobs %lu,"
+        " blobs leaving windows %lu, interval %lu\n",
+        d->roi.stats.roi_frames, d->roi.stats.frames, d->roi.stats.fallback_missing,
+        d->roi.stats.fallback_edge, d->roi.stats.fallback_interval);
+  }
+  memset(&d->roi.stats, 0, sizeof(d->roi.stats));
+  d->roi.locked = false;
+  d->roi.scanning = false;
+  stop_pool(d);
+  for (i = 0; i < MAX_BANDS; ++i) {
+    band_ctx *band = &(d->det.bands[i]);
+    free_ranges(&(band->current));
+    free_ranges(&(band->next));
+    free_ranges(&(band->top));
+    free(band->row_buf);
+    band->row_buf = NULL;
+    band->blobs = NULL;
+    band->first = band->end = band->used = 0;
+    band->current_vline = -2;
+  }
+  free(d->det.blobs);
+  d->det.blobs = NULL;
+  d->det.capacity = 0;
+  d->det.num_bands = 1;
+  ltr_int_detector_keep_stripe_runs(d, false);
+}
+
+void ltr_int_detector_keep_stripe_runs(ltr_blob_detector_t *d, bool keep) {
+  int i;
+  if (keep == (d->det.runs != NULL)) {
+    return;
+  }
+  if (keep) {
+    d->det.runs = (ltr_stripe_run_t *)ltr_int_my_malloc(sizeof(ltr_stripe_run_t) *
+                                                     MAX_KEPT_RUNS);
+  } else {
+    free(d->det.runs);
+    d->det.runs = NULL;
+  }
+  d->det.num_runs = 0;
+  d->det.runs_truncated = false;
+  for (i = 0; i < d->det.num_bands; ++i) {
+    band_ctx *band = &(d->det.bands[i]);
+    band->runs = (d->det.runs != NULL) ? d->det.runs + (i * band->max_runs) : NULL;
+    band->num_runs = 0;
+  }
+}
+
+unsigned int ltr_int_detector_get_stripe_runs(ltr_blob_detector_t *d,
+                                              const ltr_stripe_run_t **runs,
+                                              bool *truncated) {
+  *runs = d->det.runs;
+  *truncated = d->det.runs_truncated;
+  return d->det.num_runs;
+}
+
+// Pixels above threshold are lit; thresholded rows come with threshold 0
+static void span_to_stripes(band_ctx *band, const unsigned char *row, int y,
+                            int x1, int x2, unsigned int threshold,
+                            image_t *img) {
+  int x;
+  const unsigned char *ptr = row + x1;
   bool in_stripe = false;
   stripe_t stripe;
 
+  for (x = x1; x <= x2; ++x) {
+    if (*ptr > threshold) {
+      if (in_stripe) {
+        ++stripe.points;
+        stripe.hstop = x;
+        stripe.sum += *ptr;
+        stripe.sum_x += ((*ptr) * stripe.points);
+      } else {
+        stripe.points = 0;
+        stripe.vline = y;
+        stripe.hstart = x;
+        stripe.hstop = x;
+        stripe.sum_x = 0;
+        stripe.sum = *ptr;
+        in_stripe = true;
+      }
+    } else {
+      if (in_stripe) {
+        ++stripe.points;
+        in_stripe = false;
+        // printf("Stripe: y: %1d, from %1d to %1d, %1d points;\n",
+        //        stripe.vline, stripe.hstart, stripe.hstop, stripe.points);
+        // printf("sum: %6d, sum_x: %6d\n", stripe.sum, stripe.sum_x);
+        band_add_stripe(band, &stripe, img);
+      }
+    }
+    ptr++;
+  }
+  if (in_stripe) {
+    ++stripe.points;
+    band_add_stripe(band, &stripe, img);
+  }
+}
+
+void ltr_int_detector_row_to_stripes(ltr_blob_detector_t *d,
+                                     const unsigned char *row, int y,
+                                     image_t *img) {
+  assert(row != NULL);
+  assert(img != NULL);
+  span_to_stripes(&(d->det.bands[0]), row, y, 0, img->w - 1, 0, img);
+}
+
+void ltr_int_detector_to_stripes(ltr_blob_detector_t *d, image_t *img) {
+  assert(img != NULL);
+
 #ifdef DBG_MSG
   printf(">\n");
 #endif
 
-  for (y = 0; y < img->h; ++y) {
-    ptr = img->bitmap + (y * img->w);
-    for (x = 0; x < img->w; ++x) {
-      if (*ptr != 0) {
-        if (in_stripe) {
-          ++stripe.points;
-          stripe.hstop = x;
-          stripe.sum += *ptr;
-          stripe.sum_x += ((*ptr) * stripe.points);
-        } else {
-          stripe.points = 0;
-          stripe.vline = y;
-          stripe.hstart = x;
-          stripe.hstop = x;
-          stripe.sum_x = 0;
-          stripe.sum = *ptr;
-          in_stripe = true;
-        }
-      } else {
-        if (in_stripe) {
-          ++stripe.points;
-          in_stripe = false;
-          // printf("Stripe: y: %1d, from %1d to %1d, %1d points;\n",
-          //        stripe.vline, stripe.hstart, stripe.hstop, stripe.points);
-          // printf("sum: %6d, sum_x: %6d\n", stripe.sum, stripe.sum_x);
-          ltr_int_add_stripe(&stripe, img);
-        }
+  band_job job = {.src = NULL, .img = img};
+  scan_bands(d, &job);
+  // printf("\n");
+}
+
+void ltr_int_detector_set_roi(ltr_blob_detector_t *d, bool enabled,
+                              int padding, int interval) {
+  if (d->roi.enabled != enabled) {
+    d->roi.locked = false;
+  }
+  d->roi.enabled = enabled;
+  d->roi.padding = (padding < 1) ? 1 : padding;
+  d->roi.interval = (interval < 1) ? 1 : interval;
+}
+
+void ltr_int_detector_get_roi_stats(ltr_blob_detector_t *d,
+                                    ltr_int_roi_stats_t *stats) {
+  assert(stats != NULL);
+  *stats = d->roi.stats;
+}
+
+// Decides whether the coming frame can be scanned through the windows only
+static bool roi_begin_frame(ltr_blob_detector_t *d, image_t *img) {
+  d->roi.scanning = false;
+  if ((!d->roi.enabled) || (!d->roi.locked) || (img->bitmap != NULL)) {
+    return false;
+  }
+  if (d->roi.since_full >= d->roi.interval) {
+    ++d->roi.stats.fallback_interval;
+    return false;
+  }
+  d->roi.scanning = true;
+  return true;
+}
+
+// Merged horizontal spans of all windows crossing line y, left to right
+static int roi_row_spans(ltr_blob_detector_t *d, int y, window_t *spans) {
+  int i, j, n = 0;
+  for (i = 0; i < d->roi.num_windows; ++i) {
+    window_t *w = &(d->roi.windows[i]);
+    if ((y < w->y1) || (y > w->y2)) {
+      continue;
+    }
+    // insertion sort by x1
+    for (j = n; (j > 0) && (spans[j - 1].x1 > w->x1); --j) {
+      spans[j] = spans[j - 1];
+    }
+    spans[j] = *w;
+    ++n;
+  }
+  for (i = 1, j = 0; i < n; ++i) {
+    if (spans[i].x1 <= spans[j].x2 + 1) {
+      if (spans[i].x2 > spans[j].x2) {
+        spans[j].x2 = spans[i].x2;
       }
-      ptr++;
+    } else {
+      spans[++j] = spans[i];
     }
-    if (in_stripe) {
-      ++stripe.points;
-      in_stripe = false;
-      // printf("Stripe: y: %1d, from %1d to %1d, %1d points;\n",
-      //        stripe.vline, stripe.hstart, stripe.hstop, stripe.points);
-      // printf("sum: %6d, sum_x: %6d\n", stripe.sum, stripe.sum_x);
-      ltr_int_add_stripe(&stripe, img);
-      in_stripe = false;
+  }
+  return (n > 0) ? j + 1 : 0;
+}
+
+void ltr_int_detector_scan_frame(ltr_blob_detector_t *d,
+                                 const unsigned char *src, size_t stride,
+                                 size_t bpp, int rows,
+                                 ltr_int_bw_kernel_t kernel,
+                                 unsigned int threshold,
+                                 unsigned char *row_buf, image_t *img) {
+  assert(src != NULL);
+  assert(img != NULL);
+  // scanning in place leaves nothing to draw the bitmap from
+  assert((kernel != NULL) || ((img->bitmap == NULL) && (bpp == 1)));
+  int y, i;
+  if (rows > img->h) {
+    rows = img->h;
+  }
+  if (!roi_begin_frame(d, img)) {
+    if (rows == img->h) {
+      band_job job = {.src = src,
+                      .stride = stride,
+                      .kernel = kernel,
+                      .threshold = threshold,
+                      .img = img};
+      scan_bands(d, &job);
+      return;
+    }
+    // short frame
+    for (y = 0; y < rows; ++y) {
+      if (kernel == NULL) {
+        span_to_stripes(&(d->det.bands[0]), src + y * stride, y, 0, img->w - 1,
+                        threshold, img);
+        continue;
+      }
+      unsigned char *row =
+          (img->bitmap != NULL) ? img->bitmap + (y * img->w) : row_buf;
+      kernel(src + y * stride, row, img->w, threshold);
+      ltr_int_detector_row_to_stripes(d, row, y, img);
+    }
+    if (img->bitmap != NULL) {
+      memset(img->bitmap + (rows * img->w), 0, (img->h - rows) * img->w);
+    }
+    return;
+  }
+  int y1 = img->h, y2 = -1;
+  for (i = 0; i < d->roi.num_windows; ++i) {
+    y1 = (d->roi.windows[i].y1 < y1) ? d->roi.windows[i].y1 : y1;
+    y2 = (d->roi.windows[i].y2 > y2) ? d->roi.windows[i].y2 : y2;
+  }
+  y2 = (y2 >= rows) ? rows - 1 : y2;
+  window_t spans[MAX_BLOBS];
+  for (y = y1; y <= y2; ++y) {
+    int n = roi_row_spans(d, y, spans);
+    for (i = 0; i < n; ++i) {
+      if (kernel == NULL) {
+        span_to_stripes(&(d->det.bands[0]), src + y * stride, y, spans[i].x1,
+                        spans[i].x2, threshold, img);
+        continue;
+      }
+      kernel(src + y * stride + spans[i].x1 * bpp, row_buf + spans[i].x1,
+             spans[i].x2 - spans[i].x1 + 1, threshold);
+      span_to_stripes(&(d->det.bands[0]), row_buf, y, spans[i].x1, spans[i].x2, 0,
+                      img);
     }
   }
-  // printf("\n");
 }
 
-int ltr_int_stripes_to_blobs(unsigned int num_blobs, struct bloblist_type *blt,
-                             int min_pts, int max_pts, image_t *img) {
-  store_preblobs(true);
-  current.limit = 0;
-  next.limit = 0;
-  current_vline = -2;
-  if (preblobs == NULL) {
+// A blob is trusted only when it lies strictly inside some window
+//   (or reaches the border of the sensor).
+static bool roi_blob_inside(ltr_blob_detector_t *d, preblob_t *pb,
+                            image_t *img) {
+  int i;
+  for (i = 0; i < d->roi.num_windows; ++i) {
+    window_t *w = &(d->roi.windows[i]);
+    if (((int)pb->x1 > w->x1 || w->x1 == 0) &&
+        ((int)pb->x2 < w->x2 || w->x2 == img->w - 1) &&
+        ((int)pb->y1 > w->y1 || w->y1 == 0) &&
+        ((int)pb->y2 < w->y2 || w->y2 == img->h - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void clip_window(window_t *w, image_t *img) {
+  clip_coord(&(w->x1), 0, img->w - 1);
+  clip_coord(&(w->x2), 0, img->w - 1);
+  clip_coord(&(w->y1), 0, img->h - 1);
+  clip_coord(&(w->y2), 0, img->h - 1);
+}
+
+// Sets up windows for the next frame from the blobs found in this one
+static void roi_end_frame(ltr_blob_detector_t *d, preblob_t **found, unsigned int num_found,
+                          unsigned int valid, unsigned int expected,
+                          image_t *img) {
+  unsigned int i;
+  ++d->roi.stats.frames;
+  if (!d->roi.enabled) {
+    return;
+  }
+  if (d->roi.scanning) {
+    ++d->roi.stats.roi_frames;
+    ++d->roi.since_full;
+    d->roi.scanning = false;
+    if (valid < expected) {
+      ++d->roi.stats.fallback_missing;
+      d->roi.locked = false;
+      return;
+    }
+    for (i = 0; i < num_found; ++i) {
+      if (!roi_blob_inside(d, found[i], img)) {
+        ++d->roi.stats.fallback_edge;
+        d->roi.locked = false;
+        return;
+      }
+    }
+  } else {
+    d->roi.since_full = 0;
+  }
+  if ((expected == 0) || (valid < expected)) {
+    d->roi.locked = false;
+    return;
+  }
+  d->roi.num_windows = num_found;
+  for (i = 0; i < num_found; ++i) {
+    window_t *w = &(d->roi.windows[i]);
+    w->x1 = (int)found[i]->x1 - d->roi.padding;
+    w->x2 = (int)found[i]->x2 + d->roi.padding;
+    w->y1 = (int)found[i]->y1 - d->roi.padding;
+    w->y2 = (int)found[i]->y2 + d->roi.padding;
+    clip_window(w, img);
+  }
+  d->roi.locked = true;
+}
+
+int ltr_int_detector_stripes_to_blobs(ltr_blob_detector_t *d,
+                                      unsigned int num_blobs,
+                                      struct bloblist_type *blt, int min_pts,
+                                      int max_pts, image_t *img) {
+  if (d->det.blobs == NULL) {
     return -1;
   }
+  int b;
+  unsigned int dropped = 0;
+  for (b = 0; b < d->det.num_bands; ++b) {
+    dropped += d->det.bands[b].dropped;
+  }
+  if (dropped > 0) {
+    ltr_int_log_message("Too many stripes, %u of them ignored!\n", dropped);
+  }
   unsigned int counter = 0;
   unsigned int valid = 0;
-  iterator i;
+  unsigned int label;
   struct blob_type *cal_b;
   preblob_t *pb;
-  ltr_int_init_iterator(preblobs, &i);
-  while ((pb = (preblob_t *)ltr_int_get_next(&i)) != NULL) {
-    if ((pb->points < min_pts) || (pb->points > max_pts)) {
-      continue;
-    }
-    ++valid;
-    if (counter < num_blobs) {
-      // printf("sum_x %g   sum_y %g   sum %d\n", pb->sum_x, pb->sum_y,
-      // pb->sum);
-      float x = pb->sum_x / pb->sum;
-      float y = pb->sum_y / pb->sum;
-      // printf("%f\t\t%f\t\t%d\n", x, y, pb->points);
-      cal_b = &(blt->blobs[counter]);
-      cal_b->x = (((img->w - 1) / 2.0) - (x / img->ratio));
-      cal_b->y = (((img->h - 1) / 2.0) - y);
-      if (img_dbg_flag == DBG_ON) {
-        ltr_int_log_message("PT: %g %g\n", cal_b->x, cal_b->y);
+  preblob_t *found[MAX_BLOBS];
+  for (b = 0; b < d->det.num_bands; ++b) {
+    for (label = d->det.bands[b].first; label < d->det.bands[b].used; ++label) {
+      pb = &(d->det.blobs[label]);
+      if (pb->parent != label) {
+        continue;
+      }
+      if ((pb->points < (unsigned int)min_pts) ||
+          (pb->points > (unsigned int)max_pts)) {
+        continue;
       }
-      if (img->bitmap != NULL) {
-        if (counter < blt->expected_blobs) {
-          ltr_int_draw_cross(img, x / img->ratio, y, (int)img->w / 50.0);
-        } else {
-          ltr_int_draw_cross(img, x / img->ratio, y, (int)img->w / 100.0);
+      ++valid;
+      if (counter < num_blobs) {
+        float x = (double)pb->sum_x / pb->sum;
+        float y = (double)pb->sum_y / pb->sum;
+        // printf("%f\t\t%f\t\t%d\n", x, y, pb->points);
+        cal_b = &(blt->blobs[counter]);
+        cal_b->x = (((img->w - 1) / 2.0) - (x / img->ratio));
+        cal_b->y = (((img->h - 1) / 2.0) - y);
+        if (img_dbg_flag == DBG_ON) {
+          ltr_int_log_message("PT: %g %g\n", cal_b->x, cal_b->y);
+        }
+        if (img->bitmap != NULL) {
+          if (counter < blt->expected_blobs) {
+            ltr_int_draw_cross(img, x / img->ratio, y, (int)img->w / 50.0);
+          } else {
+            ltr_int_draw_cross(img, x / img->ratio, y, (int)img->w / 100.0);
+          }
+        }
+        cal_b->score = pb->points;
+        if (counter < MAX_BLOBS) {
+          found[counter] = pb;
         }
       }
-      cal_b->score = pb->points;
+      ++counter;
     }
-    ++counter;
   }
-  ltr_int_free_list(preblobs, true);
-  preblobs = NULL;
+  unsigned int num_found = (counter < num_blobs) ? counter : num_blobs;
+  roi_end_frame(d, found, (num_found < MAX_BLOBS) ? num_found : MAX_BLOBS, valid,
+                blt->expected_blobs, img);
+  collect_runs(d);
+  setup_bands(d, 1);
   blt->num_blobs = (valid > num_blobs) ? num_blobs : valid;
   // printf("Have %d blobs!\n", blt->num_blobs);
   if ((img_dbg_flag == DBG_ON) && (img->bitmap != NULL)) {
@@ -501,3 +1152,90 @@ int ltr_int_stripes_to_blobs(unsigned int num_blobs, struct bloblist_type *blt,
   }
   return 0;
 }
+
+ltr_blob_detector_t *ltr_int_detector_create(void) {
+  ltr_blob_detector_t *d =
+      (ltr_blob_detector_t *)ltr_int_my_malloc(sizeof(ltr_blob_detector_t));
+  detector_init(d);
+  return d;
+}
+
+void ltr_int_detector_free(ltr_blob_detector_t *d) {
+  if (d == NULL) {
+    return;
+  }
+  ltr_int_detector_cleanup(d);
+  pthread_mutex_destroy(&(d->pool.mx));
+  pthread_cond_destroy(&(d->pool.start_cv));
+  pthread_cond_destroy(&(d->pool.done_cv));
+  free(d);
+}
+
+/*********************************************/
+/* The process wide detector the drivers use */
+/*********************************************/
+
+static ltr_blob_detector_t default_det;
+static pthread_once_t default_det_once = PTHREAD_ONCE_INIT;
+
+static void default_det_init(void) { detector_init(&default_det); }
+
+static ltr_blob_detector_t *default_detector(void) {
+  pthread_once(&default_det_once, default_det_init);
+  return &default_det;
+}
+
+void ltr_int_prepare_for_processing(int w, int h) {
+  ltr_int_detector_prepare(default_detector(), w, h);
+}
+
+void ltr_int_cleanup_after_processing() {
+  ltr_int_detector_cleanup(default_detector());
+}
+
+void ltr_int_to_stripes(image_t *img) {
+  ltr_int_detector_to_stripes(default_detector(), img);
+}
+
+void ltr_int_row_to_stripes(const unsigned char *row, int y, image_t *img) {
+  ltr_int_detector_row_to_stripes(default_detector(), row, y, img);
+}
+
+int ltr_int_stripes_to_blobs(unsigned int num_blobs, struct bloblist_type *blt,
+                             int min_pts, int max_pts, image_t *img) {
+  return ltr_int_detector_stripes_to_blobs(default_detector(), num_blobs, blt,
+                                           min_pts, max_pts, img);
+}
+
+bool ltr_int_add_stripe(stripe_t *stripe, image_t *img) {
+  return ltr_int_detector_add_stripe(default_detector(), stripe, img);
+}
+
+void ltr_int_scan_frame(const unsigned char *src, size_t stride, size_t bpp,
+                        int rows, ltr_int_bw_kernel_t kernel,
+                        unsigned int threshold, unsigned char *row_buf,
+                        image_t *img) {
+  ltr_int_detector_scan_frame(default_detector(), src, stride, bpp, rows,
+                              kernel, threshold, row_buf, img);
+}
+
+void ltr_int_set_roi(bool enabled, int padding, int interval) {
+  ltr_int_detector_set_roi(default_detector(), enabled, padding, interval);
+}
+
+void ltr_int_get_roi_stats(ltr_int_roi_stats_t *stats) {
+  ltr_int_detector_get_roi_stats(default_detector(), stats);
+}
+
+void ltr_int_set_processing_threads(int threads) {
+  ltr_int_detector_set_threads(default_detector(), threads);
+}
+
+void ltr_int_keep_stripe_runs(bool keep) {
+  ltr_int_detector_keep_stripe_runs(default_detector(), keep);
+}
+
+unsigned int ltr_int_get_stripe_runs(const ltr_stripe_run_t **runs,
+                                     bool *truncated) {
+  return ltr_int_detector_get_stripe_runs(default_detector(), runs, truncated);
+}
@@ -6,7 +6,9 @@ extern "C" {
 #endif
 
 #include "cal.h"
+#include "image_convert.h"
 #include "list.h"
+#include "stripe_stream.h"
 
 typedef struct {
   unsigned int vline;
@@ -26,9 +28,79 @@ typedef struct {
 void ltr_int_prepare_for_processing(int w, int h);
 void ltr_int_cleanup_after_processing();
 void ltr_int_to_stripes(image_t *img);
+// Feeds one thresholded row to the blob detector; img->bitmap may be NULL
+void ltr_int_row_to_stripes(const unsigned char *row, int y, image_t *img);
 int ltr_int_stripes_to_blobs(unsigned int num_blobs, struct bloblist_type *blt, 
 		     int min_pts, int max_pts, image_t *img);
 bool ltr_int_add_stripe(stripe_t *stripe, image_t *img);
+// Thresholds a captured frame with kernel row by row and feeds it to the
+//   blob detector; stride is the source line length, bpp source bytes per
+//   pixel. Without img->bitmap the rows go through row_buf (img->w bytes),
+//   and with ROI tracking locked on only the windows are scanned.
+//   An 8bit luma source may come with NULL kernel when img->bitmap is NULL;
+//   it is then thresholded in place, without converting a single row.
+void ltr_int_scan_frame(const unsigned char *src, size_t stride, size_t bpp,
+                        int rows, ltr_int_bw_kernel_t kernel,
+                        unsigned int threshold, unsigned char *row_buf,
+                        image_t *img);
+
+typedef struct {
+  unsigned long frames;            // frames processed
+  unsigned long roi_frames;        // frames scanned only inside the windows
+  unsigned long fallback_missing;  // full scans forced by lost blobs
+  unsigned long fallback_edge;     // full scans forced by blobs leaving windows
+  unsigned long fallback_interval; // periodic full scans
+} ltr_int_roi_stats_t;
+
+void ltr_int_set_roi(bool enabled, int padding, int interval);
+void ltr_int_get_roi_stats(ltr_int_roi_stats_t *stats);
+
+// Full frame scans are split into this many horizontal bands, each labeled
+//   by its own thread (1 - serial, at most 8)
+void ltr_int_set_processing_threads(int threads);
+
+// Keeps the runs of lit pixels of every frame for the stripe stream; they
+//   stay valid until the next frame is processed. Both belong to the
+//   thread scanning the frames.
+void ltr_int_keep_stripe_runs(bool keep);
+unsigned int ltr_int_get_stripe_runs(const ltr_stripe_run_t **runs,
+                                     bool *truncated);
+
+// An independent blob detector; the functions above all work on one
+//   process wide instance, these on the one given, so several detectors
+//   can process frames at once (each from its own thread).
+typedef struct ltr_blob_detector ltr_blob_detector_t;
+
+ltr_blob_detector_t *ltr_int_detector_create(void);
+void ltr_int_detector_free(ltr_blob_detector_t *d);
+void ltr_int_detector_prepare(ltr_blob_detector_t *d, int w, int h);
+void ltr_int_detector_cleanup(ltr_blob_detector_t *d);
+void ltr_int_detector_to_stripes(ltr_blob_detector_t *d, image_t *img);
+void ltr_int_detector_row_to_stripes(ltr_blob_detector_t *d,
+                                     const unsigned char *row, int y,
+                                     image_t *img);
+int ltr_int_detector_stripes_to_blobs(ltr_blob_detector_t *d,
+                                      unsigned int num_blobs,
+                                      struct bloblist_type *blt, int min_pts,
+                                      int max_pts, image_t *img);
+bool ltr_int_detector_add_stripe(ltr_blob_detector_t *d, stripe_t *stripe,
+                                 image_t *img);
+void ltr_int_detector_scan_frame(ltr_blob_detector_t *d,
+                                 const unsigned char *src, size_t stride,
+                                 size_t bpp, int rows,
+                                 ltr_int_bw_kernel_t kernel,
+                                 unsigned int threshold,
+                                 unsigned char *row_buf, image_t *img);
+void ltr_int_detector_set_roi(ltr_blob_detector_t *d, bool enabled,
+                              int padding, int interval);
+void ltr_int_detector_get_roi_stats(ltr_blob_detector_t *d,
+                                    ltr_int_roi_stats_t *stats);
+void ltr_int_detector_set_threads(ltr_blob_detector_t *d, int threads);
+void ltr_int_detector_keep_stripe_runs(ltr_blob_detector_t *d, bool keep);
+unsigned int ltr_int_detector_get_stripe_runs(ltr_blob_detector_t *d,
+                                              const ltr_stripe_run_t **runs,
+                                              bool *truncated);
+
 void ltr_int_draw_cross(image_t *img, int x, int y, int size);
 void ltr_int_draw_empty_square(image_t *img, int x1, int y1, int x2, int y2);
 void ltr_int_draw_square(image_t *img, int x, int y, int size);
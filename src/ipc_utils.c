@@ -19,8 +19,14 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <string.h>
+#include <limits.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#ifdef __linux__
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+  #include <time.h>
+#endif
 
 #include "ipc_utils.h"
 #include "utils.h"
@@ -210,6 +216,95 @@ bool ltr_int_unlockSemaphore(semaphore_p semaphore)
   }
 }
 
+//Sequence counter protocol for data shared through mmap: the counter is odd
+//  while the single writer is updating, readers retry until they copy the
+//  data between two identical even values.
+#define SEQ_READ_ATTEMPTS 64
+
+void ltr_int_seq_write_begin(uint32_t *seq)
+{
+  uint32_t s = __atomic_load_n(seq, __ATOMIC_RELAXED);
+  __atomic_store_n(seq, s + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void ltr_int_seq_write_end(uint32_t *seq)
+{
+  uint32_t s = __atomic_load_n(seq, __ATOMIC_RELAXED);
+  __atomic_store_n(seq, s + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t ltr_int_seq_read_begin(const uint32_t *seq)
+{
+  return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+bool ltr_int_seq_read_end(const uint32_t *seq, uint32_t start)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return ((start & 1) == 0) && (__atomic_load_n(seq, __ATOMIC_RELAXED) == start);
+}
+
+bool ltr_int_seq_read(const uint32_t *seq, void *dest, const void *src, size_t size)
+{
+  int i;
+  for(i = 0; i < SEQ_READ_ATTEMPTS; ++i){
+    uint32_t s1 = ltr_int_seq_read_begin(seq);
+    if(s1 & 1){
+      continue;
+    }
+    memcpy(dest, src, size);
+    if(ltr_int_seq_read_end(seq, s1)){
+      return true;
+    }
+  }
+  return false;
+}
+
+//The futex lives in memory shared between processes, so no FUTEX_PRIVATE_FLAG
+int ltr_int_futex_wait(uint32_t *addr, uint32_t val, int timeout)
+{
+#ifdef __linux__
+  struct timespec ts;
+  struct timespec *pts = NULL;
+  if(timeout >= 0){
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000L;
+    pts = &ts;
+  }
+  if(syscall(SYS_futex, addr, FUTEX_WAIT, val, pts, NULL, 0) == 0){
+    return 1;
+  }
+  if(errno == ETIMEDOUT){
+    return 0;
+  }
+  if((errno == EAGAIN) || (errno == EINTR)){
+    return 1;
+  }
+  return -1;
+#else
+  //no futexes here; poll the word instead
+  int slept = 0;
+  while(__atomic_load_n(addr, __ATOMIC_ACQUIRE) == val){
+    if((timeout >= 0) && (slept >= timeout)){
+      return 0;
+    }
+    usleep(1000);
+    ++slept;
+  }
+  return 1;
+#endif
+}
+
+void ltr_int_futex_wake(uint32_t *addr)
+{
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+  (void)addr;
+#endif
+}
+
 void ltr_int_closeSemaphore(semaphore_p semaphore)
 {
   ltr_int_log_message("Closing semaphore %d (pid %d)!\n", semaphore->fd, getpid());
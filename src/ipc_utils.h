@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifndef LIBLINUXTRACK_SRC
   #define LIBLINUXTRACK_PRIVATE
@@ -36,6 +37,21 @@ bool ltr_int_testLockSemaphore(semaphore_p semaphore);
 bool ltr_int_unlockSemaphore(semaphore_p semaphore);
 void ltr_int_closeSemaphore(semaphore_p semaphore);
 
+void ltr_int_seq_write_begin(uint32_t *seq);
+void ltr_int_seq_write_end(uint32_t *seq);
+//Returns false if the writer kept changing the data the whole time
+bool ltr_int_seq_read(const uint32_t *seq, void *dest, const void *src, size_t size);
+//For data copied in several pieces: the copy is valid when begin returned
+//  an even value and end gets it back unchanged
+uint32_t ltr_int_seq_read_begin(const uint32_t *seq);
+bool ltr_int_seq_read_end(const uint32_t *seq, uint32_t start);
+//Sleeps while *addr holds val (timeout in ms, negative waits forever);
+//  returns 1 when woken or the value changed, 0 on timeout, -1 on error
+//  Anything but Linux has no futexes and polls the word every ms, so long
+//  lived waiters there need another wakeup.
+int ltr_int_futex_wait(uint32_t *addr, uint32_t val, int timeout);
+void ltr_int_futex_wake(uint32_t *addr);
+
 bool ltr_int_mmap_file(const char *name, size_t tmp_size, struct mmap_s *m);
 LIBLINUXTRACK_PRIVATE bool ltr_int_mmap_file_exclusive(size_t tmp_size, struct mmap_s *m);
 LIBLINUXTRACK_PRIVATE bool ltr_int_unmap_file(struct mmap_s *m);
@@ -0,0 +1,139 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ipc_utils.h"
+#include "latency_trace.h"
+#include "utils.h"
+
+#define TRACE_MAGIC 0x4C545254
+
+enum { TRACE_UNKNOWN, TRACE_OFF, TRACE_ON };
+
+static int trace_state = TRACE_UNKNOWN;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static struct mmap_s trace_mmap;
+static ltr_trace_region_t *region = NULL;
+
+static const char *stage_names[LTR_TRACE_STAGES] = {
+    "dequeue", "threshold", "blobs",       "update_pose",
+    "broadcast", "postprocess", "client_read"};
+
+const char *ltr_int_trace_stage_name(ltr_trace_stage_t stage) {
+  return (stage < LTR_TRACE_STAGES) ? stage_names[stage] : "unknown";
+}
+
+static unsigned int bucket_index(unsigned int us) {
+  if (us < 16) {
+    return us;
+  }
+  unsigned int e = 31 - __builtin_clz(us);
+  unsigned int b = 16 + (e - 4) * 8 + ((us >> (e - 3)) & 7);
+  return (b < LTR_TRACE_BUCKETS) ? b : LTR_TRACE_BUCKETS - 1;
+}
+
+static unsigned int bucket_top(unsigned int b) {
+  if (b < 16) {
+    return b;
+  }
+  unsigned int e = 4 + (b - 16) / 8;
+  unsigned int sub = (b - 16) % 8;
+  return ((8 + sub + 1) << (e - 3)) - 1;
+}
+
+void ltr_int_trace_hist_add(ltr_trace_hist_t *hist, unsigned int us) {
+  __atomic_fetch_add(&hist->buckets[bucket_index(us)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->sum_us, us, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+  uint64_t max = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+  while ((us > max) &&
+         !__atomic_compare_exchange_n(&hist->max_us, &max, us, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+unsigned int ltr_int_trace_hist_percentile(const ltr_trace_hist_t *hist,
+                                           double percentile) {
+  uint64_t count = 0;
+  uint64_t buckets[LTR_TRACE_BUCKETS];
+  unsigned int b;
+  // counters keep moving while we read them; work on a snapshot
+  for (b = 0; b < LTR_TRACE_BUCKETS; ++b) {
+    buckets[b] = __atomic_load_n(&hist->buckets[b], __ATOMIC_RELAXED);
+    count += buckets[b];
+  }
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (b = 0; b < LTR_TRACE_BUCKETS - 1; ++b) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  unsigned int top = bucket_top(b);
+  uint64_t max = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+  return (top < max) ? top : (unsigned int)max;
+}
+
+void ltr_int_trace_reset(ltr_trace_region_t *r) {
+  memset(r->stages, 0, sizeof(r->stages));
+}
+
+ltr_trace_region_t *ltr_int_trace_map(void) {
+  char *fname = ltr_int_get_default_file_name(LTR_TRACE_FILE);
+  if (fname == NULL) {
+    return NULL;
+  }
+  bool res =
+      ltr_int_mmap_file(fname, sizeof(ltr_trace_region_t), &trace_mmap);
+  free(fname);
+  if (!res) {
+    return NULL;
+  }
+  ltr_trace_region_t *r = (ltr_trace_region_t *)trace_mmap.data;
+  ltr_int_lockSemaphore(trace_mmap.sem);
+  if ((r->magic != TRACE_MAGIC) || (r->size != sizeof(ltr_trace_region_t))) {
+    ltr_int_trace_reset(r);
+    r->size = sizeof(ltr_trace_region_t);
+    r->magic = TRACE_MAGIC;
+  }
+  ltr_int_unlockSemaphore(trace_mmap.sem);
+  return r;
+}
+
+static void trace_init(void) {
+  int state = TRACE_OFF;
+  if (ltr_int_get_dbg_flag('l') == DBG_ON) {
+    region = ltr_int_trace_map();
+    if (region != NULL) {
+      ltr_int_log_message("Latency tracing enabled\n");
+      state = TRACE_ON;
+    } else {
+      ltr_int_log_message("Can't map the latency trace file!\n");
+    }
+  }
+  __atomic_store_n(&trace_state, state, __ATOMIC_RELEASE);
+}
+
+bool ltr_int_trace_enabled(void) {
+  int state = __atomic_load_n(&trace_state, __ATOMIC_ACQUIRE);
+  if (state == TRACE_UNKNOWN) {
+    pthread_once(&trace_once, trace_init);
+    state = __atomic_load_n(&trace_state, __ATOMIC_ACQUIRE);
+  }
+  return state == TRACE_ON;
+}
+
+void ltr_int_trace_point(ltr_trace_stage_t stage, int64_t origin) {
+  if (!ltr_int_trace_enabled() || (stage >= LTR_TRACE_STAGES)) {
+    return;
+  }
+  int age = ltr_int_ts_diff(origin, ltr_int_get_ts());
+  ltr_int_trace_hist_add(&region->stages[stage], (age > 0) ? age : 0);
+}
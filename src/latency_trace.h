@@ -0,0 +1,66 @@
+#ifndef LATENCY_TRACE__H
+#define LATENCY_TRACE__H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Trace points along the path of a frame from the camera to the client.
+//   Each point records the age of the frame it handles, measured from the
+//   moment the camera captured it, so the stages show up as growing ages.
+typedef enum {
+  LTR_TRACE_DEQUEUE,     // driver got the buffer
+  LTR_TRACE_THRESHOLD,   // frame thresholded into stripes
+  LTR_TRACE_BLOBS,       // blobs extracted
+  LTR_TRACE_UPDATE_POSE, // pose computed
+  LTR_TRACE_BROADCAST,   // master sent the pose to the slaves
+  LTR_TRACE_POSTPROCESS, // slave filtered the pose for its profile
+  LTR_TRACE_CLIENT_READ, // client read the pose for the first time
+  LTR_TRACE_STAGES
+} ltr_trace_stage_t;
+
+// Log-linear buckets: 1us wide below 16us, then 8 buckets per power of two,
+//   which keeps the percentiles within 12.5% up to ~4s.
+#define LTR_TRACE_BUCKETS 160
+
+typedef struct {
+  uint64_t count;
+  uint64_t sum_us;
+  uint64_t max_us;
+  uint64_t buckets[LTR_TRACE_BUCKETS];
+} ltr_trace_hist_t;
+
+// Layout of the shared trace file; every process on the path adds to it.
+typedef struct {
+  uint32_t magic;
+  uint32_t size;
+  ltr_trace_hist_t stages[LTR_TRACE_STAGES];
+} ltr_trace_region_t;
+
+#define LTR_TRACE_FILE "latency.trace"
+
+// Tracing is on when LINUXTRACK_DBG contains 'l'; otherwise a trace point
+//   costs a load and a branch.
+bool ltr_int_trace_enabled(void);
+// Records the age of a frame captured at origin (ltr_int_get_ts() units)
+void ltr_int_trace_point(ltr_trace_stage_t stage, int64_t origin);
+
+// Maps the shared trace file, initializing it if needed; NULL on failure.
+ltr_trace_region_t *ltr_int_trace_map(void);
+void ltr_int_trace_reset(ltr_trace_region_t *region);
+const char *ltr_int_trace_stage_name(ltr_trace_stage_t stage);
+
+// Lock free, can be called from several processes at once
+void ltr_int_trace_hist_add(ltr_trace_hist_t *hist, unsigned int us);
+// Upper bound of the bucket holding the given percentile (0-100)
+unsigned int ltr_int_trace_hist_percentile(const ltr_trace_hist_t *hist,
+                                           double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -49,6 +49,20 @@ typedef int (*ltr_get_frame_t)(int *req_width, int *req_height, size_t buf_size,
                                uint8_t *buffer);
 typedef int (*ltr_get_notify_pipe_t)(void);
 typedef int (*ltr_wait_t)(int timeout);
+typedef int (*ltr_wait_pose_t)(uint32_t counter, int timeout);
+typedef int (*ltr_get_stripes_t)(size_t buf_size, uint8_t *buffer,
+                                 size_t *size);
+typedef int (*ltr_decode_stripes_t)(const uint8_t *data, size_t size,
+                                    int *width, int *height, size_t img_size,
+                                    uint8_t *img);
+typedef int (*ltr_get_stripe_blobs_t)(const uint8_t *data, size_t size,
+                                      float blobs[], int num_blobs);
+typedef int (*ltr_get_pose_range_t)(int64_t from, int64_t to,
+                                    linuxtrack_timed_pose_t poses[],
+                                    int max_poses);
+typedef int (*ltr_get_pose_at_t)(uint64_t target_ns,
+                                 linuxtrack_predictor_t predictor,
+                                 linuxtrack_pose_t *pose);
 
 static ltr_init_t ltr_init_fun = NULL;
 static ltr_gp_t ltr_shutdown_fun = NULL;
@@ -65,6 +79,12 @@ static ltr_get_frame_t ltr_get_frame_fun = NULL;
 static ltr_gp_t ltr_notification_on_fun = NULL;
 static ltr_get_notify_pipe_t ltr_get_notify_pipe_fun = NULL;
 static ltr_wait_t ltr_wait_fun = NULL;
+static ltr_wait_pose_t ltr_wait_pose_fun = NULL;
+static ltr_get_stripes_t ltr_get_stripes_fun = NULL;
+static ltr_decode_stripes_t ltr_decode_stripes_fun = NULL;
+static ltr_get_stripe_blobs_t ltr_get_stripe_blobs_fun = NULL;
+static ltr_get_pose_range_t ltr_get_pose_range_fun = NULL;
+static ltr_get_pose_at_t ltr_get_pose_at_fun = NULL;
 
 static void *lib_handle = NULL;
 
@@ -90,6 +110,12 @@ static struct func_defs_t functions[] = {
     {(char *)"ltr_notification_on", (void *)&ltr_notification_on_fun, 0},
     {(char *)"ltr_get_notify_pipe", (void *)&ltr_get_notify_pipe_fun, 0},
     {(char *)"ltr_wait", (void *)&ltr_wait_fun, 0},
+    {(char *)"ltr_wait_pose", (void *)&ltr_wait_pose_fun, 0},
+    {(char *)"ltr_get_stripes", (void *)&ltr_get_stripes_fun, 0},
+    {(char *)"ltr_decode_stripes", (void *)&ltr_decode_stripes_fun, 0},
+    {(char *)"ltr_get_stripe_blobs", (void *)&ltr_get_stripe_blobs_fun, 0},
+    {(char *)"ltr_get_pose_range", (void *)&ltr_get_pose_range_fun, 0},
+    {(char *)"ltr_get_pose_at", (void *)&ltr_get_pose_at_fun, 0},
     {(char *)NULL, NULL, 0}};
 
 static const char *lib_locations[] = {
@@ -459,3 +485,54 @@ int linuxtrack_wait(int timeout) {
   }
   return ltr_wait_fun(timeout);
 }
+
+int linuxtrack_wait_pose(uint32_t counter, int timeout) {
+  if (ltr_wait_pose_fun == NULL) {
+    return err_NOT_INITIALIZED;
+  }
+  return ltr_wait_pose_fun(counter, timeout);
+}
+
+int linuxtrack_get_stripes(size_t buf_size, uint8_t *buffer, size_t *size) {
+  if (ltr_get_stripes_fun == NULL) {
+    return err_NOT_INITIALIZED;
+  }
+  return ltr_get_stripes_fun(buf_size, buffer, size);
+}
+
+int linuxtrack_decode_stripes(const uint8_t *data, size_t size, int *width,
+                              int *height, size_t img_size, uint8_t *img) {
+  if (ltr_decode_stripes_fun == NULL) {
+    return err_NOT_INITIALIZED;
+  }
+  return ltr_decode_stripes_fun(data, size, width, height, img_size, img);
+}
+
+int linuxtrack_get_stripe_blobs(const uint8_t *data, size_t size, float blobs[],
+                                int num_blobs) {
+  if (ltr_get_stripe_blobs_fun == NULL) {
+    return err_NOT_INITIALIZED;
+  }
+  return ltr_get_stripe_blobs_fun(data, size, blobs, num_blobs);
+}
+
+int linuxtrack_get_pose_history(linuxtrack_timed_pose_t poses[],
+                                int max_poses) {
+  return linuxtrack_get_pose_range(INT64_MIN, INT64_MAX, poses, max_poses);
+}
+
+int linuxtrack_get_pose_range(int64_t from, int64_t to,
+                              linuxtrack_timed_pose_t poses[], int max_poses) {
+  if (ltr_get_pose_range_fun == NULL) {
+    return err_NOT_INITIALIZED;
+  }
+  return ltr_get_pose_range_fun(from, to, poses, max_poses);
+}
+
+int linuxtrack_get_pose_at(uint64_t target_ns, linuxtrack_predictor_t predictor,
+                           linuxtrack_pose_t *pose) {
+  if (ltr_get_pose_at_fun == NULL) {
+    return err_NOT_INITIALIZED;
+  }
+  return ltr_get_pose_at_fun(target_ns, predictor, pose);
+}
@@ -84,6 +84,16 @@ typedef struct{
   uint8_t status;
 } linuxtrack_pose_t;
 
+typedef struct{
+  int64_t timestamp; //capture time, microseconds of CLOCK_MONOTONIC
+  linuxtrack_pose_t pose;
+} linuxtrack_timed_pose_t;
+
+typedef enum{
+  LINUXTRACK_PREDICT_LINEAR, //from the last two poses
+  LINUXTRACK_PREDICT_ACCEL   //constant acceleration from the last three, clamped
+} linuxtrack_predictor_t;
+
 int linuxtrack_get_pose_full(linuxtrack_pose_t *pose, float blobs[], int num_blobs, int *blobs_read);
 
 int linuxtrack_get_abs_pose(float *heading,
@@ -99,6 +109,33 @@ int linuxtrack_get_frame(int *req_width, int *req_height, size_t buf_size, uint8
 linuxtrack_state_type linuxtrack_notification_on(void);
 int linuxtrack_get_notify_pipe(void);
 int linuxtrack_wait(int timeout);
+//Blocks until the pose counter differs from the one passed in (timeout in ms,
+//  negative means forever); returns 1 on a new pose, 0 on timeout.
+int linuxtrack_wait_pose(uint32_t counter, int timeout);
+//Copies the newest stripe record (the runs of lit pixels and the blobs of a
+//  frame instead of its pixels); returns 1 when copied, 0 otherwise. Size
+//  gets the record size, also when the buffer is too small.
+int linuxtrack_get_stripes(size_t buf_size, uint8_t *buffer, size_t *size);
+//Draws a stripe record as a width x height bitmap; returns 1 on success,
+//  0 when img is too small and -1 on a malformed record.
+int linuxtrack_decode_stripes(const uint8_t *data, size_t size, int *width,
+                              int *height, size_t img_size, uint8_t *img);
+//Reads blobs of a stripe record (x, y, score triplets in image pixels);
+//  returns the number of blobs in the record, -1 on a malformed one.
+int linuxtrack_get_stripe_blobs(const uint8_t *data, size_t size, float blobs[],
+                                int num_blobs);
+//Copies up to max_poses of the latest poses (64 are kept), oldest first;
+//  returns how many were copied.
+int linuxtrack_get_pose_history(linuxtrack_timed_pose_t poses[], int max_poses);
+//Same, only poses captured between from and to (CLOCK_MONOTONIC, in us).
+int linuxtrack_get_pose_range(int64_t from, int64_t to,
+                              linuxtrack_timed_pose_t poses[], int max_poses);
+//Predicts the pose for the time given (CLOCK_MONOTONIC, in ns), e.g. that of
+//  the next vsync, from the capture times of the latest poses; times already
+//  past are interpolated. Returns 1 when the pose is new to the caller
+//  (pose->counter changes), 0 otherwise.
+int linuxtrack_get_pose_at(uint64_t target_ns, linuxtrack_predictor_t predictor,
+                           linuxtrack_pose_t *pose);
 
 #ifdef __cplusplus
 }
@@ -6,16 +6,24 @@
 #include <fcntl.h>
 
 #include "ltlib_int.h"
+#include "frame_channel.h"
+#include "stripe_stream.h"
+#include "pose_history.h"
+#include "pose_predict.h"
 #include "ipc_utils.h"
+#include "latency_trace.h"
 #include "utils.h"
 
 static struct mmap_s mmm;
 static bool initialized = false;
 static int notify_pipe = -1;
+static frame_reader_t frames;
+static int64_t frames_requested = 0;
+static frame_reader_t stripes;
 
 static int make_mmap()
 {
-  if(!ltr_int_mmap_file_exclusive(sizeof(struct mmap_s), &mmm)){
+  if(!ltr_int_mmap_file_exclusive(LTR_COMM_FILE_SIZE, &mmm)){
     ltr_int_my_perror("mmap_file: ");
     ltr_int_log_message("Couldn't mmap!\n");
     return -1;
@@ -44,6 +52,8 @@ static char *ltr_int_init_helper(const char *cust_section, bool standalone)
   struct ltr_comm *com = mmm.data;
   com->state = INITIALIZING;
   com->preparing_start = true;
+  //tells the server we signal commands
+  com->cmd_seq = 1;
   initialized = true;
   if(standalone){
     if(pipe(fd) < 0){
@@ -88,33 +98,16 @@ linuxtrack_state_type ltr_init(const char *cust_section)
   }
 }
 
-static const float c_EXT_LIMIT = 3.0f;
-static const float c_EXT_ASYMPTOTE = 5.0f;
-
-static float ltr_int_extrapolation_factor(int t1, int t2, int now)
+//Copies the channel without any syscall when the server keeps the seq
+//  counter up to date; older servers (or a stalled writer) need the lock.
+static void ltr_int_read_comm(struct ltr_comm *com, struct ltr_comm *tmp)
 {
-  int dt12 = ltr_int_ts_diff(t1, t2);
-  int dt = ltr_int_ts_diff(t2, now);
-  printf("TSdiff: (%d, %d -> %d) -> (%d, %d -> %d)\n", t1, t2, dt12, t2, now, dt);
-  if(dt == 0){
-    printf("  ext = 0.0\n");
-    return 0.0f;
-  }
-  float ext = (float)dt / dt12;
-  //Should the extrapolation go further than c_EXTRAPOLATION_LIMIT
-  //  times the frame interval, start to round out with asymptote
-  //  of c_EXTRAPOLATION_ASYMPTOTE.
-  //Start linear in the interval <0.0; c_EXTRAPOLATION_LIMIT>;
-  //  at c_EXTRAPOLATION_LIMIT switch to -1/x type of curve
-  if(ext > 3){
-    // -1 / x => basic type of curve; we need to get the [1;-1] point
-    //   to [c_EXTRAPOLATION_LIMIT; c_EXTRAPOLATION_LIMIT]
-    // 
-    ext = c_EXT_ASYMPTOTE - 
-         (c_EXT_LIMIT * (c_EXT_ASYMPTOTE - c_EXT_LIMIT)) / ext;
+  if(com->has_seq && ltr_int_seq_read(&(com->seq), tmp, com, sizeof(struct ltr_comm))){
+    return;
   }
-  printf("  ext = %g\n", ext);
-  return ext;
+  ltr_int_lockSemaphore(mmm.sem);
+  *tmp = *com;
+  ltr_int_unlockSemaphore(mmm.sem);
 }
 
 static inline float ltr_int_extrapolate(float v1, float v2, float ext)
@@ -122,11 +115,34 @@ static inline float ltr_int_extrapolate(float v1, float v2, float ext)
   return v2 + (v2 - v1) * ext;
 }
 
+//Capture times of the channel pose; servers predating the 64bit ones only
+//  give the 32bit timestamps, good for the last 1024s.
+static void ltr_int_comm_times(struct ltr_comm *com, int64_t now,
+                               int64_t *prev_ts, int64_t *ts)
+{
+  if(com->version >= 1){
+    *prev_ts = com->prev_timestamp;
+    *ts = com->timestamp;
+  }else{
+    *prev_ts = ltr_int_unwrap_legacy_ts(com->full_pose.prev_timestamp, now);
+    *ts = ltr_int_unwrap_legacy_ts(com->full_pose.timestamp, now);
+  }
+}
+
+static float ltr_int_comm_extrapolation(struct ltr_comm *com)
+{
+  int64_t now = ltr_int_get_ts();
+  int64_t prev_ts, ts;
+  ltr_int_comm_times(com, now, &prev_ts, &ts);
+  return ltr_int_extrapolation_factor(prev_ts, ts, now);
+}
+
 static void ltr_int_extrapolate_pose(
-       linuxtrack_full_pose_t *pose,
+       struct ltr_comm *com,
        linuxtrack_pose_t *result)
 {
-  float ext = ltr_int_extrapolation_factor(pose->prev_timestamp, pose->timestamp, ltr_int_get_ts());
+  ltr_comm_pose_t *pose = &(com->full_pose);
+  float ext = ltr_int_comm_extrapolation(com);
   result->yaw = ltr_int_extrapolate(pose->prev_pose.yaw, pose->pose.yaw, ext);
   result->pitch = ltr_int_extrapolate(pose->prev_pose.pitch, pose->pose.pitch, ext);
   result->roll = ltr_int_extrapolate(pose->prev_pose.roll, pose->pose.roll, ext);
@@ -137,10 +153,11 @@ static void ltr_int_extrapolate_pose(
 
 
 static void ltr_int_extrapolate_abs_pose(
-       linuxtrack_full_pose_t *pose,
+       struct ltr_comm *com,
        linuxtrack_abs_pose_t *result)
 {
-  float ext = ltr_int_extrapolation_factor(pose->prev_timestamp, pose->timestamp, ltr_int_get_ts());
+  ltr_comm_pose_t *pose = &(com->full_pose);
+  float ext = ltr_int_comm_extrapolation(com);
   result->abs_yaw = ltr_int_extrapolate(pose->prev_abs_pose.abs_yaw, pose->abs_pose.abs_yaw, ext);
   result->abs_pitch = ltr_int_extrapolate(pose->prev_abs_pose.abs_pitch, pose->abs_pose.abs_pitch, ext);
   result->abs_roll = ltr_int_extrapolate(pose->prev_abs_pose.abs_roll, pose->abs_pose.abs_roll, ext);
@@ -162,14 +179,11 @@ int ltr_get_pose(float *heading,
   struct ltr_comm *com = mmm.data;
   if((!initialized) || (com == NULL)) return 0;
   struct ltr_comm tmp;
-  ltr_int_lockSemaphore(mmm.sem);
-  tmp = *com;
-  //printf("OTHER_SIDE: %g %g %g\n", tmp.pose.yaw, tmp.pose.pitch, tmp.pose.roll);
-  ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_read_comm(com, &tmp);
   if(tmp.state >= LINUXTRACK_OK){
     uint32_t passed_counter = *counter;
     linuxtrack_pose_t tmp_pose;
-    ltr_int_extrapolate_pose(&(tmp.full_pose), &tmp_pose);
+    ltr_int_extrapolate_pose(&tmp, &tmp_pose);
     *heading = tmp_pose.yaw;
     *pitch = tmp_pose.pitch;
     *roll = tmp_pose.roll;
@@ -178,6 +192,7 @@ int ltr_get_pose(float *heading,
     *tz = tmp_pose.tz;
     *counter = tmp.full_pose.pose.counter;
     if(passed_counter != *counter){
+      ltr_int_trace_point(LTR_TRACE_CLIENT_READ, tmp.timestamp);
       return 1;// flag new data
     }else{
       return 0;
@@ -199,18 +214,17 @@ int ltr_get_pose_full(linuxtrack_pose_t *pose, float blobs[], int num_blobs, int
   struct ltr_comm *com = mmm.data;
   if((!initialized) || (com == NULL)) return 0;
   struct ltr_comm tmp;
-  ltr_int_lockSemaphore(mmm.sem);
-  tmp = *com;
-  ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_read_comm(com, &tmp);
   if(tmp.state >= LINUXTRACK_OK){
     uint32_t prev_counter = pose->counter;
-    ltr_int_extrapolate_pose(&(tmp.full_pose), pose);
+    ltr_int_extrapolate_pose(&tmp, pose);
     *blobs_read = (num_blobs < (int)tmp.full_pose.blobs) ? num_blobs : (int)tmp.full_pose.blobs;
     int i;
     for(i = 0; i < (*blobs_read) * BLOB_ELEMENTS; ++i){
       blobs[i] = tmp.full_pose.blob_list[i];
     }
     if(prev_counter != pose->counter){
+      ltr_int_trace_point(LTR_TRACE_CLIENT_READ, tmp.timestamp);
       return 1;//new data
     }else{
       return 0;
@@ -233,14 +247,11 @@ int ltr_get_abs_pose(float *heading,
   struct ltr_comm *com = mmm.data;
   if((!initialized) || (com == NULL)) return 0;
   struct ltr_comm tmp;
-  ltr_int_lockSemaphore(mmm.sem);
-  tmp = *com;
-  //printf("OTHER_SIDE: %g %g %g\n", tmp.pose.yaw, tmp.pose.pitch, tmp.pose.roll);
-  ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_read_comm(com, &tmp);
   if(tmp.state >= LINUXTRACK_OK){
     uint32_t passed_counter = *counter;
     linuxtrack_abs_pose_t tmp_pose;
-    ltr_int_extrapolate_abs_pose(&(tmp.full_pose), &tmp_pose);
+    ltr_int_extrapolate_abs_pose(&tmp, &tmp_pose);
     *heading = tmp_pose.abs_yaw;
     *pitch = tmp_pose.abs_pitch;
     *roll = tmp_pose.abs_roll;
@@ -266,6 +277,16 @@ int ltr_get_abs_pose(float *heading,
 }
 
 
+//Wakes the server up to handle the command just posted
+static void ltr_int_signal_server(struct ltr_comm *com)
+{
+  //zero is reserved for clients that don't signal
+  if(__atomic_add_fetch(&(com->cmd_seq), 1, __ATOMIC_RELEASE) == 0){
+    __atomic_add_fetch(&(com->cmd_seq), 1, __ATOMIC_RELEASE);
+  }
+  ltr_int_futex_wake(&(com->cmd_seq));
+}
+
 linuxtrack_state_type ltr_suspend(void)
 {
   struct ltr_comm *com = mmm.data;
@@ -273,6 +294,7 @@ linuxtrack_state_type ltr_suspend(void)
   ltr_int_lockSemaphore(mmm.sem);
   com->cmd = PAUSE_CMD;
   ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_signal_server(com);
   return LINUXTRACK_OK;
 }
 
@@ -283,6 +305,7 @@ linuxtrack_state_type ltr_wakeup(void)
   ltr_int_lockSemaphore(mmm.sem);
   com->cmd = RUN_CMD;
   ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_signal_server(com);
   return LINUXTRACK_OK;
 }
 
@@ -293,8 +316,11 @@ linuxtrack_state_type ltr_shutdown(void)
   ltr_int_lockSemaphore(mmm.sem);
   com->cmd = STOP_CMD;
   ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_signal_server(com);
   initialized = false;
   ltr_int_unmap_file(&mmm);
+  ltr_int_frame_reader_close(&frames);
+  ltr_int_frame_reader_close(&stripes);
   return LINUXTRACK_OK;
 }
 
@@ -305,6 +331,7 @@ linuxtrack_state_type ltr_recenter(void)
   ltr_int_lockSemaphore(mmm.sem);
   com->recenter = true;
   ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_signal_server(com);
   return LINUXTRACK_OK;
 }
 
@@ -315,6 +342,7 @@ linuxtrack_state_type ltr_notification_on(void)
   ltr_int_lockSemaphore(mmm.sem);
   com->notify = true;
   ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_signal_server(com);
   return LINUXTRACK_OK;
 }
 
@@ -330,6 +358,7 @@ linuxtrack_state_type ltr_request_frames(void)
   ltr_int_lockSemaphore(mmm.sem);
   com->cmd = FRAMES_CMD;
   ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_signal_server(com);
   return LINUXTRACK_OK;
 }
 
@@ -343,9 +372,9 @@ linuxtrack_state_type ltr_get_tracking_state(void)
   if(com->preparing_start){
     return INITIALIZING;
   }
-  ltr_int_lockSemaphore(mmm.sem);
-  state = com->state;
-  ltr_int_unlockSemaphore(mmm.sem);
+  struct ltr_comm tmp;
+  ltr_int_read_comm(com, &tmp);
+  state = tmp.state;
   return state;
 }
 
@@ -396,50 +425,154 @@ const char *ltr_explain(linuxtrack_state_type status)
   return res;
 }
 
-static struct mmap_s mmap;
-
 int ltr_get_frame(int *req_width, int *req_height, size_t buf_size, uint8_t *buffer)
 {
   struct ltr_comm *com = mmm.data;
   if((!initialized) || (com == NULL)) return 0;
   struct ltr_comm tmp;
-  ltr_int_lockSemaphore(mmm.sem);
-  tmp = *com;
-  ltr_int_unlockSemaphore(mmm.sem);
+  ltr_int_read_comm(com, &tmp);
   if(tmp.state < LINUXTRACK_OK){
     return 0;
   }
-  uint32_t p_w = tmp.full_pose.pose.resolution_x;
-  uint32_t p_h = tmp.full_pose.pose.resolution_y;
-
-  if(p_w * p_h > mmap.size){
-    ltr_int_unmap_file(&mmap);
-    int data_size = FRAME_BUFFERS * p_w * p_h + (3 * sizeof(uint32_t));
-    char *fname = ltr_int_get_default_file_name("frames.dat");
-    if(!ltr_int_mmap_file(fname, data_size, &mmap)){
-      free(fname);
-      return 0;
+  int res = ltr_int_frame_reader_get(&frames, req_width, req_height, buf_size, buffer);
+  if(res >= 0){
+    return res;
+  }
+  //the master stopped publishing (or never did); ask again now and then,
+  //  without overwriting a command still pending
+  int64_t now = ltr_int_get_ts();
+  if(ltr_int_ts_diff(frames_requested, now) > 1000000){
+    frames_requested = now;
+    ltr_int_lockSemaphore(mmm.sem);
+    bool idle = (com->cmd == NOP_CMD);
+    if(idle){
+      com->cmd = FRAMES_CMD;
+    }
+    ltr_int_unlockSemaphore(mmm.sem);
+    if(idle){
+      ltr_int_signal_server(com);
     }
-    free(fname);
   }
-  if(mmap.data == NULL){
-    return 0;
+  return 0;
+}
+
+int ltr_get_stripes(size_t buf_size, uint8_t *buffer, size_t *size)
+{
+  struct ltr_comm *com = mmm.data;
+  *size = 0;
+  if((!initialized) || (com == NULL)) return 0;
+  if(stripes.fname == NULL){
+    stripes.fname = ltr_int_get_default_file_name("stripes.dat");
   }
-  uint32_t *data = (uint32_t*)mmap.data;
+  //reading alone keeps the master publishing
+  frame_channel_buf_t info;
+  int res = ltr_int_frame_reader_read(&stripes, &info, buf_size, buffer);
+  if(res >= 0){
+    *size = info.size;
+  }
+  return (res > 0) ? 1 : 0;
+}
+
+int ltr_decode_stripes(const uint8_t *data, size_t size, int *width, int *height,
+                       size_t img_size, uint8_t *img)
+{
+  return ltr_int_stripe_frame_decode(data, size, width, height, img_size, img);
+}
 
-  *req_width = data[1];
-  *req_height = data[2];
-  unsigned int flag = data[0];
-  uint32_t frame_size = (*req_width) * (*req_height);
-  if((p_w * p_h) < frame_size){ //Size had to change, mmap not big enough
+int ltr_get_stripe_blobs(const uint8_t *data, size_t size, float blobs[], int num_blobs)
+{
+  ltr_stripe_blob_t tmp[MAX_BLOBS];
+  int n = ltr_int_stripe_frame_blobs(data, size, tmp, MAX_BLOBS);
+  int i;
+  for(i = 0; (i < n) && (i < MAX_BLOBS) && (i < num_blobs); ++i){
+    blobs[i * BLOB_ELEMENTS] = tmp[i].x;
+    blobs[i * BLOB_ELEMENTS + 1] = tmp[i].y;
+    blobs[i * BLOB_ELEMENTS + 2] = tmp[i].score;
+  }
+  return n;
+}
+
+int ltr_get_pose_range(int64_t from, int64_t to, linuxtrack_timed_pose_t poses[],
+                       int max_poses)
+{
+  struct ltr_comm *com = mmm.data;
+  if((!initialized) || (com == NULL)) return 0;
+  //older servers don't keep the history (and may have shrunk the file)
+  if(__atomic_load_n(&(com->version), __ATOMIC_ACQUIRE) < LTR_COMM_HISTORY){
     return 0;
   }
-  if(buf_size < frame_size){
+  return ltr_int_pose_history_read(ltr_int_comm_history(com), from, to, poses, max_poses);
+}
+
+int ltr_get_pose_at(uint64_t target_ns, linuxtrack_predictor_t predictor,
+                    linuxtrack_pose_t *pose)
+{
+  struct ltr_comm *com = mmm.data;
+  if((!initialized) || (com == NULL)) return 0;
+  struct ltr_comm tmp;
+  ltr_int_read_comm(com, &tmp);
+  if(tmp.state < LINUXTRACK_OK){
+    memset(pose, 0, sizeof(linuxtrack_pose_t));
     return 0;
   }
-  uint8_t *buf = ((uint8_t*)mmap.data) + (3 * sizeof(uint32_t)) + flag * frame_size;
-  memcpy(buffer, buf, frame_size);
-  return 1;
+  int64_t target = (int64_t)(target_ns / 1000);
+  //the history serves both interpolation and prediction
+  linuxtrack_timed_pose_t poses[POSE_HISTORY_SLOTS];
+  int n = ltr_get_pose_range(INT64_MIN, INT64_MAX, poses, POSE_HISTORY_SLOTS);
+  if(n < 2){
+    //no history from older servers; the channel has the last two poses
+    ltr_int_comm_times(&tmp, ltr_int_get_ts(), &(poses[0].timestamp),
+                       &(poses[1].timestamp));
+    poses[0].pose = tmp.full_pose.prev_pose;
+    poses[1].pose = tmp.full_pose.pose;
+    n = 2;
+  }
+  uint32_t prev_counter = pose->counter;
+  ltr_int_predict_pose(poses, n, target, predictor, pose);
+  if(prev_counter != pose->counter){
+    ltr_int_trace_point(LTR_TRACE_CLIENT_READ, poses[n - 1].timestamp);
+    return 1;
+  }
+  return 0;
+}
+
+static int wait_pose_seq(struct ltr_comm *com, uint32_t counter, int timeout)
+{
+  int64_t deadline = ltr_int_get_ts() + (int64_t)timeout * 1000;
+  while(1){
+    uint32_t seq = __atomic_load_n(&(com->seq), __ATOMIC_SEQ_CST);
+    struct ltr_comm tmp;
+    ltr_int_read_comm(com, &tmp);
+    if((tmp.state >= LINUXTRACK_OK) && (tmp.full_pose.pose.counter != counter)){
+      return 1;
+    }
+    int left = -1;
+    if(timeout >= 0){
+      left = ltr_int_ts_diff(ltr_int_get_ts(), deadline) / 1000;
+      if(left <= 0){
+        return 0;
+      }
+    }
+    //state only updates wake us too, the counter check above sorts them out
+    if(ltr_int_futex_wait(&(com->seq), seq, left) < 0){
+      return -1;
+    }
+  }
+}
+
+int ltr_wait_pose(uint32_t counter, int timeout)
+{
+  struct ltr_comm *com = mmm.data;
+  if((!initialized) || (com == NULL)) return -1;
+  if(!com->has_seq){
+    //server without the seq counter only knows the notify pipe
+    return ltr_wait(timeout);
+  }
+  //the server skips the wake syscall while nobody waits
+  __atomic_add_fetch(&(com->waiters), 1, __ATOMIC_SEQ_CST);
+  int res = wait_pose_seq(com, counter, timeout);
+  __atomic_sub_fetch(&(com->waiters), 1, __ATOMIC_SEQ_CST);
+  return res;
 }
 
 int ltr_wait(int timeout)
@@ -7,6 +7,9 @@
 
 typedef enum{RUN_CMD, PAUSE_CMD, STOP_CMD, FRAMES_CMD, NOP_CMD} ltr_cmd;
 
+// 64bit timestamps aligned the same way in 32bit clients sharing the memory
+typedef int64_t ltr_timestamp_t __attribute__((aligned(8)));
+
 #define MAX_BLOBS 10
 #define BLOB_ELEMENTS 3
 
@@ -19,6 +22,19 @@ typedef struct{
   float abs_tz;
 } linuxtrack_abs_pose_t;
 
+typedef struct{
+  linuxtrack_pose_t prev_pose;
+  linuxtrack_pose_t pose;
+  linuxtrack_abs_pose_t prev_abs_pose;
+  linuxtrack_abs_pose_t abs_pose;
+  uint32_t blobs;
+  float blob_list[BLOB_ELEMENTS * MAX_BLOBS];
+  ltr_timestamp_t timestamp; // capture time of the frame the pose comes from
+  ltr_timestamp_t prev_timestamp;
+}linuxtrack_full_pose_t;
+
+// The pose as laid out in the client channel since the first release; the
+//   timestamps are ltr_int_legacy_ts() ones, wrapping every 1024s.
 typedef struct{
   linuxtrack_pose_t prev_pose;
   linuxtrack_pose_t pose;
@@ -28,16 +44,37 @@ typedef struct{
   float blob_list[BLOB_ELEMENTS * MAX_BLOBS];
   int timestamp;
   int prev_timestamp;
-}linuxtrack_full_pose_t;
+}ltr_comm_pose_t;
+
+// Layout revision of struct ltr_comm a server keeps in version; older
+//   servers leave it zero and fill in nothing past preparing_start.
+//   1 - 64bit capture times of the pose in timestamp and prev_timestamp
+//   2 - pose history mapped right after the struct (pose_history.h)
+#define LTR_COMM_VERSION 2
 
 struct ltr_comm{
   uint8_t cmd;
   uint8_t recenter;
   uint8_t notify;
   int8_t state;
-  linuxtrack_full_pose_t full_pose;
+  ltr_comm_pose_t full_pose;
   uint8_t dead_man_button;
   uint8_t preparing_start;
+  // Everything below was added after the first release; peers that old
+  //   never touch it, so it reads as zero to them.
+  // set by servers that update full_pose and state under seq; older ones
+  //   leave it zero and readers must take the lock
+  uint8_t has_seq;
+  // number of client threads sleeping on seq; the server wakes them on
+  //   updates only while there are some
+  uint8_t waiters;
+  uint32_t seq;
+  // bumped by clients after posting cmd, recenter or notify; the server
+  //   sleeps on it. Older clients leave it zero and have to be polled.
+  uint32_t cmd_seq;
+  uint32_t version;
+  ltr_timestamp_t timestamp; // capture times of full_pose, in full
+  ltr_timestamp_t prev_timestamp;
 };
 
 #ifdef __cplusplus
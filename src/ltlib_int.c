@@ -7,89 +7,127 @@
 #include "cal.h"
 #include "tracking.h"
 #include "ltlib_int.h"
+#include "frame_channel.h"
+#include "stripe_stream.h"
 
 static pthread_t cal_thread;
 static ltr_new_frame_callback_t ltr_new_frame_cbk = NULL;
 static void *ltr_new_frame_cbk_param = NULL;
 
-static bool publish_frames = true;
-static int active_frame = 0;
-static unsigned int current_w = 0;
-static unsigned int current_h = 0;
-static struct mmap_s mmap;
-static int data_size = 0;
-static int extra_data = 3 * sizeof(uint32_t);
+//Frames go to viewers only while someone looks at them
+static frame_writer_t frames;
 
-static int inc_frame_index(int current)
+static void publish_frame(struct frame_type *frame)
 {
-  return (current + 1) % FRAME_BUFFERS;
+  uint32_t w, h;
+  uint8_t *ours = ltr_int_frame_writer_current(&frames, &w, &h);
+  bool wanted = ltr_int_frame_writer_wanted(&frames);
+  if((ours != NULL) && (frame->bitmap == ours)){
+    //the frame was captured right into the channel
+    if(wanted && (w == frame->width) && (h == frame->height)){
+      ltr_int_frame_writer_publish(&frames, frame->counter);
+    }else{
+      ltr_int_frame_writer_abort(&frames);
+    }
+    frame->bitmap = NULL;
+  }else{
+    ltr_int_frame_writer_abort(&frames);
+    if(frame->bitmap != NULL){
+      //someone else has supplied the frame
+      if(wanted){
+        uint8_t *buf = ltr_int_frame_writer_begin(&frames, frame->width, frame->height);
+        if(buf != NULL){
+          memcpy(buf, frame->bitmap, frame->width * frame->height);
+          ltr_int_frame_writer_publish(&frames, frame->counter);
+        }
+      }
+      return;
+    }
+  }
+  if(wanted){
+    //with no bitmap the drivers skip drawing the frame altogether
+    frame->bitmap = ltr_int_frame_writer_begin(&frames, frame->width, frame->height);
+    if(frame->bitmap != NULL){
+      memset(frame->bitmap, 0, frame->width * frame->height);
+    }
+  }
 }
 
-static void publish_frame(struct frame_type *frame)
+//The stripe stream describes frames by the detector's runs of lit pixels;
+//  it goes to viewers while they read it, and to stripes.rec with 's' on.
+static frame_writer_t stripes;
+static FILE *stripes_rec = NULL;
+static uint8_t *stripes_buf = NULL;
+static size_t stripes_buf_size = 0;
+
+static uint8_t *stripes_scratch(size_t size)
 {
-//   if(frame->bitmap == NULL){
-//     printf("No bitmap to copy!\n");
-//
-//     return;
-//   }
-  if((frame->width != current_w) || (frame->height != current_h)){
-    active_frame = 0;
-    if((frame->width * frame->height) > (current_w * current_h)){
-      ltr_int_unmap_file(&mmap);
-      data_size = FRAME_BUFFERS * frame->width * frame->height + extra_data;
-      char *fname = ltr_int_get_default_file_name("frames.dat");
-      if(!ltr_int_mmap_file(fname, data_size, &mmap)){
-        free(fname);
-        return;
-      }
-      free(fname);
+  if(size > stripes_buf_size){
+    uint8_t *tmp = (uint8_t *)realloc(stripes_buf, size);
+    if(tmp == NULL){
+      return NULL;
     }
-    current_w = frame->width;
-    current_h = frame->height;
-    *(uint8_t*)mmap.data = 0;
-  }
-  uint32_t *data = (uint32_t*)mmap.data;
-  uint32_t *flag = data;
-  uint32_t *w = data + 1;
-  uint32_t *h = data + 2;
-  uint8_t *buf_base = ((uint8_t*)mmap.data) + extra_data;
-  int frame_size = frame->width * frame->height;
-  //advance the flag to point to the current buffer
-  int current_index = inc_frame_index(*flag);
-  uint8_t *current_buf = buf_base + (current_index) * frame_size;
-
-  *w = frame->width;
-  *h = frame->height;
-
-  if(frame->bitmap == current_buf){
-    int next_index = inc_frame_index(current_index);
-    frame->bitmap = buf_base + next_index * frame_size;
-    *flag = current_index;
-    memset(frame->bitmap, 0, frame->width * frame->height);
-  }else if(frame->bitmap == NULL){
-    *flag = 0;
-    memset(buf_base, 0, frame->width * frame->height);
-    frame->bitmap = buf_base + frame_size;
-    memset(frame->bitmap, 0, frame->width * frame->height);
-  }else{
-    //someone else has supplied the frame
-    memcpy(current_buf, frame->bitmap, current_w * current_h);
-    *flag = current_index;
+    stripes_buf = tmp;
+    stripes_buf_size = size;
+  }
+  return stripes_buf;
+}
+
+static void publish_stripes(struct frame_type *frame)
+{
+  bool wanted = ltr_int_frame_writer_wanted(&stripes);
+  //the runloop keeps the runs from the next frame on
+  frame->want_runs = wanted || (stripes_rec != NULL);
+  if((!frame->want_runs) || (frame->runs == NULL)){
+    //nothing kept for this one yet
+    return;
+  }
+  ltr_stripe_frame_t hdr;
+  ltr_stripe_blob_t blobs[MAX_BLOBS];
+  hdr.num_runs = frame->num_runs;
+  hdr.num_blobs = (frame->bloblist.num_blobs < MAX_BLOBS) ? frame->bloblist.num_blobs : MAX_BLOBS;
+  unsigned int i;
+  for(i = 0; i < hdr.num_blobs; ++i){
+    //back from the centered coordinates to pixels
+    struct blob_type *b = &(frame->bloblist.blobs[i]);
+    blobs[i].x = (frame->width - 1) / 2.0 - b->x;
+    blobs[i].y = (frame->height - 1) / 2.0 - b->y;
+    blobs[i].score = b->score;
+  }
+  hdr.counter = frame->counter;
+  hdr.timestamp = frame->usec;
+  hdr.width = frame->width;
+  hdr.height = frame->height;
+  hdr.flags = frame->runs_truncated ? STRIPE_FRAME_TRUNCATED : 0;
+  size_t size = ltr_int_stripe_frame_size(hdr.num_runs, hdr.num_blobs);
+  uint8_t *buf = wanted ?
+    ltr_int_frame_writer_begin_data(&stripes, frame->width, frame->height, size) :
+    stripes_scratch(size);
+  if(buf == NULL){
+    return;
+  }
+  ltr_int_stripe_frame_encode(buf, size, &hdr, frame->runs, blobs);
+  if((stripes_rec != NULL) && (fwrite(buf, size, 1, stripes_rec) != 1)){
+    ltr_int_log_message("Can't write the stripe recording, stopping it.\n");
+    fclose(stripes_rec);
+    stripes_rec = NULL;
+  }
+  if(wanted){
+    ltr_int_frame_writer_publish(&stripes, frame->counter);
   }
 }
 
 void ltr_int_publish_frames_cmd(void){
   ltr_int_log_message("Received request to publish frames\n");
-  publish_frames = true;
+  ltr_int_frame_writer_demand(&frames);
 }
 
 static int frame_callback(struct camera_control_block *ccb, struct frame_type *frame)
 {
   (void)ccb;
   ltr_int_update_pose(frame);
-  if(publish_frames){
-    publish_frame(frame);
-  }
+  publish_frame(frame);
+  publish_stripes(frame);
   if(ltr_new_frame_cbk != NULL){
     ltr_new_frame_cbk(frame, ltr_new_frame_cbk_param);
   }
@@ -122,6 +160,22 @@ int ltr_int_init(void)
     ltr_int_log_message("Couldn't initialize tracking!\n");
     return -1;
   }
+  if(frames.fname == NULL){
+    ltr_int_frame_writer_init(&frames, NULL);
+  }
+  if(stripes.fname == NULL){
+    char *fname = ltr_int_get_default_file_name("stripes.dat");
+    ltr_int_frame_writer_init(&stripes, fname);
+    free(fname);
+    //viewers find the channel before any stripes get published
+    ltr_int_frame_writer_open(&stripes, ltr_int_stripe_frame_size(1024, MAX_BLOBS));
+  }
+  if((stripes_rec == NULL) && (ltr_int_get_dbg_flag('s') == DBG_ON)){
+    stripes_rec = fopen("stripes.rec", "ab");
+    if(stripes_rec == NULL){
+      ltr_int_my_perror("fopen: ");
+    }
+  }
   pthread_create(&cal_thread, NULL, cal_thread_fun, NULL);
   return 0;
 }
@@ -154,6 +208,15 @@ int ltr_int_shutdown(void)
   ltr_int_log_message("Shutting down tracking...\n");
   int res = ltr_int_cal_shutdown();
   pthread_join(cal_thread, NULL);
+  ltr_int_frame_writer_close(&frames);
+  ltr_int_frame_writer_close(&stripes);
+  if(stripes_rec != NULL){
+    fclose(stripes_rec);
+    stripes_rec = NULL;
+  }
+  free(stripes_buf);
+  stripes_buf = NULL;
+  stripes_buf_size = 0;
   return res;
 }
 
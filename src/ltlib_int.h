@@ -12,8 +12,6 @@
 extern "C" {
 #endif
 
-#define FRAME_BUFFERS 3
-
 struct frame_type;
 typedef void (*ltr_new_frame_callback_t)(struct frame_type *frame, void *);
 typedef void (*ltr_status_update_callback_t)(void *);
@@ -32,6 +30,15 @@ void ltr_int_publish_frames_cmd(void);
 linuxtrack_state_type ltr_notification_on(void);
 int ltr_get_notify_pipe(void);
 int ltr_wait(int timeout);
+int ltr_wait_pose(uint32_t counter, int timeout);
+int ltr_get_stripes(size_t buf_size, uint8_t *buffer, size_t *size);
+int ltr_decode_stripes(const uint8_t *data, size_t size, int *width, int *height,
+                       size_t img_size, uint8_t *img);
+int ltr_get_stripe_blobs(const uint8_t *data, size_t size, float blobs[], int num_blobs);
+int ltr_get_pose_range(int64_t from, int64_t to, linuxtrack_timed_pose_t poses[],
+                       int max_poses);
+int ltr_get_pose_at(uint64_t target_ns, linuxtrack_predictor_t predictor,
+                    linuxtrack_pose_t *pose);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "latency_trace.h"
+
+// Prints the latency histograms collected by the trace points; run the
+//   tracker and the client with LINUXTRACK_DBG=l to fill them.
+static void print_stats(const ltr_trace_region_t *r)
+{
+  int i;
+  printf("%-12s %10s %8s %8s %8s %8s %8s\n", "stage", "frames", "mean",
+         "p50", "p95", "p99", "max");
+  for(i = 0; i < LTR_TRACE_STAGES; ++i){
+    const ltr_trace_hist_t *h = &r->stages[i];
+    unsigned long long count = h->count;
+    printf("%-12s %10llu %8llu %8u %8u %8u %8llu\n",
+           ltr_int_trace_stage_name((ltr_trace_stage_t)i), count,
+           count ? (unsigned long long)(h->sum_us / count) : 0ULL,
+           ltr_int_trace_hist_percentile(h, 50.0),
+           ltr_int_trace_hist_percentile(h, 95.0),
+           ltr_int_trace_hist_percentile(h, 99.0),
+           (unsigned long long)h->max_us);
+  }
+  printf("(frame age in us since capture)\n");
+}
+
+int main(int argc, char *argv[]){
+  int interval = 0;
+  bool reset = false;
+  int i;
+  for(i = 1; i < argc; ++i){
+    if(strcmp(argv[i], "--reset") == 0){
+      reset = true;
+    }else if((strcmp(argv[i], "--watch") == 0) && (i + 1 < argc)){
+      if(sscanf(argv[++i], "%d", &interval) != 1){
+        interval = 0;
+      }
+    }else{
+      fprintf(stderr, "Usage: %s [--reset] [--watch seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+  ltr_trace_region_t *r = ltr_int_trace_map();
+  if(r == NULL){
+    fprintf(stderr, "Can't map the trace file!\n");
+    return 1;
+  }
+  if(reset){
+    ltr_int_trace_reset(r);
+    return 0;
+  }
+  print_stats(r);
+  while(interval > 0){
+    sleep(interval);
+    printf("\n");
+    print_stats(r);
+  }
+  return 0;
+}
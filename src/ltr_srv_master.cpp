@@ -1,12 +1,16 @@
+#include <config.h>
 #include "ltr_srv_master.h"
 #include "linuxtrack.h"
 #include "ltr_srv_comm.h"
 #include "axis.h"
 #include "cal.h"
 #include <errno.h>
+#include <fcntl.h>
 #include "ipc_utils.h"
-#include <poll.h>
+#include "latency_trace.h"
+#include "pose_ring.h"
 #include "pref.h"
+#include "pref_global.h"
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
@@ -15,15 +19,45 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/un.h>
+#ifdef DARWIN
+#include <sys/event.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
 #include <time.h>
 #include <unistd.h>
+#include "tracking.h"
 #include "utils.h"
 
 #include <map>
 #include <mutex>
 #include <string>
-
-static std::multimap<std::string, int> slaves;
+#include <unordered_map>
+#include <vector>
+
+// Everything the main loop waits for; the timer and the wakeup are there
+//   so that all events come through one wait.
+enum conn_kind { CONN_LISTENER, CONN_CLIENT, CONN_TIMER, CONN_WAKEUP };
+
+struct connection {
+  conn_kind kind;
+  int fd;
+  bool registered = false; // slave with a profile, entry is valid
+  std::multimap<std::string, connection *>::iterator entry;
+  std::string outbound; // bytes the socket didn't take yet
+  bool writing = false; // waiting for the socket to become writable
+  bool dead = false;    // given up, waiting for the hangup
+  bool closing = false; // closed once the current events are handled
+
+  connection(conn_kind k = CONN_CLIENT, int f = -1) : kind(k), fd(f) {}
+};
+
+// Connections belong to the main loop, which alone adds and removes them;
+//   the slaves map and the outbound queues are guarded by send_mx.
+static std::unordered_map<int, connection> connections;
+static std::multimap<std::string, connection *> slaves;
 static semaphore_p pfSem = nullptr;
 
 static linuxtrack_full_pose_t current_pose;
@@ -33,9 +67,280 @@ static ltr_status_update_callback_t status_update_hook = nullptr;
 static ltr_new_slave_callback_t new_slave_hook = nullptr;
 
 static bool save_prefs = true;
+static bool standalone_master = false;
 static bool no_slaves = false;
 static std::mutex send_mx;
 
+// A slave not taking its messages gets dropped once this much piles up
+static const size_t MAX_OUTBOUND = 1024 * sizeof(message_t);
+static const int TICK_MS = 2000;
+static const int MAX_EVENTS = 32;
+
+enum { LOOP_READ = 1, LOOP_WRITE = 2, LOOP_HUP = 4 };
+struct loop_event {
+  connection *conn;
+  unsigned int what;
+};
+
+static int loop_fd = -1;
+static std::mutex wake_mx;
+static connection ticker(CONN_TIMER);
+static connection wakeup(CONN_WAKEUP);
+
+#ifndef DARWIN
+
+static bool loop_ctl(int op, connection *c, uint32_t events) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.ptr = c;
+  if (epoll_ctl(loop_fd, op, c->fd, &ev) != 0) {
+    ltr_int_my_perror("epoll_ctl");
+    return false;
+  }
+  return true;
+}
+
+static bool loop_open() {
+  loop_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop_fd < 0) {
+    ltr_int_my_perror("epoll_create1");
+    return false;
+  }
+  ticker.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wakeup.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ((ticker.fd < 0) || (wakeup.fd < 0)) {
+    ltr_int_my_perror("timerfd/eventfd");
+    return false;
+  }
+  return loop_ctl(EPOLL_CTL_ADD, &ticker, EPOLLIN) &&
+         loop_ctl(EPOLL_CTL_ADD, &wakeup, EPOLLIN);
+}
+
+static void loop_close() {
+  std::lock_guard<std::mutex> guard(wake_mx);
+  if (ticker.fd >= 0) {
+    close(ticker.fd);
+    ticker.fd = -1;
+  }
+  if (wakeup.fd >= 0) {
+    close(wakeup.fd);
+    wakeup.fd = -1;
+  }
+  if (loop_fd >= 0) {
+    close(loop_fd);
+    loop_fd = -1;
+  }
+}
+
+static bool loop_watch(connection *c, bool edge) {
+  return loop_ctl(EPOLL_CTL_ADD, c, EPOLLIN | (edge ? (uint32_t)EPOLLET : 0u));
+}
+
+static void loop_want_write(connection *c, bool on) {
+  loop_ctl(EPOLL_CTL_MOD, c, EPOLLIN | (on ? (uint32_t)EPOLLOUT : 0u));
+}
+
+static void loop_unwatch(connection *c) {
+  epoll_ctl(loop_fd, EPOLL_CTL_DEL, c->fd, nullptr);
+}
+
+// Ticks every ms milliseconds, 0 stops it
+static void loop_set_timer(int ms) {
+  struct itimerspec its;
+  its.it_interval.tv_sec = ms / 1000;
+  its.it_interval.tv_nsec = (ms % 1000) * 1000000L;
+  its.it_value = its.it_interval;
+  if (timerfd_settime(ticker.fd, 0, &its, nullptr) != 0) {
+    ltr_int_my_perror("timerfd_settime");
+  }
+}
+
+static void loop_wake() {
+  std::lock_guard<std::mutex> guard(wake_mx);
+  if (wakeup.fd >= 0) {
+    uint64_t one = 1;
+    if (write(wakeup.fd, &one, sizeof(one)) < 0) {
+      // counter full, the loop has plenty to wake up to
+    }
+  }
+}
+
+static void loop_drain(connection *c) {
+  uint64_t count;
+  if (read(c->fd, &count, sizeof(count)) < 0) {
+    // spurious wakeup
+  }
+}
+
+static int loop_wait(loop_event *events, int max) {
+  struct epoll_event evs[MAX_EVENTS];
+  int n = epoll_wait(loop_fd, evs, (max < MAX_EVENTS) ? max : MAX_EVENTS, -1);
+  for (int i = 0; i < n; ++i) {
+    events[i].conn = (connection *)evs[i].data.ptr;
+    events[i].what = ((evs[i].events & EPOLLIN) ? LOOP_READ : 0) |
+                     ((evs[i].events & EPOLLOUT) ? LOOP_WRITE : 0) |
+                     ((evs[i].events & (EPOLLHUP | EPOLLERR)) ? LOOP_HUP : 0);
+  }
+  return n;
+}
+
+#else
+
+static bool loop_ctl(uintptr_t ident, int16_t filter, uint16_t flags,
+                     intptr_t data, connection *c) {
+  struct kevent ev;
+  EV_SET(&ev, ident, filter, flags, 0, data, c);
+  if (kevent(loop_fd, &ev, 1, nullptr, 0, nullptr) != 0) {
+    ltr_int_my_perror("kevent");
+    return false;
+  }
+  return true;
+}
+
+static bool loop_open() {
+  loop_fd = kqueue();
+  if (loop_fd < 0) {
+    ltr_int_my_perror("kqueue");
+    return false;
+  }
+  return loop_ctl(1, EVFILT_USER, EV_ADD | EV_CLEAR, 0, &wakeup);
+}
+
+static void loop_close() {
+  std::lock_guard<std::mutex> guard(wake_mx);
+  if (loop_fd >= 0) {
+    close(loop_fd);
+    loop_fd = -1;
+  }
+}
+
+static bool loop_watch(connection *c, bool edge) {
+  return loop_ctl(c->fd, EVFILT_READ, EV_ADD | (edge ? EV_CLEAR : 0), 0, c) &&
+         loop_ctl(c->fd, EVFILT_WRITE, EV_ADD | EV_DISABLE, 0, c);
+}
+
+static void loop_want_write(connection *c, bool on) {
+  loop_ctl(c->fd, EVFILT_WRITE, on ? EV_ENABLE : EV_DISABLE, 0, c);
+}
+
+static void loop_unwatch(connection *c) {
+  // closing the descriptor drops its filters
+  (void)c;
+}
+
+static void loop_set_timer(int ms) {
+  if (ms > 0) {
+    loop_ctl(1, EVFILT_TIMER, EV_ADD, ms, &ticker);
+  } else {
+    struct kevent ev;
+    EV_SET(&ev, 1, EVFILT_TIMER, EV_DELETE, 0, 0, nullptr);
+    kevent(loop_fd, &ev, 1, nullptr, 0, nullptr);
+  }
+}
+
+static void loop_wake() {
+  std::lock_guard<std::mutex> guard(wake_mx);
+  if (loop_fd >= 0) {
+    struct kevent ev;
+    EV_SET(&ev, 1, EVFILT_USER, 0, NOTE_TRIGGER, 0, &wakeup);
+    kevent(loop_fd, &ev, 1, nullptr, 0, nullptr);
+  }
+}
+
+static void loop_drain(connection *c) { (void)c; }
+
+static int loop_wait(loop_event *events, int max) {
+  struct kevent evs[MAX_EVENTS];
+  int n = kevent(loop_fd, nullptr, 0, evs, (max < MAX_EVENTS) ? max : MAX_EVENTS,
+                 nullptr);
+  for (int i = 0; i < n; ++i) {
+    events[i].conn = (connection *)evs[i].udata;
+    events[i].what = ((evs[i].filter == EVFILT_WRITE) ? LOOP_WRITE : LOOP_READ) |
+                     ((evs[i].flags & (EV_EOF | EV_ERROR)) ? LOOP_HUP : 0);
+  }
+  return n;
+}
+
+#endif
+
+static bool set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return (flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+// Gives the connection up; the main loop closes it on the hangup that follows
+static void drop_connection(connection *c) {
+  if (!c->dead) {
+    c->dead = true;
+    shutdown(c->fd, SHUT_RDWR);
+  }
+}
+
+// Writes out what the socket takes without blocking, a message at a time
+//   as slaves read them whole; call with send_mx held.
+static void flush_outbound(connection *c) {
+  size_t sent = 0;
+  while (sent < c->outbound.size()) {
+    size_t chunk = (c->outbound.size() - sent) % sizeof(message_t);
+    if (chunk == 0) {
+      chunk = sizeof(message_t);
+    }
+    ssize_t res = write(c->fd, c->outbound.data() + sent, chunk);
+    if (res > 0) {
+      sent += res;
+    } else if ((res < 0) && (errno == EINTR)) {
+      continue;
+    } else if ((res < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+      break;
+    } else {
+      ltr_int_my_perror("write@flush_outbound");
+      c->outbound.clear();
+      drop_connection(c);
+      return;
+    }
+  }
+  c->outbound.erase(0, sent);
+  bool want = !c->outbound.empty();
+  if (want != c->writing) {
+    c->writing = want;
+    loop_want_write(c, want);
+  }
+}
+
+// Call with send_mx held
+static void queue_message(connection *c, const message_t &msg) {
+  if (c->dead) {
+    return;
+  }
+  if (c->outbound.size() + sizeof(message_t) > MAX_OUTBOUND) {
+    ltr_int_log_message("Slave @socket %d doesn't read its messages, dropping it!\n",
+                        c->fd);
+    c->outbound.clear();
+    drop_connection(c);
+    return;
+  }
+  c->outbound.append((const char *)&msg, sizeof(message_t));
+  flush_outbound(c);
+}
+
+// Poses go to the slaves through a shared ring; the sockets carry only
+//   control messages, so a slow slave can't hold up the others.
+static struct mmap_s ring_mmm;
+static pose_ring_t *pose_ring = nullptr;
+static std::mutex ring_mx;
+
+// With "Master-postprocessing" on, each profile's axes run once per pose
+//   here instead of in every slave of the profile; the filtered poses are
+//   published next to the raw one. Guarded by ring_mx.
+struct profile_pp {
+  std::string name;
+  unsigned int users;
+  ltr_axes_t axes;
+  ltr_filter_state_t filter;
+};
+static profile_pp profiles[POSE_RING_PROFILES];
+
 bool ltr_int_gui_lock(bool do_lock) {
   static const char *lockName = "ltr_server.lock";
 
@@ -71,22 +376,51 @@ void ltr_int_gui_lock_clean() {
   }
 }
 
+static void change_profile_axes(const char *profile, int axis, int elem,
+                                float val) {
+  // misc settings are global, this process has them already
+  if (axis == MISC) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(ring_mx);
+  for (int n = 0; n < POSE_RING_PROFILES; ++n) {
+    if ((profiles[n].users == 0) ||
+        ((profile != nullptr) && (profiles[n].name != profile))) {
+      continue;
+    }
+    if (elem == AXIS_ENABLED) {
+      ltr_int_set_axis_bool_param(profiles[n].axes, (axis_t)axis,
+                                  (axis_param_t)elem, val > 0.5f);
+    } else {
+      ltr_int_set_axis_param(profiles[n].axes, (axis_t)axis,
+                             (axis_param_t)elem, val);
+    }
+  }
+}
+
 void ltr_int_change(const char *profile, int axis, int elem, float val) {
+  change_profile_axes(profile, axis, elem, val);
+  message_t msg;
+  memset(&msg, 0, sizeof(message_t));
+  msg.cmd = CMD_PARAM;
+  msg.param.axis_id = axis;
+  msg.param.param_id = elem;
+  msg.param.flt_val = val;
   std::lock_guard<std::mutex> guard(send_mx);
-  std::pair<std::multimap<std::string, int>::iterator,
-            std::multimap<std::string, int>::iterator>
+  std::pair<std::multimap<std::string, connection *>::iterator,
+            std::multimap<std::string, connection *>::iterator>
       range;
-  std::multimap<std::string, int>::iterator i;
+  std::multimap<std::string, connection *>::iterator i;
   if (profile != nullptr) {
     // Finds all slaves belonging to the specific profile
     range = slaves.equal_range(profile);
     for (i = range.first; i != range.second; ++i) {
-      ltr_int_send_param_update(i->second, axis, elem, val);
+      queue_message(i->second, msg);
     }
   } else {
     // Broadcast to all slaves
     for (i = slaves.begin(); i != slaves.end(); ++i) {
-      ltr_int_send_param_update(i->second, axis, elem, val);
+      queue_message(i->second, msg);
     }
   }
 }
@@ -102,32 +436,120 @@ void ltr_int_set_callback_hooks(ltr_new_frame_callback_t nfh,
   new_slave_hook = nsh;
 }
 
-bool ltr_int_broadcast_pose(linuxtrack_full_pose_t &pose) {
-  std::lock_guard<std::mutex> guard(send_mx);
-  std::multimap<std::string, int>::iterator i;
-  int res;
-  bool checkSlaves = false;
-  // Send updated pose to all clients
+static bool publish_pose(linuxtrack_full_pose_t &pose) {
+  // publishes come from the capture thread as well as the main loop
+  std::lock_guard<std::mutex> guard(ring_mx);
+  if (pose_ring == nullptr) {
+    return false;
+  }
   // printf("Master: %g  %g  %g\n", pose.pose.raw_pitch, pose.pose.raw_yaw,
   // pose.pose.raw_roll);
-  for (i = slaves.begin(); i != slaves.end();) {
-    res = ltr_int_send_data(i->second, &pose);
-    if (res == -EPIPE) {
-      ltr_int_log_message("Slave @socket %d left!\n", i->second);
-      close(i->second);
-      i->second = -1;
-      slaves.erase(i++);
-      checkSlaves = true;
-    } else {
-      ++i;
+  linuxtrack_pose_t filtered[POSE_RING_PROFILES];
+  linuxtrack_pose_t unfiltered;
+  uint32_t mask = 0;
+  for (int n = 0; n < POSE_RING_PROFILES; ++n) {
+    if (profiles[n].users == 0) {
+      continue;
     }
+    // every pose published goes through the filter, just as in a slave
+    filtered[n] = pose.pose;
+    ltr_int_postprocess_axes_state(profiles[n].axes, &(profiles[n].filter),
+                                   &(filtered[n]), &unfiltered);
+    mask |= 1u << n;
   }
-  if (checkSlaves && (slaves.size() == 0)) {
-    no_slaves = true;
+  ltr_int_pose_ring_publish_filtered(pose_ring, &pose, mask, filtered);
+  return true;
+}
+
+bool ltr_int_broadcast_pose(linuxtrack_full_pose_t &pose) {
+  if (!publish_pose(pose)) {
+    return false;
   }
+#ifndef __linux__
+  // No futex for the slaves to sleep on the ring with; nudge them through
+  //   their sockets instead.
+  message_t msg;
+  memset(&msg, 0, sizeof(message_t));
+  msg.cmd = CMD_POSE;
+  std::lock_guard<std::mutex> guard(send_mx);
+  for (std::multimap<std::string, connection *>::iterator i = slaves.begin();
+       i != slaves.end(); ++i) {
+    queue_message(i->second, msg);
+  }
+#endif
   return true;
 }
 
+// Returns the profile's slot in the ring, or -1 when it gets no
+//   postprocessing in the master.
+static int add_profile_user(const char *name) {
+  if (!ltr_int_use_master_postprocessing()) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> guard(ring_mx);
+  int free_slot = -1;
+  for (int n = 0; n < POSE_RING_PROFILES; ++n) {
+    if (profiles[n].users == 0) {
+      if (free_slot < 0) {
+        free_slot = n;
+      }
+    } else if (profiles[n].name == name) {
+      ++(profiles[n].users);
+      return n;
+    }
+  }
+  if (free_slot < 0) {
+    ltr_int_log_message("No room to postprocess profile '%s' in master.\n",
+                        name);
+    return -1;
+  }
+  // fresh filter, same as a newly started slave would have
+  profile_pp &pp = profiles[free_slot];
+  pp.name = name;
+  pp.users = 1;
+  pp.axes = nullptr;
+  ltr_int_init_axes(&(pp.axes), name);
+  memset(&(pp.filter), 0, sizeof(pp.filter));
+  return free_slot;
+}
+
+static void remove_profile_user(const std::string &name) {
+  std::lock_guard<std::mutex> guard(ring_mx);
+  for (int n = 0; n < POSE_RING_PROFILES; ++n) {
+    if ((profiles[n].users > 0) && (profiles[n].name == name)) {
+      if (--(profiles[n].users) == 0) {
+        ltr_int_close_axes(&(profiles[n].axes));
+      }
+      return;
+    }
+  }
+}
+
+// Call with send_mx held
+static void ltr_int_unregister_slave(connection *c) {
+  if (!c->registered) {
+    return;
+  }
+  ltr_int_log_message("Slave @socket %d left!\n", c->fd);
+  remove_profile_user(c->entry->first);
+  slaves.erase(c->entry);
+  c->registered = false;
+  if (slaves.size() == 0) {
+    no_slaves = true;
+  }
+}
+
+static void close_connection(connection *c) {
+  int fd = c->fd;
+  loop_unwatch(c);
+  {
+    std::lock_guard<std::mutex> guard(send_mx);
+    ltr_int_unregister_slave(c);
+    connections.erase(fd);
+  }
+  close(fd);
+}
+
 static void ltr_int_new_frame(struct frame_type *frame, void *param) {
   (void)frame;
   (void)param;
@@ -142,6 +564,7 @@ static void ltr_int_new_frame(struct frame_type *frame, void *param) {
     new_frame_hook(frame, (void *)&current_pose);
   }
   ltr_int_broadcast_pose(current_pose);
+  ltr_int_trace_point(LTR_TRACE_BROADCAST, current_pose.timestamp);
 }
 
 static void ltr_int_state_changed(void *param) {
@@ -152,15 +575,22 @@ static void ltr_int_state_changed(void *param) {
     status_update_hook(param);
   }
   ltr_int_broadcast_pose(current_pose);
+  // the main loop might have to quit or start the heartbeat
+  loop_wake();
 }
 
-bool ltr_int_register_slave(int socket, message_t &msg) {
+static bool ltr_int_register_slave(connection *c, message_t &msg) {
   ltr_int_log_message("Trying to register slave!\n");
   {
     std::lock_guard<std::mutex> guard(send_mx);
-    slaves.insert(std::pair<std::string, int>(msg.str, socket));
+    if (c->registered) {
+      ltr_int_log_message("Slave @socket %d registered already!\n", c->fd);
+      return false;
+    }
+    c->entry = slaves.insert(std::make_pair(std::string(msg.str), c));
+    c->registered = true;
     ltr_int_log_message("Slave with profile '%s' @socket %d registered!\n",
-                        msg.str, socket);
+                        msg.str, c->fd);
   }
 
   // Make sure the new section is created if needed...
@@ -177,6 +607,16 @@ bool ltr_int_register_slave(int socket, message_t &msg) {
     }
   }
 
+  int slot = add_profile_user(msg.str);
+  if (slot >= 0) {
+    message_t profile_msg;
+    memset(&profile_msg, 0, sizeof(message_t));
+    profile_msg.cmd = CMD_PROFILE;
+    profile_msg.data = slot;
+    std::lock_guard<std::mutex> guard(send_mx);
+    queue_message(c, profile_msg);
+  }
+
   if (new_slave_hook != nullptr) {
     new_slave_hook(msg.str);
   }
@@ -196,194 +636,220 @@ size_t ltr_int_request_shutdown() {
   // if(res == 0){
   gui_shutdown_request = true;
   //}
+  loop_wake();
   return 0;
 }
 
-struct pollfd *descs = nullptr;
-size_t max_len = 0;
-size_t current_len = 0;
-nfds_t numfd = 0;
-
-bool add_poll_desc(int fd) {
-  ltr_int_log_message("Adding fd %d\n", fd);
-  if (current_len >= max_len) {
-    if (max_len > 0) {
-      max_len *= 2;
-      descs = (struct pollfd *)realloc(descs, max_len * sizeof(struct pollfd));
-      if (descs) {
-        memset(descs + current_len, 0,
-               (max_len - current_len) * sizeof(struct pollfd)); //???
+static void accept_connections(int socket) {
+  // the listener is edge triggered, take everything waiting
+  while (1) {
+    int new_fd = accept(socket, nullptr, nullptr);
+    if (new_fd < 0) {
+      if (errno == EINTR) {
+        continue;
       }
-    } else {
-      max_len = 1;
-      descs = (struct pollfd *)malloc(max_len * sizeof(struct pollfd));
-      if (descs) {
-        memset(descs, 0, max_len * sizeof(struct pollfd));
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        ltr_int_my_perror("accept");
       }
+      // No more connection requests
+      return;
+    }
+    ltr_int_log_message("Adding fd %d\n", new_fd);
+    fcntl(new_fd, F_SETFD, FD_CLOEXEC);
+    if (!set_nonblocking(new_fd)) {
+      ltr_int_my_perror("fcntl");
+      close(new_fd);
+      continue;
     }
-    if (descs == nullptr) {
-      ltr_int_my_perror("m/re-alloc");
-      ltr_int_log_message("Can't alloc enough memory for the poll!\n");
-      exit(1);
+    connection *c;
+    {
+      std::lock_guard<std::mutex> guard(send_mx);
+      c = &(connections[new_fd]);
+      *c = connection(CONN_CLIENT, new_fd);
+    }
+    if (!loop_watch(c, false)) {
+      close_connection(c);
     }
   }
-  descs[current_len].fd = fd;
-  descs[current_len].events = POLLIN;
-  descs[current_len].revents = 0;
-  ++current_len;
-  return true;
 }
 
-void print_descs(void) {
-  nfds_t i;
-  for (i = 0; i < current_len; ++i) {
-    ltr_int_log_message("%ld: fd=%d, ev=%d, rev=%d\n", (long int)i, descs[i].fd,
-                        descs[i].events, descs[i].revents);
+// Returns false when the connection is to be closed
+static bool receive_message(connection *c) {
+  message_t msg;
+  msg.cmd = CMD_NOP;
+  ssize_t x = ltr_int_socket_receive(c->fd, &msg, sizeof(message_t));
+  // ltr_int_log_message("Read %d bytes from fd %d.\n", (int)x, c->fd);
+  if (x < 0) {
+    if ((x == -EAGAIN) || (x == -EWOULDBLOCK) || (x == -EINTR)) {
+      return true;
+    }
+    ltr_int_log_message("Unexpected error %d reading from fd %d.\n", (int)x,
+                        c->fd);
+    return false;
+  } else if (x == 0) {
+    // the other end is gone
+    return false;
   }
+  // ltr_int_log_message("Received a message from slave (%d)!!!\n", msg.cmd);
+  switch (msg.cmd) {
+  case CMD_PAUSE:
+    ltr_int_suspend_cmd();
+    break;
+  case CMD_WAKEUP:
+    ltr_int_wakeup_cmd();
+    break;
+  case CMD_RECENTER:
+    ltr_int_recenter_cmd();
+    break;
+  case CMD_NEW_SOCKET:
+    // ltr_int_log_message("Cmd to register new slave...\n");
+    msg.str[sizeof(msg.str) - 1] = '\0';
+    ltr_int_register_slave(c, msg);
+    break;
+  case CMD_FRAMES:
+    ltr_int_publish_frames_cmd();
+    break;
+  }
+  return true;
 }
 
-bool remove_poll_desc() {
-  nfds_t i;
-  // ltr_int_log_message("Watched descriptors before garbage collection.\n");
-  // print_descs();
-  for (i = 0; i < current_len; ++i) {
-    if (descs[i].revents & POLLHUP) {
-      ltr_int_log_message("Removing hanged fd %d\n", descs[i].fd);
-      if (i < (current_len - 1)) {
-        descs[i] = descs[current_len - 1];
-      } else {
-        // last fd, just decrement current_len
-        //  Intentionaly empty
-      }
-      --current_len;
-    }
+static void heartbeat_tick(int &heartbeat) {
+  if (ltr_int_get_tracking_state() != PAUSED) {
+    heartbeat = 0;
+    return;
+  }
+  ++heartbeat;
+  if (heartbeat > 5) {
+    linuxtrack_full_pose_t dummy;
+    dummy.pose.pitch = 0.0;
+    dummy.pose.yaw = 0.0;
+    dummy.pose.roll = 0.0;
+    dummy.pose.tx = 0.0;
+    dummy.pose.ty = 0.0;
+    dummy.pose.tz = 0.0;
+    dummy.pose.counter = 0;
+    dummy.pose.status = PAUSED;
+    dummy.blobs = 0;
+    ltr_int_broadcast_pose(dummy);
+    heartbeat = 0;
   }
-  // ltr_int_log_message("Watched descriptors after garbage collection.\n");
-  // print_descs();
-  return true;
 }
 
 int ltr_int_master_main_loop(int socket) {
-  int res;
-  int new_fd;
-  bool close_conn;
   int heartbeat = 0;
-  nfds_t i;
+  bool ticking = false;
+  std::vector<connection *> closing;
+  loop_event events[MAX_EVENTS];
   no_slaves = false;
 
-  struct sockaddr_un address;
-  socklen_t address_len = sizeof(address);
-  add_poll_desc(socket);
+  if (!loop_open()) {
+    loop_close();
+    return -1;
+  }
+  connection *listener;
+  {
+    std::lock_guard<std::mutex> guard(send_mx);
+    listener = &(connections[socket]);
+    *listener = connection(CONN_LISTENER, socket);
+  }
+  if (loop_watch(listener, true)) {
+    // connections made before the listener was watched
+    accept_connections(socket);
+  } else {
+    no_slaves = true;
+  }
   while (1) {
     if (gui_shutdown_request || (!ltr_int_gui_lock(false)) || no_slaves ||
         (ltr_int_get_tracking_state() < LINUXTRACK_OK)) {
       break;
     }
-
-    close_conn = false;
-    for (i = 0; i < current_len; ++i) {
-      descs[i].revents = 0;
+    // the tick keeps an eye on the gui lock and paces the heartbeat;
+    //   nobody else can take the lock from the gui
+    bool tick = standalone_master || (ltr_int_get_tracking_state() == PAUSED);
+    if (tick != ticking) {
+      loop_set_timer(tick ? TICK_MS : 0);
+      ticking = tick;
+      heartbeat = 0;
     }
-    res = poll(descs, current_len, 2000);
+
+    int res = loop_wait(events, MAX_EVENTS);
     if (res < 0) {
-      ltr_int_my_perror("poll");
-      continue;
-    } else if (res == 0) {
-      if (ltr_int_get_tracking_state() == PAUSED) {
-        ++heartbeat;
-        if (heartbeat > 5) {
-          linuxtrack_full_pose_t dummy;
-          dummy.pose.pitch = 0.0;
-          dummy.pose.yaw = 0.0;
-          dummy.pose.roll = 0.0;
-          dummy.pose.tx = 0.0;
-          dummy.pose.ty = 0.0;
-          dummy.pose.tz = 0.0;
-          dummy.pose.counter = 0;
-          dummy.pose.status = PAUSED;
-          dummy.blobs = 0;
-          ltr_int_broadcast_pose(dummy);
-          heartbeat = 0;
-        }
-      } else {
-        heartbeat = 0;
+      if (errno != EINTR) {
+        ltr_int_my_perror("loop_wait");
       }
       continue;
     }
-    for (i = 0; i < current_len; ++i) {
-      if (descs[i].revents == 0) {
-        continue;
-      }
-      if (descs[i].revents) {
-        if (descs[i].revents & POLLIN) {
-          if (descs[i].fd == socket) {
-            do {
-              new_fd =
-                  accept(socket, (struct sockaddr *)&address, &address_len);
-              if (new_fd < 0) {
-                if (errno != EWOULDBLOCK) {
-                  ltr_int_my_perror("accept");
-                }
-                // No more connection requests
-                break;
-              } else {
-                add_poll_desc(new_fd);
-              }
-            } while (new_fd >= 0);
-          } else {
-            message_t msg;
-            msg.cmd = CMD_NOP;
-            ssize_t x =
-                ltr_int_socket_receive(descs[i].fd, &msg, sizeof(message_t));
-            // ltr_int_log_message("Read %d bytes from fd %d.\n", (int)x,
-            // descs[i].fd);
-            if (x < 0) {
-              if (x != -EWOULDBLOCK) {
-                ltr_int_log_message("Unexpected error %d reading from fd %d.\n",
-                                    x, descs[i].fd);
-                close_conn = true;
-                descs[i].fd = -1;
-              }
-            } else if (x == 0) {
-              // close_conn = true;
-              // descs[i].fd = -1;
-            } else {
-              // ltr_int_log_message("Received a message from slave (%d)!!!\n",
-              // msg.cmd);
-              switch (msg.cmd) {
-              case CMD_PAUSE:
-                ltr_int_suspend_cmd();
-                break;
-              case CMD_WAKEUP:
-                ltr_int_wakeup_cmd();
-                break;
-              case CMD_RECENTER:
-                ltr_int_recenter_cmd();
-                break;
-              case CMD_NEW_SOCKET:
-                // ltr_int_log_message("Cmd to register new slave...\n");
-                ltr_int_register_slave(descs[i].fd, msg);
-                break;
-              case CMD_FRAMES:
-                ltr_int_publish_frames_cmd();
-                break;
-              }
-            }
-          }
+    for (int i = 0; i < res; ++i) {
+      connection *c = events[i].conn;
+      unsigned int what = events[i].what;
+      switch (c->kind) {
+      case CONN_TIMER:
+        loop_drain(c);
+        heartbeat_tick(heartbeat);
+        break;
+      case CONN_WAKEUP:
+        loop_drain(c);
+        break;
+      case CONN_LISTENER:
+        accept_connections(socket);
+        break;
+      case CONN_CLIENT:
+        if (c->closing) {
+          break;
+        }
+        if ((what & LOOP_READ) && !receive_message(c)) {
+          what |= LOOP_HUP;
         }
-        if (descs[i].revents & POLLHUP) {
-          ltr_int_log_message("Hangup at fd %d\n", descs[i].fd);
-          close_conn = true;
+        if (what & LOOP_WRITE) {
+          std::lock_guard<std::mutex> guard(send_mx);
+          flush_outbound(c);
         }
+        if (what & LOOP_HUP) {
+          ltr_int_log_message("Hangup at fd %d\n", c->fd);
+          // the same connection can come again in this batch
+          c->closing = true;
+          closing.push_back(c);
+        }
+        break;
       }
     }
-    if (close_conn) {
-      remove_poll_desc();
+    for (connection *c : closing) {
+      close_connection(c);
     }
+    closing.clear();
+  }
+
+  loop_set_timer(0);
+  {
+    std::lock_guard<std::mutex> guard(send_mx);
+    connections.erase(socket);
   }
+  while (!connections.empty()) {
+    close_connection(&(connections.begin()->second));
+  }
+  loop_close();
   return 0;
 }
 
+static void close_pose_ring() {
+  std::lock_guard<std::mutex> guard(ring_mx);
+  if (pose_ring == nullptr) {
+    return;
+  }
+  uint32_t dropped = __atomic_load_n(&(pose_ring->dropped), __ATOMIC_RELAXED);
+  if (dropped > 0) {
+    ltr_int_log_message("Slaves fell behind by %u poses in total.\n", dropped);
+  }
+  pose_ring = nullptr;
+  ltr_int_unmap_file(&ring_mmm);
+  for (int n = 0; n < POSE_RING_PROFILES; ++n) {
+    if (profiles[n].users > 0) {
+      profiles[n].users = 0;
+      ltr_int_close_axes(&(profiles[n].axes));
+    }
+  }
+}
+
 // Try making sure, that gui will be the only master
 //   - opening and locking socket in the gui constructor?
 //   - when master running already, make it close to let us jump to its place???
@@ -402,6 +868,7 @@ bool ltr_int_master(bool standalone) {
   int socket;
 
   save_prefs = standalone;
+  standalone_master = standalone;
   if (standalone) {
     // Detach from the caller, retaining stdin/out/err
     //  Does weird things to gui ;)
@@ -435,11 +902,18 @@ bool ltr_int_master(bool standalone) {
     return true;
   }
   ltr_int_log_message("Starting as master!\n");
+  pose_ring = ltr_int_pose_ring_open(&ring_mmm);
+  if (pose_ring == nullptr) {
+    close(socket);
+    unlink(ltr_int_master_socket_name());
+    return false;
+  }
   if (ltr_int_init() != 0) {
     ltr_int_log_message("Could not initialize tracking!\n");
     ltr_int_log_message("Closing socket %d\n", socket);
     close(socket);
     unlink(ltr_int_master_socket_name());
+    close_pose_ring();
     return false;
   }
 
@@ -453,6 +927,7 @@ bool ltr_int_master(bool standalone) {
   ltr_int_log_message("Master closing socket %d\n", socket);
   close(socket);
   unlink(ltr_int_master_socket_name());
+  close_pose_ring();
   ltr_int_gui_lock_clean();
   int cntr = 10;
   while ((ltr_int_get_tracking_state() != STOPPED) && (cntr > 0)) {
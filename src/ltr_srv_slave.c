@@ -1,6 +1,9 @@
 #include "ipc_utils.h"
+#include "latency_trace.h"
 #include "ltr_srv_comm.h"
 #include "ltr_srv_master.h"
+#include "pose_history.h"
+#include "pose_ring.h"
 #include "pref.h"
 #include "tracking.h"
 #include "utils.h"
@@ -11,12 +14,14 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 static struct mmap_s mmm;
 static int master_uplink = -1;
 static pthread_t reader_tid;
+static pthread_t pose_tid;
 static char *profile_name = NULL;
 static ltr_axes_t axes;
 static bool master_works = false;
@@ -122,10 +127,102 @@ static bool ltr_int_try_start_master(int *l_master_uplink) {
 
 static linuxtrack_pose_t prev_filtered_pose;
 
-static bool ltr_int_process_message(int l_master_uplink) {
-  message_t msg;
+// Slot of our profile's poses filtered by the master, -1 if there's none
+static int profile_slot = -1;
+
+// Fills in the channel pose the way older clients read it, and the full
+//   capture times past it.
+static void ltr_int_comm_set_pose(struct ltr_comm *com,
+                                  const linuxtrack_full_pose_t *pose) {
+  ltr_comm_pose_t *p = &(com->full_pose);
+  p->prev_pose = prev_filtered_pose;
+  p->pose = pose->pose;
+  p->prev_abs_pose = pose->prev_abs_pose;
+  p->abs_pose = pose->abs_pose;
+  p->blobs = pose->blobs;
+  memcpy(p->blob_list, pose->blob_list, sizeof(p->blob_list));
+  p->timestamp = ltr_int_legacy_ts(pose->timestamp);
+  p->prev_timestamp = ltr_int_legacy_ts(pose->prev_timestamp);
+  com->timestamp = pose->timestamp;
+  com->prev_timestamp = pose->prev_timestamp;
+}
+
+static void ltr_int_process_pose(linuxtrack_full_pose_t *pose, bool filtered) {
   struct ltr_comm *com;
   linuxtrack_pose_t unfiltered;
+  // printf("Have new pose!\n");
+  // printf(">>>>%f %f %f\n", pose->raw_yaw, pose->raw_pitch,
+  // pose->raw_tz);
+  if (!filtered) {
+    ltr_int_postprocess_axes(axes, &(pose->pose), &unfiltered);
+  }
+  if (pose->pose.status == RUNNING) {
+    ltr_int_trace_point(LTR_TRACE_POSTPROCESS, pose->timestamp);
+  }
+  // printf(">>>>%f %f %f\n", pose->yaw, pose->pitch, pose->tz);
+
+  com = mmm.data;
+  // the lock only keeps out clients predating the seq counter
+  ltr_int_lockSemaphore(mmm.sem);
+  ltr_int_seq_write_begin(&(com->seq));
+  // printf("STATUS: %d\n", pose->status);
+  if (pose->pose.status == RUNNING) {
+    // printf("PASSING TO SHM: %f %f %f\n", pose->yaw, pose->pitch,
+    // pose->tz);
+    ltr_int_comm_set_pose(com, pose);
+    prev_filtered_pose = pose->pose;
+    ltr_int_pose_history_push(ltr_int_comm_history(com), pose->timestamp,
+                              &(pose->pose));
+  }
+  com->state = pose->pose.status;
+  com->preparing_start = false;
+  ltr_int_seq_write_end(&(com->seq));
+  ltr_int_unlockSemaphore(mmm.sem);
+  // pairs with the client counting itself in waiters before it reads seq
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&(com->waiters), __ATOMIC_RELAXED) != 0) {
+    ltr_int_futex_wake(&(com->seq));
+  }
+  if (notify && (notify_pipe > 0)) {
+    uint8_t tmp = 0;
+    if (write(notify_pipe, &tmp, 1) < 0) {
+      // Don't report, it would overfill logs
+    }
+  }
+}
+
+// Poses come through the master's shared ring; the uplink socket only
+//   carries control messages. The reader thread raises ring_remap after
+//   every (re)connection and the pose thread maps the ring anew.
+static struct mmap_s ring_mmm;
+static pose_ring_reader_t ring_reader;
+static uint32_t ring_remap = 0;
+
+#ifndef __linux__
+// Without futexes there's nothing to sleep on in the ring; the master
+//   follows each pose with a CMD_POSE message and the reader thread passes
+//   it on to the pose thread through this pipe.
+static int pose_wakeup[2] = {-1, -1};
+#endif
+
+static void ltr_int_wake_pose_thread() {
+#ifdef __linux__
+  ltr_int_futex_wake(&ring_remap);
+#else
+  uint8_t tmp = 0;
+  if (write(pose_wakeup[1], &tmp, 1) < 0) {
+    // pipe full, the pose thread has a wakeup pending anyway
+  }
+#endif
+}
+
+static void ltr_int_request_ring_remap() {
+  __atomic_store_n(&ring_remap, 1, __ATOMIC_SEQ_CST);
+  ltr_int_wake_pose_thread();
+}
+
+static bool ltr_int_process_message(int l_master_uplink) {
+  message_t msg;
   ssize_t bytesRead =
       ltr_int_socket_receive(l_master_uplink, &msg, sizeof(message_t));
   if (bytesRead < 0) {
@@ -140,35 +237,13 @@ static bool ltr_int_process_message(int l_master_uplink) {
   case CMD_NOP:
     break;
   case CMD_POSE:
-    // printf("Have new pose!\n");
-    // printf(">>>>%f %f %f\n", msg.pose.raw_yaw, msg.pose.raw_pitch,
-    // msg.pose.raw_tz);
-    ltr_int_postprocess_axes(axes, &(msg.pose.pose), &unfiltered);
-    // printf(">>>>%f %f %f\n", msg.pose.yaw, msg.pose.pitch, msg.pose.tz);
-    // printf("Raw center: %f  %f  %f\n", msg.pose.pose.raw_tx,
-    // msg.pose.pose.raw_ty, msg.pose.pose.raw_tz); printf("Raw angles: %f  %f
-    // %f\n", msg.pose.pose.raw_pitch, msg.pose.pose.raw_yaw,
-    // msg.pose.pose.raw_roll);
-
-    com = mmm.data;
-    ltr_int_lockSemaphore(mmm.sem);
-    // printf("STATUS: %d\n", msg.pose.status);
-    if (msg.pose.pose.status == RUNNING) {
-      // printf("PASSING TO SHM: %f %f %f\n", msg.pose.yaw, msg.pose.pitch,
-      // msg.pose.tz);
-      com->full_pose = msg.pose;
-      com->full_pose.prev_pose = prev_filtered_pose;
-      prev_filtered_pose = msg.pose.pose;
-    }
-    com->state = msg.pose.pose.status;
-    com->preparing_start = false;
-    ltr_int_unlockSemaphore(mmm.sem);
-    if (notify && (notify_pipe > 0)) {
-      uint8_t tmp = 0;
-      if (write(notify_pipe, &tmp, 1) < 0) {
-        // Don't report, it would overfill logs
-      }
-    }
+    // the pose itself is in the ring already
+    ltr_int_wake_pose_thread();
+    break;
+  case CMD_PROFILE:
+    ltr_int_log_message("Master postprocesses profile '%s' in slot %u.\n",
+                        profile_name, msg.data);
+    __atomic_store_n(&profile_slot, (int)msg.data, __ATOMIC_RELAXED);
     break;
   case CMD_PARAM:
     // printf("Changing %s of %s to %f!!!\n",
@@ -212,6 +287,62 @@ static bool ltr_int_process_message(int l_master_uplink) {
 
 static bool quit_flag;
 
+// Sleeps until the ring has a pose we haven't read yet (timeout in ms);
+//   remap requests cut the sleep short. Returns false when there's none.
+static bool ltr_int_wait_ring(pose_ring_t *ring, int timeout) {
+#ifdef __linux__
+  if (ring == NULL) {
+    ltr_int_futex_wait(&ring_remap, 0, timeout);
+    return false;
+  }
+  return ltr_int_pose_ring_wait(&ring_reader, timeout);
+#else
+  if ((ring != NULL) && ltr_int_pose_ring_wait(&ring_reader, 0)) {
+    return true;
+  }
+  if (ltr_int_pipe_poll(pose_wakeup[0], timeout, NULL) > 0) {
+    uint8_t tmp[64];
+    while (read(pose_wakeup[0], tmp, sizeof(tmp)) > 0) {
+    }
+  }
+  return (ring != NULL) && ltr_int_pose_ring_wait(&ring_reader, 0);
+#endif
+}
+
+static void *ltr_int_slave_pose_thread(void *param) {
+  (void)param;
+  linuxtrack_full_pose_t pose;
+  bool filtered;
+  pose_ring_t *ring = NULL;
+  while (!quit_flag && parent_alive()) {
+    if (__atomic_exchange_n(&ring_remap, 0, __ATOMIC_SEQ_CST)) {
+      if (ring != NULL) {
+        ltr_int_pose_ring_detach(&ring_mmm);
+      }
+      ring = ltr_int_pose_ring_map(&ring_mmm);
+      if (ring != NULL) {
+        ltr_int_pose_ring_attach(&ring_reader, ring);
+      }
+    }
+    if (!ltr_int_wait_ring(ring, 1000)) {
+      continue;
+    }
+    int slot = __atomic_load_n(&profile_slot, __ATOMIC_RELAXED);
+    while (ltr_int_pose_ring_read_profile(&ring_reader, slot, &pose,
+                                          &filtered)) {
+      ltr_int_process_pose(&pose, filtered);
+    }
+  }
+  if (ring != NULL) {
+    if (ring_reader.dropped > 0) {
+      ltr_int_log_message("Slave fell behind the master by %u poses.\n",
+                          ring_reader.dropped);
+    }
+    ltr_int_pose_ring_detach(&ring_mmm);
+  }
+  return NULL;
+}
+
 static void *ltr_int_slave_reader_thread(void *param) {
   ltr_int_log_message("Slave reader thread function entered!\n");
   (void)param;
@@ -222,6 +353,9 @@ static void *ltr_int_slave_reader_thread(void *param) {
       break;
     }
     ltr_int_log_message("Master Uplink %d\n", master_uplink);
+    // a new master hands out its own profile slots
+    __atomic_store_n(&profile_slot, -1, __ATOMIC_RELAXED);
+    ltr_int_request_ring_remap();
     int poll_errs = 0;
     struct pollfd uplink_poll = {
         .fd = master_uplink, .events = POLLIN, .revents = 0};
@@ -270,6 +404,8 @@ static void ltr_int_slave_main_loop() {
   ltr_cmd cmd = NOP_CMD;
   bool recenter = false;
   while (!quit_flag) {
+    // read before looking at the commands, so none posted after slips by
+    uint32_t cmd_seq = __atomic_load_n(&(com->cmd_seq), __ATOMIC_ACQUIRE);
     if ((com->cmd != NOP_CMD) || com->recenter || com->notify) {
       ltr_int_lockSemaphore(mmm.sem);
       cmd = (ltr_cmd)com->cmd;
@@ -323,7 +459,19 @@ static void ltr_int_slave_main_loop() {
       // printf("Parent %lu died! (3)\n", (unsigned long)ppid);
       break;
     }
+#ifdef __linux__
+    if ((cmd_seq == 0) || recenter) {
+      // client that doesn't signal, or a recenter to retry
+      usleep(100000);
+    } else {
+      // the timeout only serves to notice the parent is gone
+      ltr_int_futex_wait(&(com->cmd_seq), cmd_seq, 1000);
+    }
+#else
+    // no futex to sleep on; waiting on cmd_seq would only poll it faster
+    (void)cmd_seq;
     usleep(100000);
+#endif
   }
 }
 
@@ -353,16 +501,35 @@ bool ltr_int_slave(const char *c_profile, const char *c_com_file,
   ltr_int_init_axes(&axes, profile_name);
   // Prepare client comm channel
   char *com_file = ltr_int_my_strdup(c_com_file);
-  if (!ltr_int_mmap_file(com_file, sizeof(struct ltr_comm), &mmm)) {
+  if (!ltr_int_mmap_file(com_file, LTR_COMM_FILE_SIZE, &mmm)) {
     ltr_int_log_message("Couldn't mmap file!!!\n");
     return false;
   }
   free(com_file);
+  struct ltr_comm *com = mmm.data;
+  ltr_int_pose_history_reset(ltr_int_comm_history(com));
+  __atomic_store_n(&(com->version), LTR_COMM_VERSION, __ATOMIC_RELEASE);
+  __atomic_store_n(&(com->has_seq), true, __ATOMIC_RELEASE);
+
+#ifndef __linux__
+  if (pipe(pose_wakeup) != 0) {
+    ltr_int_my_perror("pipe");
+    return false;
+  }
+  fcntl(pose_wakeup[0], F_SETFL, fcntl(pose_wakeup[0], F_GETFL) | O_NONBLOCK);
+  fcntl(pose_wakeup[1], F_SETFL, fcntl(pose_wakeup[1], F_GETFL) | O_NONBLOCK);
+#endif
 
   quit_flag = false;
   if (pthread_create(&reader_tid, NULL, ltr_int_slave_reader_thread, NULL) ==
       0) {
-    ltr_int_slave_main_loop();
+    if (pthread_create(&pose_tid, NULL, ltr_int_slave_pose_thread, NULL) ==
+        0) {
+      ltr_int_slave_main_loop();
+      pthread_join(pose_tid, NULL);
+    } else {
+      quit_flag = true;
+    }
     pthread_join(reader_tid, NULL);
   }
   close_master_comms(&master_uplink);
@@ -373,5 +540,9 @@ bool ltr_int_slave(const char *c_profile, const char *c_com_file,
   free(profile_name);
   ltr_int_gui_lock_clean();
   close(notify_pipe);
+#ifndef __linux__
+  close(pose_wakeup[0]);
+  close(pose_wakeup[1]);
+#endif
   return true;
 }
@@ -65,7 +65,7 @@ typedef struct __attribute__((packed)) {
 typedef enum { PROTO_OPENTRACK, PROTO_FREETRACK } proto_t;
 
 int main(int argc, char *argv[]) {
-  linuxtrack_pose_t pose;
+  linuxtrack_pose_t pose = {0};
   // Blobs buffer required by API even if we don't use it
   float blobs[30];
   int blobs_read;
@@ -143,17 +143,15 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  // Enable notifications so we get pose updates
-  linuxtrack_notification_on();
-  printf("ltr_udp: Notifications enabled, starting main loop.\n");
+  printf("ltr_udp: Starting main loop.\n");
 
   // Main Loop
   long frame_count = 0;
 
   while (keep_running) {
-    // Wait for frame (blocking wait to reduce CPU usage)
-    // Wait BEFORE getting data, match original osc_server cadence
-    linuxtrack_wait(10);
+    // Block until the tracker publishes a pose newer than the last one
+    // (the timeout keeps packets flowing while tracking is paused)
+    linuxtrack_wait_pose(pose.counter, 10);
 
     int result = linuxtrack_get_pose_full(&pose, blobs, 10, &blobs_read);
 
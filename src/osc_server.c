@@ -136,7 +136,6 @@ bool intialize_tracking(void)
     state = linuxtrack_get_tracking_state();
     printf("Status: %s\n", linuxtrack_explain(state));
     if((state == RUNNING) || (state == PAUSED)){
-      linuxtrack_notification_on();
       return true;
     }
     usleep(1000000);
@@ -211,7 +210,7 @@ int main(int argc, char *argv[])
           blobSort(blobsRead);
           sendPose(t);
         }
-        linuxtrack_wait(3333);
+        linuxtrack_wait_pose(pose.counter, 3333);
       }
     }
 
@@ -0,0 +1,236 @@
+#include <float.h>
+#include <math.h>
+#include "p3p.h"
+
+#define CUBIC_ITERATIONS 50
+#define REFINE_ITERATIONS 5
+
+static double dist2(double a[3], double b[3])
+{
+  double x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+  return x * x + y * y + z * z;
+}
+
+static double dot(double a[3], double b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Real roots of x^2 + b*x + c, computed without cancellation
+static int root2real(double b, double c, double *r1, double *r2)
+{
+  double v = b * b - 4.0 * c;
+  if(v < 0.0){
+    *r1 = *r2 = -0.5 * b;
+    return 0;
+  }
+  double y = sqrt(v);
+  *r1 = (b < 0.0) ? 0.5 * (-b + y) : 0.5 * (-b - y);
+  *r2 = c / *r1;
+  return 2;
+}
+
+// One real root of x^3 + b*x^2 + c*x + d; the starting point is picked
+//   so Newton's method can't end up oscillating around a stationary point.
+static double cubic_root(double b, double c, double d)
+{
+  double r0;
+  if(b * b >= 3.0 * c){
+    double v = sqrt(b * b - 3.0 * c);
+    double t1 = (-b - v) / 3.0;
+    double k = ((t1 + b) * t1 + c) * t1 + d;
+    if(k > 0.0){
+      r0 = t1 - sqrt(-k / (3.0 * t1 + b));
+    }else{
+      double t2 = (-b + v) / 3.0;
+      k = ((t2 + b) * t2 + c) * t2 + d;
+      r0 = t2 + sqrt(-k / (3.0 * t2 + b));
+    }
+  }else{
+    r0 = -b / 3.0;
+    if(fabs((3.0 * r0 + 2.0 * b) * r0 + c) < 1e-4){
+      r0 += 1.0;
+    }
+  }
+  int i;
+  for(i = 0; i < CUBIC_ITERATIONS; ++i){
+    double fx = ((r0 + b) * r0 + c) * r0 + d;
+    if((i >= 7) && (fabs(fx) <= DBL_EPSILON)){
+      break;
+    }
+    double fpx = (3.0 * r0 + 2.0 * b) * r0 + c;
+    if(fpx == 0.0){
+      break;
+    }
+    r0 -= fx / fpx;
+  }
+  return r0;
+}
+
+// Eigen decomposition of a symmetric matrix known to be singular;
+//   the eigenvectors of the two nonzero eigenvalues go to e1 and e2.
+static void eig_known0(double m[3][3], double e1[3], double e2[3],
+                       double *l1, double *l2)
+{
+  double m01_sq = m[0][1] * m[0][1];
+  double b = -m[0][0] - m[1][1] - m[2][2];
+  double c = -m01_sq - m[0][2] * m[0][2] - m[1][2] * m[1][2] +
+             m[0][0] * (m[1][1] + m[2][2]) + m[1][1] * m[2][2];
+  double r1, r2;
+  root2real(b, c, &r1, &r2);
+  if(fabs(r1) < fabs(r2)){
+    double tmp = r1;
+    r1 = r2;
+    r2 = tmp;
+  }
+  *l1 = r1;
+  *l2 = r2;
+
+  double mx0011 = -m[0][0] * m[1][1];
+  double prec_0 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+  double prec_1 = m[0][1] * m[0][2] - m[0][0] * m[1][2];
+  double *vecs[2] = {e1, e2};
+  double vals[2] = {r1, r2};
+  int i;
+  for(i = 0; i < 2; ++i){
+    double e = vals[i];
+    double tmp = 1.0 / (e * (m[0][0] + m[1][1]) + mx0011 - e * e + m01_sq);
+    double a1 = -(e * m[0][2] + prec_0) * tmp;
+    double a2 = -(e * m[1][2] + prec_1) * tmp;
+    double rnorm = 1.0 / sqrt(a1 * a1 + a2 * a2 + 1.0);
+    vecs[i][0] = a1 * rnorm;
+    vecs[i][1] = a2 * rnorm;
+    vecs[i][2] = rnorm;
+  }
+}
+
+static double residual(double l[3], double a12, double a13, double a23,
+                       double b12, double b13, double b23, double r[3])
+{
+  r[0] = l[0] * l[0] + l[1] * l[1] + b12 * l[0] * l[1] - a12;
+  r[1] = l[0] * l[0] + l[2] * l[2] + b13 * l[0] * l[2] - a13;
+  r[2] = l[1] * l[1] + l[2] * l[2] + b23 * l[1] * l[2] - a23;
+  return fabs(r[0]) + fabs(r[1]) + fabs(r[2]);
+}
+
+// Few Gauss-Newton steps on the three distance equations
+static void refine(double l[3], double a12, double a13, double a23,
+                   double b12, double b13, double b23)
+{
+  int i;
+  double r[3];
+  double err = residual(l, a12, a13, a23, b12, b13, b23, r);
+  for(i = 0; (i < REFINE_ITERATIONS) && (err > 1e-10); ++i){
+    double v0 = 2.0 * l[0] + b12 * l[1];
+    double v1 = 2.0 * l[1] + b12 * l[0];
+    double v3 = 2.0 * l[0] + b13 * l[2];
+    double v5 = 2.0 * l[2] + b13 * l[0];
+    double v7 = 2.0 * l[1] + b23 * l[2];
+    double v8 = 2.0 * l[2] + b23 * l[1];
+    double det = -v0 * v5 * v7 - v1 * v3 * v8;
+    if(det == 0.0){
+      break;
+    }
+    det = 1.0 / det;
+    double n[3];
+    n[0] = l[0] - det * (-v5 * v7 * r[0] - v1 * v8 * r[1] + v1 * v5 * r[2]);
+    n[1] = l[1] - det * (-v3 * v8 * r[0] + v0 * v8 * r[1] - v0 * v5 * r[2]);
+    n[2] = l[2] - det * (v3 * v7 * r[0] - v0 * v7 * r[1] - v1 * v3 * r[2]);
+    double nr[3];
+    double n_err = residual(n, a12, a13, a23, b12, b13, b23, nr);
+    if(n_err > err){
+      break;
+    }
+    l[0] = n[0]; l[1] = n[1]; l[2] = n[2];
+    r[0] = nr[0]; r[1] = nr[1]; r[2] = nr[2];
+    err = n_err;
+  }
+}
+
+int ltr_int_p3p(double bearings[3][3], double model[3][3],
+                double depths[P3P_MAX_SOLUTIONS][3])
+{
+  double b12 = -2.0 * dot(bearings[0], bearings[1]);
+  double b13 = -2.0 * dot(bearings[0], bearings[2]);
+  double b23 = -2.0 * dot(bearings[1], bearings[2]);
+  double a12 = dist2(model[0], model[1]);
+  double a13 = dist2(model[0], model[2]);
+  double a23 = dist2(model[1], model[2]);
+
+  double c31 = -0.5 * b13;
+  double c23 = -0.5 * b23;
+  double c12 = -0.5 * b12;
+  double blob = c12 * c23 * c31 - 1.0;
+  double s31_sq = 1.0 - c31 * c31;
+  double s23_sq = 1.0 - c23 * c23;
+  double s12_sq = 1.0 - c12 * c12;
+
+  // cubic whose root makes the pencil of the two conics degenerate
+  double p3 = a13 * (a23 * s31_sq - a13 * s23_sq);
+  double p2 = 2.0 * blob * a23 * a13 + a13 * (2.0 * a12 + a13) * s23_sq +
+              a23 * (a23 - a12) * s31_sq;
+  double p1 = a23 * (a13 - a23) * s12_sq - a12 * a12 * s23_sq -
+              2.0 * a12 * (blob * a23 + a13 * s23_sq);
+  double p0 = a12 * (a12 * s23_sq - a23 * s12_sq);
+  if(p3 == 0.0){
+    return 0;
+  }
+  double g = cubic_root(p2 / p3, p1 / p3, p0 / p3);
+
+  double m[3][3];
+  m[0][0] = a23 * (1.0 - g);
+  m[0][1] = m[1][0] = a23 * b12 * 0.5;
+  m[0][2] = m[2][0] = a23 * b13 * g * -0.5;
+  m[1][1] = a23 - a12 + a13 * g;
+  m[1][2] = m[2][1] = b23 * (a13 * g - a12) * 0.5;
+  m[2][2] = g * (a13 - a23) - a12;
+
+  double e1[3], e2[3], l1, l2;
+  eig_known0(m, e1, e2, &l1, &l2);
+  double v = -l2 / l1;
+  v = (v > 0.0) ? sqrt(v) : 0.0;
+
+  // the degenerate conic is a pair of lines; each one meets the other
+  //   conic in at most two points
+  int valid = 0;
+  int sign;
+  for(sign = 0; sign < 2; ++sign){
+    double s = (sign == 0) ? v : -v;
+    double w2 = 1.0 / (s * e2[0] - e1[0]);
+    double w0 = (e1[1] - s * e2[1]) * w2;
+    double w1 = (e1[2] - s * e2[2]) * w2;
+    double a = 1.0 / ((a13 - a12) * w1 * w1 - a12 * b13 * w1 - a12);
+    double b = (a13 * b12 * w1 - a12 * b13 * w0 - 2.0 * w0 * w1 * (a12 - a13)) * a;
+    double c = ((a13 - a12) * w0 * w0 + a13 * b12 * w0 + a13) * a;
+    double taus[2];
+    if(root2real(b, c, &taus[0], &taus[1]) == 0){
+      continue;
+    }
+    int i;
+    for(i = 0; i < 2; ++i){
+      double tau = taus[i];
+      if(tau <= 0.0){
+        continue;
+      }
+      double d = a23 / (tau * (b23 + tau) + 1.0);
+      if(d <= 0.0){
+        continue;
+      }
+      double l[3];
+      l[1] = sqrt(d);
+      l[2] = tau * l[1];
+      l[0] = w0 * l[1] + w1 * l[2];
+      if(l[0] < 0.0){
+        continue;
+      }
+      refine(l, a12, a13, a23, b12, b13, b23);
+      if(isfinite(l[0]) && isfinite(l[1]) && isfinite(l[2])){
+        depths[valid][0] = l[0];
+        depths[valid][1] = l[1];
+        depths[valid][2] = l[2];
+        ++valid;
+      }
+    }
+  }
+  return valid;
+}
@@ -0,0 +1,23 @@
+#ifndef P3P__H
+#define P3P__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define P3P_MAX_SOLUTIONS 4
+
+// Closed form perspective-3-point solver (Lambda Twist, Persson & Nordberg
+//   2018). Given unit bearing vectors from the camera towards three points
+//   and the points' positions in the model, finds the distances of the
+//   points from the camera; point i then sits at depths[k][i] * bearings[i].
+//   Returns the number of solutions (0 - P3P_MAX_SOLUTIONS).
+//   The cost is bounded: no loop runs more than a fixed number of times.
+int ltr_int_p3p(double bearings[3][3], double model[3][3],
+                double depths[P3P_MAX_SOLUTIONS][3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,6 +3,8 @@
 #include <assert.h>
 #include "pose.h"
 #include "math_utils.h"
+#include "p3p.h"
+#include "blob_track.h"
 #include "tracking.h"
 #include "cal.h"
 #include "utils.h"
@@ -34,6 +36,11 @@ static double tr_rot[3][3];
 
 static double tr_rot_base[3][3];
 
+static double prev_points[3][3];
+static bool have_prev_points = false;
+
+static blob_tracker_t blob_tracker;
+
 bool ltr_int_center(double rp0[3], double rp1[3], double rp2[3], double c_base[3],
   double center[3], double tr[3][3]);
 bool ltr_int_get_cbase(double p0[3], double p1[3], double p2[3], double c[3],
@@ -140,6 +147,8 @@ bool ltr_int_pose_init(struct reflector_model_type rm)
   bool res = ltr_int_get_cbase(rm.p0, rm.p1, rm.p2, rm.hc, c_base) &&
     ltr_int_center(rm.p0, rm.p1, rm.p2, c_base, tr_center, tr_rot);
   ltr_int_assign_matrix(tr_rot, tr_rot_base);
+  have_prev_points = false;
+  ltr_int_blob_track_reset(&blob_tracker);
   return res;
 }
 
@@ -354,6 +363,84 @@ static void alter_pose(struct bloblist_type blobs, double points[3][3], bool cen
 }
 
 
+// How well the triangle faces the camera the same way the model does
+static double facing_score(double points[3][3])
+{
+  double v1[3], v2[3], n_pts[3], n_model[3];
+  ltr_int_make_vec(points[1], points[0], v1);
+  ltr_int_make_vec(points[2], points[0], v2);
+  ltr_int_cross_product(v1, v2, n_pts);
+  ltr_int_make_vec(model_point1, model_point0, v1);
+  ltr_int_make_vec(model_point2, model_point0, v2);
+  ltr_int_cross_product(v1, v2, n_model);
+  return ltr_int_dot_product(n_pts, n_model) /
+         (ltr_int_vec_size(n_pts) * ltr_int_vec_size(n_model));
+}
+
+static double prev_points_dist(double points[3][3])
+{
+  double tmp[3];
+  double res = 0.0;
+  int i;
+  for(i = 0; i < 3; ++i){
+    ltr_int_make_vec(points[i], prev_points[i], tmp);
+    res += ltr_int_dot_product(tmp, tmp);
+  }
+  return res;
+}
+
+// Closed form P3P; of the up to four candidates takes the one closest to
+//   the previous frame. When centering (or with no history) the user faces
+//   the camera, so the candidate oriented like the model wins.
+static bool p3p_pose(struct bloblist_type blobs, double points[3][3], bool centering)
+{
+  double bearings[3][3];
+  double model[3][3];
+  double depths[P3P_MAX_SOLUTIONS][3];
+  int i, j;
+
+  internal_focal_depth = ltr_int_get_focal_length();
+  for(i = 0; i < 3; ++i){
+    bearings[i][0] = blobs.blobs[i].x;
+    bearings[i][1] = blobs.blobs[i].y;
+    bearings[i][2] = internal_focal_depth;
+    ltr_int_normalize_vec(bearings[i]);
+  }
+  for(i = 0; i < 3; ++i){
+    model[0][i] = model_point0[i];
+    model[1][i] = model_point1[i];
+    model[2][i] = model_point2[i];
+  }
+  int n = ltr_int_p3p(bearings, model, depths);
+  if(n == 0){
+    return false;
+  }
+  bool by_facing = centering || !have_prev_points;
+  double best_score = 0.0;
+  for(j = 0; j < n; ++j){
+    double cand[3][3];
+    for(i = 0; i < 3; ++i){
+      ltr_int_mul_vec(bearings[i], depths[j][i], cand[i]);
+    }
+    double score = by_facing ? -facing_score(cand) : prev_points_dist(cand);
+    if((j == 0) || (score < best_score)){
+      best_score = score;
+      ltr_int_assign_matrix(cand, points);
+    }
+  }
+  ltr_int_assign_matrix(points, prev_points);
+  have_prev_points = true;
+
+  if(pts_dbg_flag == DBG_ON){
+    printf("RAW 3D points\n");
+    printf("RAW: %g %g %g\n", points[0][0], points[0][1], points[0][2]);
+    printf("RAW: %g %g %g\n", points[1][0], points[1][1], points[1][2]);
+    printf("RAW: %g %g %g\n", points[2][0], points[2][1], points[2][2]);
+  }
+  return true;
+}
+
+
 void ltr_int_pose_sort_blobs(struct bloblist_type bl)
 {
   struct blob_type tmp_blob;
@@ -434,6 +521,22 @@ void ltr_int_pose_sort_blobs(struct bloblist_type bl)
 }
 
 
+void ltr_int_pose_match_blobs(struct bloblist_type *bl)
+{
+  if(((type != M_CAP) && (type != M_CLIP)) || !ltr_int_use_blob_tracking()){
+    ltr_int_pose_sort_blobs(*bl);
+    return;
+  }
+  if(ltr_int_blob_track_match(&blob_tracker, bl)){
+    return;
+  }
+  //lost track - fall back to the geometry and start over from there
+  ltr_int_pose_sort_blobs(*bl);
+  if(bl->num_blobs >= 3){
+    ltr_int_blob_track_lock(&blob_tracker, bl->blobs);
+  }
+}
+
 bool ltr_int_pose_process_blobs(struct bloblist_type blobs,
                         linuxtrack_pose_t *pose, linuxtrack_abs_pose_t *abs_pose, bool centering)
 {
@@ -451,7 +554,7 @@ bool ltr_int_pose_process_blobs(struct bloblist_type blobs,
 */
   if(ltr_int_use_alter()){
     alter_pose(blobs, points, centering);
-  }else{
+  }else if(!ltr_int_use_p3p() || !p3p_pose(blobs, points, centering)){
     iter_pose(blobs, points, centering);
   }
 
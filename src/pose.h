@@ -49,6 +49,9 @@ typedef struct reflector_model_type {
 bool ltr_int_pose_init(struct reflector_model_type rm);
 
 void ltr_int_pose_sort_blobs(struct bloblist_type bl);
+/* puts the blobs in model order, following the LEDs from the previous
+ * frames where possible; may change the number of blobs */
+void ltr_int_pose_match_blobs(struct bloblist_type *bl);
 
 bool ltr_int_pose_process_blobs(struct bloblist_type blobs,
                         linuxtrack_pose_t *pose,
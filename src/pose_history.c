@@ -0,0 +1,60 @@
+#include "pose_history.h"
+#include "ipc_utils.h"
+#include <string.h>
+
+void ltr_int_pose_history_reset(pose_history_t *h) {
+  memset(h, 0, sizeof(pose_history_t));
+  h->slots = POSE_HISTORY_SLOTS;
+}
+
+void ltr_int_pose_history_push(pose_history_t *h, int64_t timestamp,
+                               const linuxtrack_pose_t *pose) {
+  uint32_t head = __atomic_load_n(&(h->head), __ATOMIC_RELAXED);
+  pose_history_slot_t *slot = &(h->slot[head % POSE_HISTORY_SLOTS]);
+  ltr_int_seq_write_begin(&(slot->seq));
+  slot->number = head;
+  slot->timestamp = timestamp;
+  slot->pose = *pose;
+  ltr_int_seq_write_end(&(slot->seq));
+  __atomic_store_n(&(h->head), head + 1, __ATOMIC_RELEASE);
+}
+
+// Copies pose number n, false if its slot was reused or is being written
+static bool read_slot(pose_history_t *h, uint32_t n,
+                      linuxtrack_timed_pose_t *out) {
+  pose_history_slot_t *slot = &(h->slot[n % POSE_HISTORY_SLOTS]);
+  uint32_t start = ltr_int_seq_read_begin(&(slot->seq));
+  if (start & 1) {
+    return false;
+  }
+  uint32_t number = __atomic_load_n(&(slot->number), __ATOMIC_RELAXED);
+  out->timestamp = slot->timestamp;
+  out->pose = slot->pose;
+  return ltr_int_seq_read_end(&(slot->seq), start) && (number == n);
+}
+
+int ltr_int_pose_history_read(pose_history_t *h, int64_t from, int64_t to,
+                              linuxtrack_timed_pose_t poses[], int max_poses) {
+  linuxtrack_timed_pose_t tmp[POSE_HISTORY_SLOTS];
+  uint32_t head = __atomic_load_n(&(h->head), __ATOMIC_ACQUIRE);
+  uint32_t avail = (head < POSE_HISTORY_SLOTS) ? head : POSE_HISTORY_SLOTS;
+  int n = 0;
+  uint32_t i;
+  // newest first, so the oldest ones are the ones left out
+  for (i = 1; (i <= avail) && (n < max_poses); ++i) {
+    linuxtrack_timed_pose_t *p = &(tmp[POSE_HISTORY_SLOTS - 1 - n]);
+    if (!read_slot(h, head - i, p)) {
+      // the writer caught up with us; anything older is gone too
+      break;
+    }
+    if (p->timestamp < from) {
+      break;
+    }
+    if (p->timestamp <= to) {
+      ++n;
+    }
+  }
+  memcpy(poses, &(tmp[POSE_HISTORY_SLOTS - n]),
+         n * sizeof(linuxtrack_timed_pose_t));
+  return n;
+}
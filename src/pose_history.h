@@ -0,0 +1,52 @@
+#ifndef POSE_HISTORY__H
+#define POSE_HISTORY__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ltlib.h"
+
+// Recent poses of a client, kept by its slave right after struct ltr_comm
+//   in the client channel file. The slave writes each pose into the next
+//   slot under the slot's sequence counter; clients copy what they need
+//   without taking the channel lock.
+#define POSE_HISTORY_SLOTS 64
+
+// Channel version of servers keeping the history; only then is it mapped there
+#define LTR_COMM_HISTORY 2
+
+typedef struct {
+  uint32_t seq;
+  uint32_t number; // of the pose in this slot, tells overwritten slots
+  ltr_timestamp_t timestamp;
+  linuxtrack_pose_t pose; // filtered pose, along with the raw one
+} pose_history_slot_t;
+
+typedef struct {
+  uint32_t head; // poses written so far
+  uint32_t slots;
+  pose_history_slot_t slot[POSE_HISTORY_SLOTS];
+} pose_history_t;
+
+// Size of the client channel file
+#define LTR_COMM_FILE_SIZE (sizeof(struct ltr_comm) + sizeof(pose_history_t))
+
+static inline pose_history_t *ltr_int_comm_history(struct ltr_comm *com) {
+  return (pose_history_t *)(com + 1);
+}
+
+void ltr_int_pose_history_reset(pose_history_t *h);
+void ltr_int_pose_history_push(pose_history_t *h, int64_t timestamp,
+                               const linuxtrack_pose_t *pose);
+// Copies the newest (at most max_poses) poses captured within [from, to],
+//   oldest first; returns how many were copied.
+int ltr_int_pose_history_read(pose_history_t *h, int64_t from, int64_t to,
+                              linuxtrack_timed_pose_t poses[], int max_poses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
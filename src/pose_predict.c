@@ -0,0 +1,111 @@
+#include "pose_predict.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+static const float c_EXT_LIMIT = 3.0f;
+static const float c_EXT_ASYMPTOTE = 5.0f;
+
+float ltr_int_extrapolation_factor(int64_t t1, int64_t t2, int64_t target) {
+  int64_t dt12 = t2 - t1;
+  int64_t dt = target - t2;
+  if ((dt12 <= 0) || (dt == 0)) {
+    return 0.0f;
+  }
+  float ext = (float)dt / dt12;
+  // Should the extrapolation go further than c_EXT_LIMIT times the frame
+  //   interval, round it out with a -1/x type of curve going through
+  //   [c_EXT_LIMIT; c_EXT_LIMIT] towards c_EXT_ASYMPTOTE.
+  if (ext > c_EXT_LIMIT) {
+    ext = c_EXT_ASYMPTOTE -
+          (c_EXT_LIMIT * (c_EXT_ASYMPTOTE - c_EXT_LIMIT)) / ext;
+  }
+  return ext;
+}
+
+// The pose fields worth predicting
+static float *field(linuxtrack_pose_t *p, int i) {
+  static const size_t offsets[] = {
+      offsetof(linuxtrack_pose_t, pitch),     offsetof(linuxtrack_pose_t, yaw),
+      offsetof(linuxtrack_pose_t, roll),      offsetof(linuxtrack_pose_t, tx),
+      offsetof(linuxtrack_pose_t, ty),        offsetof(linuxtrack_pose_t, tz),
+      offsetof(linuxtrack_pose_t, raw_pitch), offsetof(linuxtrack_pose_t, raw_yaw),
+      offsetof(linuxtrack_pose_t, raw_roll),  offsetof(linuxtrack_pose_t, raw_tx),
+      offsetof(linuxtrack_pose_t, raw_ty),    offsetof(linuxtrack_pose_t, raw_tz)};
+  return (float *)((char *)p + offsets[i]);
+}
+#define FIELDS 12
+
+static float get(const linuxtrack_timed_pose_t *p, int i) {
+  return *field((linuxtrack_pose_t *)&(p->pose), i);
+}
+
+static void interpolate(const linuxtrack_timed_pose_t *a,
+                        const linuxtrack_timed_pose_t *b, int64_t target,
+                        linuxtrack_pose_t *result) {
+  float t = (float)(target - a->timestamp) / (b->timestamp - a->timestamp);
+  int i;
+  for (i = 0; i < FIELDS; ++i) {
+    *field(result, i) = get(a, i) + (get(b, i) - get(a, i)) * t;
+  }
+}
+
+static void extrapolate(const linuxtrack_timed_pose_t poses[], int n,
+                        int64_t target, linuxtrack_predictor_t predictor,
+                        linuxtrack_pose_t *result) {
+  const linuxtrack_timed_pose_t *a = (n > 2) ? &(poses[n - 3]) : NULL;
+  const linuxtrack_timed_pose_t *b = &(poses[n - 2]);
+  const linuxtrack_timed_pose_t *c = &(poses[n - 1]);
+  float ext = ltr_int_extrapolation_factor(b->timestamp, c->timestamp, target);
+  bool accel = (predictor == LINUXTRACK_PREDICT_ACCEL) && (a != NULL) &&
+               (b->timestamp > a->timestamp) && (c->timestamp > b->timestamp);
+  float ratio = 0.0f, share = 0.0f;
+  if (accel) {
+    float t1 = b->timestamp - a->timestamp;
+    float t2 = c->timestamp - b->timestamp;
+    ratio = t2 / t1;
+    share = t2 / (t1 + t2);
+  }
+  int i;
+  for (i = 0; i < FIELDS; ++i) {
+    float step = get(c, i) - get(b, i);
+    float value = get(c, i) + step * ext;
+    if (accel) {
+      // the parabola through the last three poses, in steps of the newest
+      //   frame interval
+      float bend = (step - (get(b, i) - get(a, i)) * ratio) * share *
+                   (ext + ext * ext);
+      // noisy poses must not fling the prediction; at most double the motion
+      float limit = fabsf(step * ext);
+      bend = (bend > limit) ? limit : ((bend < -limit) ? -limit : bend);
+      value += bend;
+    }
+    *field(result, i) = value;
+  }
+}
+
+void ltr_int_predict_pose(const linuxtrack_timed_pose_t poses[], int n,
+                          int64_t target, linuxtrack_predictor_t predictor,
+                          linuxtrack_pose_t *result) {
+  const linuxtrack_timed_pose_t *newest = &(poses[n - 1]);
+  *result = newest->pose;
+  if ((n < 2) || (target == newest->timestamp)) {
+    return;
+  }
+  if (target > newest->timestamp) {
+    extrapolate(poses, n, target, predictor, result);
+    return;
+  }
+  int i;
+  for (i = n - 1; i > 0; --i) {
+    if ((poses[i - 1].timestamp <= target) &&
+        (poses[i].timestamp > poses[i - 1].timestamp)) {
+      interpolate(&(poses[i - 1]), &(poses[i]), target, result);
+      return;
+    }
+  }
+  // older than anything kept
+  for (i = 0; i < FIELDS; ++i) {
+    *field(result, i) = get(&(poses[0]), i);
+  }
+}
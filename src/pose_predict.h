@@ -0,0 +1,27 @@
+#ifndef POSE_PREDICT__H
+#define POSE_PREDICT__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "linuxtrack.h"
+
+// How far past the newest pose (t2, the one before at t1) to extrapolate
+//   for the given time, in multiples of the frame interval. Linear up to
+//   three intervals, then rounding out towards five.
+float ltr_int_extrapolation_factor(int64_t t1, int64_t t2, int64_t target);
+
+// Pose at the target time (ltr_int_get_ts() scale) from n timed poses,
+//   oldest first. Times the poses span are interpolated, later ones
+//   predicted; counter, status and resolution come from the newest pose.
+void ltr_int_predict_pose(const linuxtrack_timed_pose_t poses[], int n,
+                          int64_t target, linuxtrack_predictor_t predictor,
+                          linuxtrack_pose_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#include "pose_ring.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define POSE_RING_MAGIC 0x4c545250 // "LTRP"
+
+const char *ltr_int_pose_ring_name(void) {
+  static const char ring_file[] = "/tmp/ltr_poses";
+  return ring_file;
+}
+
+pose_ring_t *ltr_int_pose_ring_open(struct mmap_s *m) {
+  if (!ltr_int_mmap_file(ltr_int_pose_ring_name(), sizeof(pose_ring_t), m)) {
+    ltr_int_log_message("Couldn't mmap the pose ring!\n");
+    return NULL;
+  }
+  // readers left over from a crashed master notice head going back
+  pose_ring_t *ring = (pose_ring_t *)m->data;
+  memset(ring, 0, sizeof(pose_ring_t));
+  ring->slots = POSE_RING_SLOTS;
+  __atomic_store_n(&(ring->magic), POSE_RING_MAGIC, __ATOMIC_RELEASE);
+  return ring;
+}
+
+pose_ring_t *ltr_int_pose_ring_map(struct mmap_s *m) {
+  int fd = open(ltr_int_pose_ring_name(), O_RDWR | O_NOFOLLOW);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || (st.st_size != (off_t)sizeof(pose_ring_t))) {
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, sizeof(pose_ring_t), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    ltr_int_my_perror("mmap: ");
+    return NULL;
+  }
+  pose_ring_t *ring = (pose_ring_t *)data;
+  if ((__atomic_load_n(&(ring->magic), __ATOMIC_ACQUIRE) != POSE_RING_MAGIC) ||
+      (ring->slots != POSE_RING_SLOTS)) {
+    munmap(data, sizeof(pose_ring_t));
+    return NULL;
+  }
+  m->data = data;
+  m->size = sizeof(pose_ring_t);
+  return ring;
+}
+
+void ltr_int_pose_ring_detach(struct mmap_s *m) {
+  if (m->data != NULL) {
+    munmap(m->data, m->size);
+    m->data = NULL;
+    m->size = 0;
+  }
+}
+
+void ltr_int_pose_ring_publish(pose_ring_t *ring,
+                               const linuxtrack_full_pose_t *pose) {
+  ltr_int_pose_ring_publish_filtered(ring, pose, 0, NULL);
+}
+
+void ltr_int_pose_ring_publish_filtered(pose_ring_t *ring,
+                                        const linuxtrack_full_pose_t *pose,
+                                        uint32_t profiles,
+                                        const linuxtrack_pose_t filtered[]) {
+  uint32_t head = __atomic_load_n(&(ring->head), __ATOMIC_RELAXED);
+  pose_ring_slot_t *slot = &(ring->slot[head % POSE_RING_SLOTS]);
+  ltr_int_seq_write_begin(&(slot->seq));
+  slot->pose = *pose;
+  slot->profiles = profiles;
+  for (int i = 0; i < POSE_RING_PROFILES; ++i) {
+    if (profiles & (1u << i)) {
+      slot->filtered[i] = filtered[i];
+    }
+  }
+  ltr_int_seq_write_end(&(slot->seq));
+  __atomic_store_n(&(ring->head), head + 1, __ATOMIC_RELEASE);
+  ltr_int_futex_wake(&(ring->head));
+}
+
+void ltr_int_pose_ring_attach(pose_ring_reader_t *reader, pose_ring_t *ring) {
+  reader->ring = ring;
+  reader->next = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+  reader->dropped = 0;
+}
+
+static void skip_to(pose_ring_reader_t *reader, uint32_t to) {
+  uint32_t lost = to - reader->next;
+  reader->dropped += lost;
+  __atomic_add_fetch(&(reader->ring->dropped), lost, __ATOMIC_RELAXED);
+  reader->next = to;
+}
+
+// One attempt at copying a slot; fails when the writer got in the way
+static bool copy_slot(const pose_ring_slot_t *slot, int profile,
+                      linuxtrack_full_pose_t *pose, bool *filtered) {
+  uint32_t start = ltr_int_seq_read_begin(&(slot->seq));
+  if (start & 1) {
+    return false;
+  }
+  memcpy(pose, &(slot->pose), sizeof(linuxtrack_full_pose_t));
+  bool have = (profile >= 0) && (profile < POSE_RING_PROFILES) &&
+              (slot->profiles & (1u << profile));
+  if (have) {
+    memcpy(&(pose->pose), &(slot->filtered[profile]),
+           sizeof(linuxtrack_pose_t));
+  }
+  if (!ltr_int_seq_read_end(&(slot->seq), start)) {
+    return false;
+  }
+  if (filtered != NULL) {
+    *filtered = have;
+  }
+  return true;
+}
+
+bool ltr_int_pose_ring_read(pose_ring_reader_t *reader,
+                            linuxtrack_full_pose_t *pose) {
+  return ltr_int_pose_ring_read_profile(reader, -1, pose, NULL);
+}
+
+bool ltr_int_pose_ring_read_profile(pose_ring_reader_t *reader, int profile,
+                                    linuxtrack_full_pose_t *pose,
+                                    bool *filtered) {
+  pose_ring_t *ring = reader->ring;
+  while (1) {
+    uint32_t head = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+    int32_t ahead = (int32_t)(head - reader->next);
+    if (ahead == 0) {
+      return false;
+    }
+    if (ahead < 0) {
+      // the ring got reset under us; start over at its head
+      reader->next = head;
+      return false;
+    }
+    if (ahead > POSE_RING_SLOTS - 1) {
+      // the oldest slots are being overwritten; keep one slot of margin
+      skip_to(reader, head - (POSE_RING_SLOTS - 1));
+    }
+    pose_ring_slot_t *slot = &(ring->slot[reader->next % POSE_RING_SLOTS]);
+    if (copy_slot(slot, profile, pose, filtered)) {
+      // the slot could have been reused while we copied it
+      uint32_t now = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+      if ((int32_t)(now - reader->next) <= POSE_RING_SLOTS - 1) {
+        ++(reader->next);
+        return true;
+      }
+    }
+  }
+}
+
+bool ltr_int_pose_ring_wait(pose_ring_reader_t *reader, int timeout) {
+  uint32_t head = __atomic_load_n(&(reader->ring->head), __ATOMIC_ACQUIRE);
+  if (head != reader->next) {
+    return true;
+  }
+  ltr_int_futex_wait(&(reader->ring->head), head, timeout);
+  return __atomic_load_n(&(reader->ring->head), __ATOMIC_ACQUIRE) !=
+         reader->next;
+}
@@ -0,0 +1,80 @@
+#ifndef POSE_RING__H
+#define POSE_RING__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ipc_utils.h"
+#include "ltlib.h"
+
+// Single writer, many readers ring of raw poses shared through a mmapped
+//   file. The master publishes every pose once; each slave follows the
+//   ring at its own pace. Slots are guarded by sequence counters, so a
+//   reader that fell behind by more than a ring's worth detects it and
+//   skips ahead instead of reading a half written pose.
+#define POSE_RING_SLOTS 64
+// Profiles the master can postprocess itself; their filtered poses travel
+//   in the same slot as the raw one.
+#define POSE_RING_PROFILES 8
+
+typedef struct {
+  uint32_t seq;
+  uint32_t profiles; // bit n set when filtered[n] belongs to this pose
+  linuxtrack_full_pose_t pose;
+  linuxtrack_pose_t filtered[POSE_RING_PROFILES];
+} pose_ring_slot_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t slots;
+  uint32_t head;    // poses published so far; readers sleep on it
+  uint32_t dropped; // poses all readers together skipped by lagging
+  pose_ring_slot_t slot[POSE_RING_SLOTS];
+} pose_ring_t;
+
+typedef struct {
+  pose_ring_t *ring;
+  uint32_t next;    // number of the next pose to read
+  uint32_t dropped; // poses this reader missed
+} pose_ring_reader_t;
+
+const char *ltr_int_pose_ring_name(void);
+
+// Master side; creates (or resets) the ring file
+pose_ring_t *ltr_int_pose_ring_open(struct mmap_s *m);
+void ltr_int_pose_ring_publish(pose_ring_t *ring,
+                               const linuxtrack_full_pose_t *pose);
+// Also publishes filtered[n] for every bit n set in profiles
+void ltr_int_pose_ring_publish_filtered(pose_ring_t *ring,
+                                        const linuxtrack_full_pose_t *pose,
+                                        uint32_t profiles,
+                                        const linuxtrack_pose_t filtered[]);
+
+// Slave side; maps the master's ring, NULL if there is no valid one.
+pose_ring_t *ltr_int_pose_ring_map(struct mmap_s *m);
+// Unmaps the ring, leaving the file to the master
+void ltr_int_pose_ring_detach(struct mmap_s *m);
+// Starts reading after the newest pose already published
+void ltr_int_pose_ring_attach(pose_ring_reader_t *reader, pose_ring_t *ring);
+// Copies the next unread pose; false when there is none.
+bool ltr_int_pose_ring_read(pose_ring_reader_t *reader,
+                            linuxtrack_full_pose_t *pose);
+// Same, but when the master filtered the pose for the profile given (-1 for
+//   none), pose->pose holds the filtered one and *filtered is set.
+bool ltr_int_pose_ring_read_profile(pose_ring_reader_t *reader, int profile,
+                                    linuxtrack_full_pose_t *pose,
+                                    bool *filtered);
+// Sleeps until a pose newer than the last read one shows up (timeout in
+//   ms); returns false on timeout. Without futexes (anything but Linux) it
+//   can only poll, so readers there should wait for CMD_POSE from the
+//   master and call it with a zero timeout.
+bool ltr_int_pose_ring_wait(pose_ring_reader_t *reader, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -84,6 +84,32 @@ void ltr_int_set_use_alter(bool state)
   ltr_int_change_key("Global", "Legacy-pose-computation", state?"yes":"no");
 }
 
+static bool_val_t use_p3p = UNSET;
+
+bool ltr_int_use_p3p()
+{
+  if(use_p3p == UNSET){
+    char *pose_method = NULL;
+    use_p3p = NO;
+    pose_method = ltr_int_get_key("Global", "Closed-form-pose-computation");
+    if(pose_method != NULL){
+      if(strcasecmp(pose_method, "yes") == 0){
+        use_p3p = YES;
+      }else{
+        use_p3p = NO;
+      }
+      free(pose_method);
+    }
+  }
+  return (use_p3p == YES);
+}
+
+void ltr_int_set_use_p3p(bool state)
+{
+  use_p3p = state ? YES: NO;
+  ltr_int_change_key("Global", "Closed-form-pose-computation", state?"yes":"no");
+}
+
 static float focal_length = -1.0f;
 
 float ltr_int_get_focal_length()
@@ -129,6 +155,54 @@ void ltr_int_set_use_oldrot(bool state)
 }
 
 
+static bool_val_t blob_tracking = UNSET;
+
+bool ltr_int_use_blob_tracking()
+{
+  if(blob_tracking == UNSET){
+    blob_tracking = YES;
+    char *tmp = ltr_int_get_key("Global", "Temporal-blob-matching");
+    if(tmp != NULL){
+      if(strcasecmp(tmp, "no") == 0){
+        blob_tracking = NO;
+      }
+      free(tmp);
+    }
+  }
+  return (blob_tracking == YES);
+}
+
+void ltr_int_set_use_blob_tracking(bool state)
+{
+  blob_tracking = state ? YES: NO;
+  ltr_int_change_key("Global", "Temporal-blob-matching", state?"yes":"no");
+}
+
+
+static bool_val_t master_pp = UNSET;
+
+bool ltr_int_use_master_postprocessing()
+{
+  if(master_pp == UNSET){
+    master_pp = NO;
+    char *tmp = ltr_int_get_key("Global", "Master-postprocessing");
+    if(tmp != NULL){
+      if(strcasecmp(tmp, "yes") == 0){
+        master_pp = YES;
+      }
+      free(tmp);
+    }
+  }
+  return (master_pp == YES);
+}
+
+void ltr_int_set_use_master_postprocessing(bool state)
+{
+  master_pp = state ? YES: NO;
+  ltr_int_change_key("Global", "Master-postprocessing", state?"yes":"no");
+}
+
+
 static bool_val_t tr_align = UNSET;
 
 bool ltr_int_do_tr_align()
@@ -216,9 +290,14 @@ bool ltr_int_get_device(struct camera_control_block *ccb)
       ccb->device.category = mac_ps3eye_ft;
       dev_ok = true;
     }
+    if(strcasecmp(dev_type, "Replay") == 0){
+      ltr_int_log_message("Device Type: Replay of recorded frames\n");
+      ccb->device.category = replay;
+      dev_ok = true;
+    }
     if(dev_ok == false){
       ltr_int_log_message("Wrong device type found: '%s'\n", dev_type);
-      ltr_int_log_message(" Valid options are: 'Tir4', 'Tir', 'Tir_openusb', 'Webcam', 'Wiimote'.\n");
+      ltr_int_log_message(" Valid options are: 'Tir4', 'Tir', 'Tir_openusb', 'Webcam', 'Wiimote', 'Replay'.\n");
     }
     free(dev_type);
   }
@@ -17,8 +17,14 @@ float ltr_int_get_focal_length();
 void ltr_int_set_focal_length(float fl);
 bool ltr_int_use_alter();
 void ltr_int_set_use_alter(bool state);
+bool ltr_int_use_p3p();
+void ltr_int_set_use_p3p(bool state);
 bool ltr_int_use_oldrot();
 void ltr_int_set_use_oldrot(bool state);
+bool ltr_int_use_blob_tracking();
+void ltr_int_set_use_blob_tracking(bool state);
+bool ltr_int_use_master_postprocessing();
+void ltr_int_set_use_master_postprocessing(bool state);
 bool ltr_int_do_tr_align();
 void ltr_int_set_tr_align(bool state);
 bool ltr_int_get_device(struct camera_control_block *ccb);
@@ -8,6 +8,7 @@
 #include <string.h>
 #include "ps3_prefs.h"
 #include "cal.h"
+#include "image_convert.h"
 #ifndef OPENCV
 #include "image_process.h"
 #else
@@ -1099,24 +1100,14 @@ scan_next:
   } while (remaining_len > 0);
 }
 
-static unsigned int threshold = 128;
+static const ltr_int_bw_kernels_t *kernels = NULL;
 
+#ifdef OPENCV
 static void get_bw_image(const unsigned char *source_buf, unsigned char *dest_buf, unsigned int bytes_used)
 {
-  unsigned int cntr, cntr1;
-  #ifdef OPENCV
-    threshold = 0;
-  #else
-    threshold = ltr_int_wc_get_threshold();
-  #endif
-  for(cntr = cntr1 = 0; cntr < bytes_used; cntr += 2, ++cntr1){
-    if(source_buf[cntr] > threshold){
-      dest_buf[cntr1] = source_buf[cntr];
-    }else{
-      dest_buf[cntr1] = 0;
-    }
-  }
+  kernels->yuyv(source_buf, dest_buf, bytes_used / 2, 0);
 }
+#endif
 
 static int w, h;
 
@@ -1165,6 +1156,8 @@ int ltr_int_tracker_init(struct camera_control_block *ccb)
   if(!ltr_int_ps3_get_resolution(&w, &h)){
     goto failed;
   }
+  kernels = ltr_int_bw_select_kernels();
+  ltr_int_log_message("Using %s frame conversion kernels.\n", kernels->name);
   ltr_int_prepare_for_processing(w, h);
 #ifdef OPENCV
   if(!ltr_int_init_face_detect()){
@@ -1235,20 +1228,24 @@ int ltr_int_tracker_get_frame(struct camera_control_block *ccb, struct frame_typ
       fclose(fr);
     }
 
-    unsigned char *dest_buf = (f->bitmap != NULL) ? f->bitmap : frame;
-    get_bw_image(source_buf, dest_buf, 2 * w * h);
-
     image_t img;
-    img.bitmap = dest_buf;
     img.w = f->width;
     img.h = f->height;
     img.ratio = 1.0f;
 
 #ifndef OPENCV
-    ltr_int_to_stripes(&img);
+    // without a bitmap to fill, frame is just a line buffer
+    img.bitmap = f->bitmap;
+    ltr_int_set_roi(ltr_int_wc_get_roi(), ltr_int_wc_get_roi_padding(),
+                    ltr_int_wc_get_roi_interval());
+    ltr_int_set_processing_threads(ltr_int_wc_get_processing_threads());
+    ltr_int_scan_frame(source_buf, 2 * w, 2, h, kernels->yuyv,
+                       ltr_int_wc_get_threshold(), frame, &img);
     ltr_int_stripes_to_blobs(MAX_BLOBS, &(f->bloblist), ltr_int_wc_get_min_blob(),
                     ltr_int_wc_get_max_blob(), &img);
 #else
+    img.bitmap = (f->bitmap != NULL) ? f->bitmap : frame;
+    get_bw_image(source_buf, img.bitmap, 2 * w * h);
     ltr_int_face_detect(&img, &(f->bloblist));
 #endif
      *frame_acquired = true;
@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#undef _GNU_SOURCE
+
+#include "replay_driver.h"
+#include "image_convert.h"
+#include "image_process.h"
+#include "pref.h"
+#include "pref_global.h"
+#include "runloop.h"
+#include "utils.h"
+#include "wc_driver_prefs.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef struct {
+  char *fname;
+  int64_t usec;
+} replay_frame;
+
+typedef struct {
+  replay_frame *frames;
+  unsigned int num_frames;
+  unsigned int next;
+  int w;
+  int h;
+  bool fast; // ignore the recorded timestamps
+  bool loop;
+  unsigned char *buf;
+  unsigned char *row_buf;
+  const ltr_int_bw_kernels_t *kernels;
+  long long start_us; // wall time of the first frame of this pass
+  long long due_us;   // offset of the next frame from start_us
+  long long pause_us;
+  unsigned long replayed;
+  long long first_us;
+} replay_info;
+
+static replay_info rp;
+
+static bool get_flag(const char *dev, const char *key, bool def) {
+  char *val = ltr_int_get_key(dev, key);
+  if (val == NULL) {
+    return def;
+  }
+  bool res = (strcasecmp(val, "Yes") == 0);
+  free(val);
+  return res;
+}
+
+static bool read_replay_prefs(const char *dir) {
+  char *dev = ltr_int_get_device_section();
+  if (dev == NULL) {
+    return false;
+  }
+  char *speed = ltr_int_get_key(dev, "Replay-speed");
+  rp.fast = (speed != NULL) && (strcasecmp(speed, "Fast") == 0);
+  free(speed);
+  rp.loop = get_flag(dev, "Replay-loop", false);
+  free(dev);
+  ltr_int_log_message("Replaying '%s' %s%s\n", dir,
+                      rp.fast ? "as fast as possible" : "in original time",
+                      rp.loop ? ", looping" : "");
+  return ltr_int_wc_init_prefs();
+}
+
+// Reads the index; frames of different size than the first one are skipped
+static bool read_index(const char *dir) {
+  char *idx_name = NULL;
+  if (asprintf(&idx_name, "%s/%s", dir, REPLAY_INDEX) < 0) {
+    return false;
+  }
+  FILE *idx = fopen(idx_name, "r");
+  if (idx == NULL) {
+    ltr_int_log_message("Can't open replay index '%s'!\n", idx_name);
+    free(idx_name);
+    return false;
+  }
+  free(idx_name);
+  char line[1024];
+  char name[512];
+  int w, h;
+  long long usec;
+  unsigned int allocated = 0;
+  rp.num_frames = 0;
+  rp.w = rp.h = 0;
+  while (fgets(line, sizeof(line), idx) != NULL) {
+    if ((line[0] == '#') ||
+        (sscanf(line, "%511s %d %d %lld", name, &w, &h, &usec) != 4)) {
+      continue;
+    }
+    if (rp.num_frames == 0) {
+      rp.w = w;
+      rp.h = h;
+    } else if ((w != rp.w) || (h != rp.h)) {
+      ltr_int_log_message("Frame '%s' is %dx%d instead of %dx%d, skipping!\n",
+                          name, w, h, rp.w, rp.h);
+      continue;
+    }
+    if (rp.num_frames == allocated) {
+      allocated = (allocated == 0) ? 256 : allocated * 2;
+      rp.frames = (replay_frame *)realloc(rp.frames,
+                                          sizeof(replay_frame) * allocated);
+      if (rp.frames == NULL) {
+        ltr_int_log_message("Can't allocate replay index!\n");
+        fclose(idx);
+        return false;
+      }
+    }
+    if (asprintf(&(rp.frames[rp.num_frames].fname), "%s/%s", dir, name) < 0) {
+      continue;
+    }
+    rp.frames[rp.num_frames].usec = usec;
+    ++rp.num_frames;
+  }
+  fclose(idx);
+  if ((rp.num_frames == 0) || (rp.w <= 0) || (rp.h <= 0)) {
+    ltr_int_log_message("No frames to replay!\n");
+    return false;
+  }
+  ltr_int_log_message("Replay of %u frames, %dx%d\n", rp.num_frames, rp.w,
+                      rp.h);
+  return true;
+}
+
+static void free_index() {
+  unsigned int i;
+  for (i = 0; i < rp.num_frames; ++i) {
+    free(rp.frames[i].fname);
+  }
+  free(rp.frames);
+  rp.frames = NULL;
+  rp.num_frames = 0;
+}
+
+int ltr_int_tracker_init(struct camera_control_block *ccb) {
+  assert(ccb != NULL);
+  assert(ccb->device.category == replay);
+  assert(ccb->device.device_id != NULL);
+  memset(&rp, 0, sizeof(rp));
+  if (!read_replay_prefs(ccb->device.device_id) ||
+      !read_index(ccb->device.device_id)) {
+    free_index();
+    return -1;
+  }
+  rp.kernels = ltr_int_bw_select_kernels();
+  rp.buf = (unsigned char *)ltr_int_my_malloc(rp.w * rp.h);
+  rp.row_buf = (unsigned char *)ltr_int_my_malloc(rp.w);
+  ccb->pixel_width = rp.w;
+  ccb->pixel_height = rp.h;
+  ltr_int_prepare_for_processing(rp.w, rp.h);
+  rp.first_us = rp.start_us = ltr_int_get_ts();
+  return 0;
+}
+
+static bool load_frame(replay_frame *fr) {
+  FILE *f = fopen(fr->fname, "rb");
+  if (f == NULL) {
+    ltr_int_log_message("Can't open frame '%s'!\n", fr->fname);
+    return false;
+  }
+  size_t size = (size_t)rp.w * rp.h;
+  size_t got = fread(rp.buf, 1, size, f);
+  fclose(f);
+  if (got != size) {
+    ltr_int_log_message("Frame '%s' is too short!\n", fr->fname);
+    memset(rp.buf + got, 0, size - got);
+  }
+  return true;
+}
+
+// Sleeps until the frame is due according to the recorded timestamps
+static void wait_for_frame() {
+  if (rp.next == 0) {
+    rp.start_us = ltr_int_get_ts();
+    rp.due_us = 0;
+    return;
+  }
+  int step = ltr_int_ts_diff(rp.frames[rp.next - 1].usec,
+                             rp.frames[rp.next].usec);
+  // recordings made with the old 32bit timestamps wrap every 1024s
+  rp.due_us += (step > 0) ? step : 0;
+  long long wait = rp.start_us + rp.due_us - ltr_int_get_ts();
+  if (wait > 0) {
+    ltr_int_usleep(wait);
+  }
+}
+
+int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
+                              struct frame_type *f, bool *frame_acquired) {
+  (void)ccb;
+  if (rp.next >= rp.num_frames) {
+    if (!rp.loop) {
+      ltr_int_log_message("Replay finished.\n");
+      ltr_int_change_state(SHUTDOWN);
+      *frame_acquired = false;
+      return 0;
+    }
+    rp.next = 0;
+  }
+  if (!rp.fast) {
+    wait_for_frame();
+  }
+  replay_frame *fr = &(rp.frames[rp.next++]);
+  if (!load_frame(fr)) {
+    return -1;
+  }
+  f->width = rp.w;
+  f->height = rp.h;
+  f->bloblist.num_blobs = MAX_BLOBS;
+  image_t img = {.bitmap = f->bitmap, .w = rp.w, .h = rp.h, .ratio = 1.0f};
+  ltr_int_set_roi(ltr_int_wc_get_roi(), ltr_int_wc_get_roi_padding(),
+                  ltr_int_wc_get_roi_interval());
+  ltr_int_set_processing_threads(ltr_int_wc_get_processing_threads());
+  // frames are luma planes, scanned in place unless a bitmap is wanted
+  ltr_int_scan_frame(rp.buf, rp.w, 1, rp.h,
+                     (img.bitmap != NULL) ? rp.kernels->luma : NULL,
+                     ltr_int_wc_get_threshold(), rp.row_buf, &img);
+  ltr_int_stripes_to_blobs(MAX_BLOBS, &(f->bloblist),
+                           ltr_int_wc_get_min_blob(), ltr_int_wc_get_max_blob(),
+                           &img);
+  if (ltr_int_wc_get_flip()) {
+    unsigned int i;
+    for (i = 0; i < f->bloblist.num_blobs; ++i) {
+      f->bloblist.blobs[i].x *= -1;
+      f->bloblist.blobs[i].y *= -1;
+    }
+  }
+  ++rp.replayed;
+  *frame_acquired = true;
+  return 0;
+}
+
+int ltr_int_tracker_pause() {
+  rp.pause_us = ltr_int_get_ts();
+  return 0;
+}
+
+int ltr_int_tracker_resume() {
+  // the pause doesn't count into the recorded timeline
+  if (rp.pause_us != 0) {
+    rp.start_us += ltr_int_get_ts() - rp.pause_us;
+    rp.pause_us = 0;
+  }
+  return 0;
+}
+
+int ltr_int_tracker_close() {
+  long long elapsed = ltr_int_get_ts() - rp.first_us;
+  if (elapsed > 0) {
+    ltr_int_log_message("Replayed %lu frames in %.3f s (%.1f fps)\n",
+                        rp.replayed, elapsed / 1e6,
+                        rp.replayed * 1e6 / elapsed);
+  }
+  ltr_int_cleanup_after_processing();
+  ltr_int_wc_close_prefs();
+  free(rp.buf);
+  free(rp.row_buf);
+  rp.buf = rp.row_buf = NULL;
+  free_index();
+  return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef REPLAY_DRIVER__H
+#define REPLAY_DRIVER__H
+
+#include "cal.h"
+
+// Recordings are directories of raw 8bit luma frames plus an index file;
+//   each index line reads "<file> <width> <height> <timestamp in us>".
+#define REPLAY_INDEX "frames.idx"
+
+int ltr_int_tracker_init(struct camera_control_block *ccb);
+int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
+                              struct frame_type *f, bool *frame_acquired);
+int ltr_int_tracker_pause();
+int ltr_int_tracker_resume();
+int ltr_int_tracker_close();
+
+#endif
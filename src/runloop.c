@@ -1,10 +1,17 @@
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <assert.h>
 #include "cal.h"
 #include "utils.h"
 #include "runloop.h"
+#include "pref.h"
 #include "pref_global.h"
+#include "frame_ring.h"
+#include "image_process.h"
 
 static pthread_cond_t state_cv = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t state_mx = PTHREAD_MUTEX_INITIALIZER;
@@ -12,6 +19,201 @@ static bool change_flag = false;
 static struct frame_type frame;
 static bool frame_acquired = false;
 
+// Pipelined mode - capture runs on the runloop thread, the callback chain on
+//   a processing thread fed through a frame ring.
+#define PIPELINE_DEPTH 4
+
+typedef struct{
+  unsigned long frames;
+  long long sum_us;
+  int max_us;
+} stage_stats;
+
+static struct{
+  bool enabled;
+  frame_ring_t *ring;
+  pthread_t thread;
+  pthread_mutex_t mx;
+  pthread_cond_t cv;
+  bool quit;
+  atomic_bool failed;
+  atomic_bool want_bitmap;
+  atomic_bool want_runs;
+  frame_callback_fun cbk;
+  struct camera_control_block *ccb;
+  size_t bitmap_size; // capture thread's idea of the frame size
+  stage_stats capture, latency, processing;
+} pipe = {
+  .enabled = false,
+  .ring = NULL,
+  .mx = PTHREAD_MUTEX_INITIALIZER,
+  .cv = PTHREAD_COND_INITIALIZER,
+  .quit = false,
+};
+
+static void stage_add(stage_stats *st, int us)
+{
+  ++st->frames;
+  st->sum_us += us;
+  if(us > st->max_us){
+    st->max_us = us;
+  }
+}
+
+static int stage_avg(stage_stats *st)
+{
+  return (st->frames > 0) ? (int)(st->sum_us / st->frames) : 0;
+}
+
+static bool pipelined_requested()
+{
+  char *dev = ltr_int_get_device_section();
+  if(dev == NULL){
+    return false;
+  }
+  char *val = ltr_int_get_key(dev, "Pipelined-processing");
+  bool res = (val != NULL) && (strcasecmp(val, "Yes") == 0);
+  free(val);
+  free(dev);
+  return res;
+}
+
+// Hands the frame to the callback chain just like the serial loop would;
+//   bitmaps are copied into whatever buffer the chain asked for last time.
+static int process_frame(struct frame_type *src)
+{
+  frame.counter = src->counter;
+  frame.usec = src->usec;
+  frame.width = src->width;
+  frame.height = src->height;
+  frame.bloblist.num_blobs = src->bloblist.num_blobs;
+  memcpy(frame.bloblist.blobs, src->bloblist.blobs,
+         sizeof(struct blob_type) * src->bloblist.num_blobs);
+  if((frame.bitmap != NULL) && (src->bitmap != NULL)){
+    memcpy(frame.bitmap, src->bitmap, src->width * src->height);
+  }
+  // the slot keeps the runs until the next frame is taken
+  frame.runs_truncated = src->runs_truncated;
+  frame.num_runs = src->num_runs;
+  frame.runs = src->runs;
+  int res = pipe.cbk(pipe.ccb, &frame);
+  atomic_store(&pipe.want_bitmap, frame.bitmap != NULL);
+  atomic_store(&pipe.want_runs, frame.want_runs);
+  return res;
+}
+
+static void *processing_thread(void *param)
+{
+  (void)param;
+  struct frame_type *f;
+  int retval;
+  while(1){
+    pthread_mutex_lock(&pipe.mx);
+    while(!pipe.quit && ((f = ltr_int_frame_ring_pop(pipe.ring)) == NULL)){
+      pthread_cond_wait(&pipe.cv, &pipe.mx);
+    }
+    pthread_mutex_unlock(&pipe.mx);
+    if(pipe.quit){
+      break;
+    }
+    int64_t start = ltr_int_get_ts();
+    stage_add(&pipe.latency, ltr_int_ts_diff(f->usec, start));
+    if((retval = process_frame(f)) < 0){
+      ltr_int_log_message("Error processing frame! (rv = %d)\n", retval);
+      atomic_store(&pipe.failed, true);
+      break;
+    }
+    stage_add(&pipe.processing, ltr_int_ts_diff(start, ltr_int_get_ts()));
+  }
+  return NULL;
+}
+
+static bool pipeline_start(struct camera_control_block *ccb, frame_callback_fun cbk)
+{
+  memset(&pipe.capture, 0, sizeof(stage_stats));
+  memset(&pipe.latency, 0, sizeof(stage_stats));
+  memset(&pipe.processing, 0, sizeof(stage_stats));
+  pipe.cbk = cbk;
+  pipe.ccb = ccb;
+  pipe.quit = false;
+  pipe.bitmap_size = 0;
+  atomic_store(&pipe.failed, false);
+  atomic_store(&pipe.want_bitmap, false);
+  atomic_store(&pipe.want_runs, false);
+  pipe.ring = ltr_int_frame_ring_create(PIPELINE_DEPTH);
+  if(pthread_create(&pipe.thread, NULL, processing_thread, NULL) != 0){
+    ltr_int_log_message("Can't start processing thread, running serially!\n");
+    ltr_int_frame_ring_free(pipe.ring);
+    pipe.ring = NULL;
+    return false;
+  }
+  ltr_int_log_message("Running pipelined, %d frames deep.\n", PIPELINE_DEPTH);
+  return true;
+}
+
+static void pipeline_stop()
+{
+  pthread_mutex_lock(&pipe.mx);
+  pipe.quit = true;
+  pthread_cond_broadcast(&pipe.cv);
+  pthread_mutex_unlock(&pipe.mx);
+  pthread_join(pipe.thread, NULL);
+  ltr_int_frame_ring_stats_t st;
+  ltr_int_frame_ring_get_stats(pipe.ring, &st);
+  ltr_int_log_message("Pipeline: %lu frames queued, %lu dropped, max depth %u\n",
+                      st.pushed, st.dropped, st.max_depth);
+  ltr_int_log_message("Pipeline: capture %d/%d us, queued %d/%d us, "
+                      "processing %d/%d us (avg/max)\n",
+                      stage_avg(&pipe.capture), pipe.capture.max_us,
+                      stage_avg(&pipe.latency), pipe.latency.max_us,
+                      stage_avg(&pipe.processing), pipe.processing.max_us);
+  ltr_int_frame_ring_free(pipe.ring);
+  pipe.ring = NULL;
+}
+
+// Captures a frame into the ring; the processing thread takes it from there
+static int pipeline_capture(struct camera_control_block *ccb, unsigned int *counter)
+{
+  if(atomic_load(&pipe.failed)){
+    return -1;
+  }
+  // the first frame with a bitmap wanted goes without, as its size is unknown
+  size_t bitmap_size = atomic_load(&pipe.want_bitmap) ? pipe.bitmap_size : 0;
+  struct frame_type *f = ltr_int_frame_ring_reserve(pipe.ring, bitmap_size);
+  f->bloblist.expected_blobs = frame.bloblist.expected_blobs;
+  f->usec = -1;
+  // the detector's runs are only touched from this thread
+  bool want_runs = atomic_load(&pipe.want_runs);
+  ltr_int_keep_stripe_runs(want_runs);
+  bool acquired = false;
+  int64_t start = ltr_int_get_ts();
+  int retval = ltr_int_tracker_get_frame(ccb, f, &acquired);
+  if(retval == -1){
+    ltr_int_log_message("Error getting frame! (rv = %d)\n", retval);
+    return -1;
+  }
+  if(acquired){
+    f->counter = ++(*counter);
+    int64_t end = ltr_int_get_ts();
+    if(f->usec < 0){
+      f->usec = end;
+    }
+    stage_add(&pipe.capture, ltr_int_ts_diff(start, end));
+    pipe.bitmap_size = f->width * f->height;
+    if(want_runs){
+      const ltr_stripe_run_t *runs;
+      bool truncated;
+      unsigned int num_runs = ltr_int_get_stripe_runs(&runs, &truncated);
+      ltr_int_frame_ring_set_runs(pipe.ring, runs, num_runs, truncated);
+    }
+    ltr_int_frame_ring_push(pipe.ring);
+    pthread_mutex_lock(&pipe.mx);
+    pthread_cond_signal(&pipe.cv);
+    pthread_mutex_unlock(&pipe.mx);
+  }
+  return 0;
+}
+
 int ltr_int_rl_run(struct camera_control_block *ccb, frame_callback_fun cbk)
 {
   assert(ccb != NULL);
@@ -37,7 +239,11 @@ int ltr_int_rl_run(struct camera_control_block *ccb, frame_callback_fun cbk)
   }
 
   frame.bitmap = NULL;
+  frame.want_runs = false;
+  frame.num_runs = 0;
+  frame.runs = NULL;
 
+  pipe.enabled = pipelined_requested() && pipeline_start(ccb, cbk);
   ltr_int_cal_set_state(RUNNING);
   while(1){
     switch(ltr_int_cal_get_state()){
@@ -54,7 +260,16 @@ int ltr_int_rl_run(struct camera_control_block *ccb, frame_callback_fun cbk)
             stop_flag = true;
             break;
           default:
+            if(pipe.enabled){
+              if(pipeline_capture(ccb, &counter) < 0){
+                ltr_int_cal_set_state(err_PROCESSING_FRAME);
+                stop_flag = true;
+              }
+              break;
+            }
             frame_acquired = false;
+            frame.usec = -1;
+            ltr_int_keep_stripe_runs(frame.want_runs);
             retval = ltr_int_tracker_get_frame(ccb, &frame, &frame_acquired);
             if(retval == -1){
               ltr_int_log_message("Error getting frame! (rv = %d)\n", retval);
@@ -63,7 +278,12 @@ int ltr_int_rl_run(struct camera_control_block *ccb, frame_callback_fun cbk)
             }else{
               if(frame_acquired){
                 frame.counter = ++counter;
-                frame.usec = ltr_int_get_ts();
+                if(frame.usec < 0){
+                  // driver doesn't know when the frame was taken
+                  frame.usec = ltr_int_get_ts();
+                }
+                frame.num_runs = ltr_int_get_stripe_runs(&frame.runs,
+                                                         &frame.runs_truncated);
                 if((retval = cbk(ccb, &frame)) < 0){
                   ltr_int_log_message("Error processing frame! (rv = %d)\n", retval);
                   ltr_int_cal_set_state(err_PROCESSING_FRAME);
@@ -104,6 +324,10 @@ int ltr_int_rl_run(struct camera_control_block *ccb, frame_callback_fun cbk)
     }
   }
 
+  if(pipe.enabled){
+    pipeline_stop();
+    pipe.enabled = false;
+  }
   ltr_int_tracker_close();
   ltr_int_frame_free(ccb, &frame);
   ltr_int_cal_set_state(STOPPED);
@@ -19,19 +19,10 @@ int ltr_int_curve2pts(const splines_def *curve, splines *pts)
   return 0;
 }
 
-float ltr_int_spline_point(const splines *splns, float x)
+//x is expected to be non-negative
+static float half_point(const spline_pts *pts, float x)
 {
-  const spline_pts *pts;
   float a, b, c;
-  float factor;
-  if(x < 0.0f){
-    pts = &(splns->left);
-    factor = -1.0f;
-    x *= -1.0f;
-  }else{
-    pts = &(splns->right);
-    factor = 1.0f;
-  }
   a = pts->x0;
   if(x < a){
     return 0.0f;
@@ -40,13 +31,87 @@ float ltr_int_spline_point(const splines *splns, float x)
   c = pts->x2;
   float tmp = c - 2 * b + a;
   if(fabs(tmp) < 1e-3){ //simple linear
-    return factor * (x - a) * ((pts->y2 - pts->y0) / (c - a));
+    return (x - a) * ((pts->y2 - pts->y0) / (c - a));
   }else{
     float t = (sqrtf(tmp * x - a * c + b * b) - b + a) / tmp;
     float b02 = (1 - t) * (1 - t);
     float b12 = 2 * t * (1 - t);
     float b22 = t * t;
-    return factor * ((b02 * pts->y0) + (b12 * pts->y1) + (b22 * pts->y2));
+    return (b02 * pts->y0) + (b12 * pts->y1) + (b22 * pts->y2);
+  }
+}
+
+float ltr_int_spline_point(const splines *splns, float x)
+{
+  if(x < 0.0f){
+    return -half_point(&(splns->left), -x);
+  }else{
+    return half_point(&(splns->right), x);
+  }
+}
+
+//Linear interpolation can't follow a vertical tangent; near such an end
+//  the first/last few cells are computed exactly.
+#define STEEP_SLOPE 8.0f
+#define EXACT_CELLS 8
+
+static void sample_half(const spline_pts *pts, spline_lut_half *half)
+{
+  int i;
+  float span = pts->x2 - pts->x0;
+  half->pts = *pts;
+  half->start = pts->x0;
+  half->exact_below = 0.0f;
+  half->exact_above = SPLINE_LUT_SIZE;
+  if(span < 1e-5){
+    //all dead zone
+    half->scale = 0.0f;
+    for(i = 0; i <= SPLINE_LUT_SIZE; ++i){
+      half->y[i] = 0.0f;
+    }
+    return;
+  }
+  half->scale = SPLINE_LUT_SIZE / span;
+  if((pts->y1 - pts->y0) > STEEP_SLOPE * (pts->x1 - pts->x0)){
+    half->exact_below = EXACT_CELLS;
+  }
+  if((pts->y2 - pts->y1) > STEEP_SLOPE * (pts->x2 - pts->x1)){
+    half->exact_above = SPLINE_LUT_SIZE - EXACT_CELLS;
+  }
+  for(i = 0; i <= SPLINE_LUT_SIZE; ++i){
+    half->y[i] = half_point(pts, pts->x0 + span * i / SPLINE_LUT_SIZE);
+  }
+}
+
+void ltr_int_spline_lut(const splines *pts, spline_lut *lut)
+{
+  sample_half(&(pts->left), &(lut->left));
+  sample_half(&(pts->right), &(lut->right));
+}
+
+static float lookup_half(const spline_lut_half *half, float x)
+{
+  float pos = (x - half->start) * half->scale;
+  if(pos <= 0.0f){
+    return 0.0f;
+  }
+  if(pos >= SPLINE_LUT_SIZE){
+    return half->y[SPLINE_LUT_SIZE];
+  }
+  if((pos < half->exact_below) || (pos > half->exact_above)){
+    return half_point(&(half->pts), x);
+  }
+  int i = (int)pos;
+  float f = pos - i;
+  return half->y[i] + f * (half->y[i + 1] - half->y[i]);
+}
+
+float ltr_int_spline_lut_point(const spline_lut *lut, float x)
+{
+  if(x < 0.0f){
+    return -lookup_half(&(lut->left), -x);
+  }else{
+    return lookup_half(&(lut->right), x);
   }
 }
 
@@ -21,12 +21,34 @@ typedef struct{
   spline_pts left, right;
 }splines;
 
+#define SPLINE_LUT_SIZE 512
+
+//One half of the curve, sampled between the dead zone and 1; where
+//  the curve gets nearly vertical the table defers to the spline itself.
+typedef struct{
+  spline_pts pts;
+  float start;
+  float scale;
+  float exact_below, exact_above;
+  float y[SPLINE_LUT_SIZE + 1];
+}spline_lut_half;
+
+typedef struct{
+  spline_lut_half left, right;
+}spline_lut;
+
 //Converts curve definition to spline points
 int ltr_int_curve2pts(const splines_def *curve, splines *pts);
 
 //Make sure x belongs to <-1; 1>!
 float ltr_int_spline_point(const splines *pts, float x);
 
+//Samples the spline into a table for ltr_int_spline_lut_point
+void ltr_int_spline_lut(const splines *pts, spline_lut *lut);
+
+//Same as ltr_int_spline_point, interpolated from the table
+float ltr_int_spline_lut_point(const spline_lut *lut, float x);
+
 #ifdef __cplusplus
 }
 #endif
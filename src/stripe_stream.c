@@ -0,0 +1,84 @@
+#include "stripe_stream.h"
+#include <string.h>
+
+size_t ltr_int_stripe_frame_size(uint32_t num_runs, uint32_t num_blobs) {
+  return sizeof(ltr_stripe_frame_t) + (size_t)num_runs * sizeof(ltr_stripe_run_t) +
+         (size_t)num_blobs * sizeof(ltr_stripe_blob_t);
+}
+
+size_t ltr_int_stripe_frame_encode(uint8_t *dest, size_t dest_size,
+                                   ltr_stripe_frame_t *hdr,
+                                   const ltr_stripe_run_t *runs,
+                                   const ltr_stripe_blob_t *blobs) {
+  size_t size = ltr_int_stripe_frame_size(hdr->num_runs, hdr->num_blobs);
+  if ((size > dest_size) || (size > UINT32_MAX)) {
+    return 0;
+  }
+  hdr->magic = STRIPE_FRAME_MAGIC;
+  hdr->size = size;
+  hdr->pad = 0;
+  hdr->reserved = 0;
+  uint8_t *ptr = dest;
+  memcpy(ptr, hdr, sizeof(ltr_stripe_frame_t));
+  ptr += sizeof(ltr_stripe_frame_t);
+  memcpy(ptr, runs, hdr->num_runs * sizeof(ltr_stripe_run_t));
+  ptr += hdr->num_runs * sizeof(ltr_stripe_run_t);
+  memcpy(ptr, blobs, hdr->num_blobs * sizeof(ltr_stripe_blob_t));
+  return size;
+}
+
+bool ltr_int_stripe_frame_header(const uint8_t *data, size_t size,
+                                 ltr_stripe_frame_t *hdr) {
+  if ((data == NULL) || (size < sizeof(ltr_stripe_frame_t))) {
+    return false;
+  }
+  memcpy(hdr, data, sizeof(ltr_stripe_frame_t));
+  return (hdr->magic == STRIPE_FRAME_MAGIC) && (hdr->size <= size) &&
+         (hdr->size == ltr_int_stripe_frame_size(hdr->num_runs, hdr->num_blobs));
+}
+
+int ltr_int_stripe_frame_decode(const uint8_t *data, size_t size, int *width,
+                                int *height, size_t img_size, uint8_t *img) {
+  ltr_stripe_frame_t hdr;
+  if (!ltr_int_stripe_frame_header(data, size, &hdr)) {
+    return -1;
+  }
+  *width = hdr.width;
+  *height = hdr.height;
+  size_t pixels = (size_t)hdr.width * hdr.height;
+  if ((img == NULL) || (img_size < pixels)) {
+    return 0;
+  }
+  memset(img, 0, pixels);
+  const uint8_t *ptr = data + sizeof(ltr_stripe_frame_t);
+  uint32_t i;
+  for (i = 0; i < hdr.num_runs; ++i) {
+    ltr_stripe_run_t run;
+    memcpy(&run, ptr + i * sizeof(ltr_stripe_run_t), sizeof(run));
+    if ((run.y >= hdr.height) || (run.x >= hdr.width)) {
+      continue;
+    }
+    size_t len = run.len;
+    if (run.x + len > hdr.width) {
+      len = hdr.width - run.x;
+    }
+    memset(img + (size_t)run.y * hdr.width + run.x, run.value, len);
+  }
+  return 1;
+}
+
+int ltr_int_stripe_frame_blobs(const uint8_t *data, size_t size,
+                               ltr_stripe_blob_t *blobs, int max_blobs) {
+  ltr_stripe_frame_t hdr;
+  if (!ltr_int_stripe_frame_header(data, size, &hdr)) {
+    return -1;
+  }
+  int n = (hdr.num_blobs < max_blobs) ? hdr.num_blobs : max_blobs;
+  if ((n > 0) && (blobs != NULL)) {
+    memcpy(blobs,
+           data + sizeof(ltr_stripe_frame_t) +
+               hdr.num_runs * sizeof(ltr_stripe_run_t),
+           n * sizeof(ltr_stripe_blob_t));
+  }
+  return hdr.num_blobs;
+}
@@ -0,0 +1,70 @@
+#ifndef STRIPE_STREAM__H
+#define STRIPE_STREAM__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Frames described by the runs of lit pixels the blob detector found and
+//   the blobs it made of them, instead of the pixels themselves. A record is
+//   the header, then num_runs runs and num_blobs blobs; records follow each
+//   other in recordings. Fixed size fields only, so 32 and 64bit processes
+//   agree on the layout.
+#define STRIPE_FRAME_MAGIC 0x5346544c // "LTFS"
+#define STRIPE_FRAME_TRUNCATED 1      // runs didn't fit, some are missing
+
+typedef struct {
+  uint16_t y;
+  uint16_t x;
+  uint16_t len;
+  uint8_t value; // mean intensity
+  uint8_t pad;
+} ltr_stripe_run_t;
+
+typedef struct {
+  float x, y; // centroid in image pixels, from the top left corner
+  float score;
+} ltr_stripe_blob_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t size; // of the whole record
+  uint32_t counter;
+  uint32_t pad;
+  int64_t timestamp; // capture time, ltr_int_get_ts() scale
+  uint16_t width;
+  uint16_t height;
+  uint16_t flags;
+  uint16_t num_blobs;
+  uint32_t num_runs;
+  uint32_t reserved;
+} ltr_stripe_frame_t;
+
+size_t ltr_int_stripe_frame_size(uint32_t num_runs, uint32_t num_blobs);
+// Writes a record made of hdr (magic and size filled in here) and the runs
+//   and blobs it counts; returns its size, 0 if dest is too small.
+size_t ltr_int_stripe_frame_encode(uint8_t *dest, size_t dest_size,
+                                   ltr_stripe_frame_t *hdr,
+                                   const ltr_stripe_run_t *runs,
+                                   const ltr_stripe_blob_t *blobs);
+// Checks the record at the start of data and reads its header
+bool ltr_int_stripe_frame_header(const uint8_t *data, size_t size,
+                                 ltr_stripe_frame_t *hdr);
+// Draws the record into img (width * height bytes); returns 1 on success,
+//   0 if img is too small (width and height are set anyway) and -1 when the
+//   record is malformed.
+int ltr_int_stripe_frame_decode(const uint8_t *data, size_t size, int *width,
+                                int *height, size_t img_size, uint8_t *img);
+// Copies up to max_blobs blobs, returns how many there are or -1
+int ltr_int_stripe_frame_blobs(const uint8_t *data, size_t size,
+                               ltr_stripe_blob_t *blobs, int max_blobs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+// Blob detection benchmark on synthetic LED frames
+//   Prints one JSON object per line so the results can be diffed and
+//   checked by scripts; run via "make -f Makefile.tests bench".
+
+#include "../image_convert.h"
+#include "../image_process.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __GLIBC__
+// Count every allocation the code under test makes
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+static unsigned long allocations = 0;
+extern "C" void *malloc(size_t size) {
+  ++allocations;
+  return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t n, size_t size) {
+  ++allocations;
+  return __libc_calloc(n, size);
+}
+extern "C" void *realloc(void *ptr, size_t size) {
+  ++allocations;
+  return __libc_realloc(ptr, size);
+}
+static const bool counting_allocations = true;
+#else
+static unsigned long allocations = 0;
+static const bool counting_allocations = false;
+#endif
+
+static const unsigned int THRESHOLD = 100;
+static const int BLOB_ROOM = 64;
+
+struct Scene {
+  const char *name;
+  int noise;       // +- amplitude of the sensor noise
+  int hot_pixels;  // per 100k pixels; too small to pass the size limits
+  float blur;      // LED travel during exposure, in LED radii
+  int clutter;     // specular streaks, too big to pass the size limits
+};
+
+static const Scene scenes[] = {
+    {"clean", 0, 0, 0.0f, 0},
+    {"noise", 12, 40, 0.0f, 0},
+    {"blur", 4, 0, 3.0f, 0},
+    {"clutter", 8, 20, 1.0f, 4},
+};
+
+struct Led {
+  float x, y;
+};
+
+struct Frame {
+  int w, h;
+  std::vector<unsigned char> luma;
+  std::vector<Led> leds;
+  int max_pts;
+};
+
+static unsigned int rng_state = 1;
+static unsigned int rnd() {
+  rng_state = rng_state * 1103515245u + 12345u;
+  return (rng_state >> 8) & 0xFFFFFF;
+}
+static float rndf() { return rnd() / (float)0x1000000; }
+
+static void addLed(Frame &fr, const Led &c, float radius, float blur_len,
+                   float angle) {
+  const int steps = (blur_len > 0.0f) ? 9 : 1;
+  const float sigma = radius / 1.5f;
+  const int reach = (int)(radius * 2 + blur_len * radius / 2) + 2;
+  for (int y = (int)c.y - reach; y <= (int)c.y + reach; ++y) {
+    for (int x = (int)c.x - reach; x <= (int)c.x + reach; ++x) {
+      if ((x < 0) || (y < 0) || (x >= fr.w) || (y >= fr.h)) {
+        continue;
+      }
+      // exposure averaged along a path centred on the LED position
+      float v = 0.0f;
+      for (int s = 0; s < steps; ++s) {
+        float t = (steps > 1) ? (s / (float)(steps - 1) - 0.5f) : 0.0f;
+        float cx = c.x + t * blur_len * radius * std::cos(angle);
+        float cy = c.y + t * blur_len * radius * std::sin(angle);
+        float d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+        v += 400.0f * std::exp(-d2 / (2 * sigma * sigma));
+      }
+      v /= steps;
+      int p = fr.luma[y * fr.w + x] + (int)v;
+      fr.luma[y * fr.w + x] = (p > 255) ? 255 : p;
+    }
+  }
+}
+
+static Frame makeFrame(int w, int h, int leds, const Scene &sc,
+                       unsigned int seed) {
+  Frame fr;
+  fr.w = w;
+  fr.h = h;
+  fr.luma.assign(w * h, 0);
+  rng_state = seed;
+  for (int i = 0; i < w * h; ++i) {
+    int v = 20 + ((sc.noise > 0) ? (int)(rnd() % (2 * sc.noise + 1)) - sc.noise
+                                 : 0);
+    fr.luma[i] = v;
+  }
+  for (int i = 0; i < sc.hot_pixels * w * h / 100000; ++i) {
+    fr.luma[rnd() % (w * h)] = 255;
+  }
+  const float radius = w / 320.0f + 1.0f;
+  for (int i = 0; i < sc.clutter; ++i) {
+    int len = w / 8 + rnd() % (w / 8), thick = w / 160 + 3;
+    int x0 = rnd() % (w - w / 4 - thick), y0 = rnd() % (h - thick);
+    for (int y = y0; y < y0 + thick; ++y) {
+      for (int x = x0 + (y - y0); x < x0 + len; ++x) {
+        fr.luma[y * w + x] = 230;
+      }
+    }
+  }
+  int border = (int)(radius * 6) + 4;
+  while ((int)fr.leds.size() < leds) {
+    Led c = {border + rndf() * (w - 2 * border),
+             border + rndf() * (h - 2 * border)};
+    bool apart = true;
+    for (const Led &o : fr.leds) {
+      apart = apart && (std::hypot(o.x - c.x, o.y - c.y) > radius * 10);
+    }
+    if (apart) {
+      fr.leds.push_back(c);
+    }
+  }
+  // clutter may have been drawn where an LED ended up; redraw the LEDs
+  //   on clean background so the reference centres stay exact
+  int reach = (int)(radius * 2 + sc.blur * radius / 2) + 2;
+  for (const Led &c : fr.leds) {
+    for (int y = (int)c.y - reach; y <= (int)c.y + reach; ++y) {
+      for (int x = (int)c.x - reach; x <= (int)c.x + reach; ++x) {
+        fr.luma[y * w + x] = 20;
+      }
+    }
+    addLed(fr, c, radius, sc.blur, rndf() * 6.2832f);
+  }
+  fr.max_pts = (int)(radius * radius * 12 * (1 + sc.blur));
+  return fr;
+}
+
+struct Accuracy {
+  double err_sum = 0.0;
+  double err_max = 0.0;
+  unsigned long matched = 0;
+  unsigned long missed = 0;
+  unsigned long spurious = 0;
+};
+
+static void score(const Frame &fr, const struct blob_type *blobs, int found,
+                  Accuracy &acc) {
+  std::vector<bool> used(found, false);
+  for (const Led &c : fr.leds) {
+    int best = -1;
+    double best_d = 1e9;
+    for (int i = 0; i < found; ++i) {
+      double x = (fr.w - 1) / 2.0 - blobs[i].x;
+      double y = (fr.h - 1) / 2.0 - blobs[i].y;
+      double d = std::hypot(x - c.x, y - c.y);
+      if (!used[i] && (d < best_d)) {
+        best = i;
+        best_d = d;
+      }
+    }
+    if ((best < 0) || (best_d > 3.0)) {
+      ++acc.missed;
+      continue;
+    }
+    used[best] = true;
+    ++acc.matched;
+    acc.err_sum += best_d;
+    acc.err_max = (best_d > acc.err_max) ? best_d : acc.err_max;
+  }
+  for (bool u : used) {
+    acc.spurious += u ? 0 : 1;
+  }
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double nsSince(bench_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(bench_clock::now() - start)
+      .count();
+}
+
+static void benchDetection(int w, int h, int leds, const Scene &sc,
+                           int frames) {
+  const int variants = 8;
+  std::vector<Frame> set;
+  std::vector<std::vector<unsigned char>> bw;
+  for (int i = 0; i < variants; ++i) {
+    set.push_back(makeFrame(w, h, leds, sc, 1000 + i));
+    std::vector<unsigned char> b(w * h);
+    ltr_int_bw_kernel(0)->luma(set.back().luma.data(), b.data(), w * h,
+                               THRESHOLD);
+    bw.push_back(b);
+  }
+  std::vector<unsigned char> bitmap(w * h);
+  struct blob_type blobs[BLOB_ROOM];
+  Accuracy acc;
+  double ns = 0.0;
+  unsigned long allocs = 0;
+
+  ltr_int_prepare_for_processing(w, h);
+  for (int i = 0; i < frames; ++i) {
+    const Frame &fr = set[i % variants];
+    bitmap = bw[i % variants];
+    struct bloblist_type bl;
+    bl.blobs = blobs;
+    bl.num_blobs = BLOB_ROOM;
+    bl.expected_blobs = leds;
+    image_t img = {w, h, bitmap.data(), 1.0f};
+    unsigned long a = allocations;
+    auto start = bench_clock::now();
+    ltr_int_to_stripes(&img);
+    ltr_int_stripes_to_blobs(BLOB_ROOM, &bl, 4, fr.max_pts, &img);
+    ns += nsSince(start);
+    allocs += allocations - a;
+    score(fr, blobs, bl.num_blobs, acc);
+  }
+  ltr_int_cleanup_after_processing();
+
+  printf("{\"bench\": \"detect\", \"width\": %d, \"height\": %d, "
+         "\"leds\": %d, \"scene\": \"%s\", \"frames\": %d, "
+         "\"ns_per_frame\": %.0f, \"allocs_per_frame\": %.3f, "
+         "\"centroid_err_mean\": %.4f, \"centroid_err_max\": %.4f, "
+         "\"missed\": %lu, \"spurious\": %lu}\n",
+         w, h, leds, sc.name, frames, ns / frames,
+         counting_allocations ? (double)allocs / frames : -1.0,
+         acc.matched ? acc.err_sum / acc.matched : 0.0, acc.err_max,
+         acc.missed, acc.spurious);
+}
+
+static void benchConversion(int w, int h, int frames) {
+  Frame fr = makeFrame(w, h, 3, scenes[1], 7);
+  size_t pixels = (size_t)w * h;
+  std::vector<unsigned char> yuyv(pixels * 2), rgb(pixels * 3), out(pixels);
+  for (size_t i = 0; i < pixels; ++i) {
+    yuyv[2 * i] = fr.luma[i];
+    yuyv[2 * i + 1] = 128;
+    rgb[3 * i] = rgb[3 * i + 1] = rgb[3 * i + 2] = fr.luma[i];
+  }
+  struct Format {
+    const char *name;
+    const unsigned char *src;
+  } formats[] = {{"yuyv", yuyv.data()},
+                 {"luma", fr.luma.data()},
+                 {"rgb", rgb.data()},
+                 {"bgr", rgb.data()}};
+  for (unsigned int k = 0; k < ltr_int_bw_kernel_count(); ++k) {
+    const ltr_int_bw_kernels_t *ks = ltr_int_bw_kernel(k);
+    if (ks == nullptr) {
+      continue;
+    }
+    ltr_int_bw_kernel_t kernels[] = {ks->yuyv, ks->luma, ks->rgb, ks->bgr};
+    for (int f = 0; f < 4; ++f) {
+      unsigned long a = allocations;
+      auto start = bench_clock::now();
+      for (int i = 0; i < frames; ++i) {
+        kernels[f](formats[f].src, out.data(), pixels, THRESHOLD);
+      }
+      double ns = nsSince(start);
+      printf("{\"bench\": \"convert\", \"width\": %d, \"height\": %d, "
+             "\"kernels\": \"%s\", \"format\": \"%s\", \"frames\": %d, "
+             "\"ns_per_frame\": %.0f, \"allocs_per_frame\": %.3f}\n",
+             w, h, ks->name, formats[f].name, frames, ns / frames,
+             counting_allocations ? (double)(allocations - a) / frames : -1.0);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int frames = 200;
+  if ((argc > 2) && (strcmp(argv[1], "--frames") == 0)) {
+    frames = atoi(argv[2]);
+  }
+  if (frames < 1) {
+    fprintf(stderr, "Usage: %s [--frames N]\n", argv[0]);
+    return 1;
+  }
+  const int resolutions[][2] = {{320, 240}, {640, 480}, {1280, 720}};
+  for (const auto &res : resolutions) {
+    benchConversion(res[0], res[1], frames);
+    for (int leds : {1, 3, 10}) {
+      for (const Scene &sc : scenes) {
+        benchDetection(res[0], res[1], leds, sc, frames);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+// Unit tests for the frame to frame LED correspondence tracker
+// Uses Catch2 v3 testing framework
+
+#include "../blob_track.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <cmath>
+#include <vector>
+
+// Cap-like triangle rotated by roll around (cx, cy)
+static void leds(float roll_deg, float cx, float cy, struct blob_type out[3]) {
+  const float model[3][2] = {{0, 40}, {-50, -20}, {50, -20}};
+  float r = roll_deg * (float)M_PI / 180.0f;
+  for (int i = 0; i < 3; ++i) {
+    out[i].x = cx + model[i][0] * cosf(r) - model[i][1] * sinf(r);
+    out[i].y = cy + model[i][0] * sinf(r) + model[i][1] * cosf(r);
+    out[i].score = 20;
+  }
+}
+
+static bool near(const struct blob_type &a, const struct blob_type &b,
+                 float tol) {
+  return std::hypot(a.x - b.x, a.y - b.y) < tol;
+}
+
+TEST_CASE("Blob tracker keeps LED identity through a full roll",
+          "[blob_track]") {
+  blob_tracker_t t;
+  ltr_int_blob_track_reset(&t);
+  struct blob_type truth[3], blobs[MAX_BLOBS];
+  leds(0, 0, 0, truth);
+  ltr_int_blob_track_lock(&t, truth);
+  for (int step = 1; step <= 72; ++step) {
+    leds(step * 5.0f, step * 2.0f, 0, truth);
+    // detector order is arbitrary; feed them rotated
+    for (int i = 0; i < 3; ++i) {
+      blobs[i] = truth[(i + step) % 3];
+    }
+    struct bloblist_type bl = {3, 3, blobs};
+    REQUIRE(ltr_int_blob_track_match(&t, &bl));
+    REQUIRE(bl.num_blobs == 3);
+    for (int i = 0; i < 3; ++i) {
+      CHECK(near(blobs[i], truth[i], 0.01f));
+    }
+  }
+}
+
+TEST_CASE("Blob tracker coasts a briefly occluded LED", "[blob_track]") {
+  blob_tracker_t t;
+  ltr_int_blob_track_reset(&t);
+  struct blob_type truth[3], blobs[MAX_BLOBS];
+  leds(0, 0, 0, truth);
+  ltr_int_blob_track_lock(&t, truth);
+  int step;
+  for (step = 1; step <= 3; ++step) {
+    leds(0, step * 4.0f, step * -3.0f, truth);
+    blobs[0] = truth[2];
+    blobs[1] = truth[0];
+    blobs[2] = truth[1];
+    struct bloblist_type bl = {3, 3, blobs};
+    REQUIRE(ltr_int_blob_track_match(&t, &bl));
+  }
+  // LED 1 vanishes while the head keeps moving
+  for (; step <= 3 + BLOB_TRACK_COAST; ++step) {
+    leds(0, step * 4.0f, step * -3.0f, truth);
+    blobs[0] = truth[2];
+    blobs[1] = truth[0];
+    struct bloblist_type bl = {2, 3, blobs};
+    REQUIRE(ltr_int_blob_track_match(&t, &bl));
+    REQUIRE(bl.num_blobs == 3);
+    CHECK(near(blobs[0], truth[0], 0.01f));
+    CHECK(near(blobs[1], truth[1], 1.0f));
+    CHECK(near(blobs[2], truth[2], 0.01f));
+  }
+  // and comes back where expected
+  leds(0, step * 4.0f, step * -3.0f, truth);
+  blobs[0] = truth[1];
+  blobs[1] = truth[2];
+  blobs[2] = truth[0];
+  struct bloblist_type bl = {3, 3, blobs};
+  REQUIRE(ltr_int_blob_track_match(&t, &bl));
+  for (int i = 0; i < 3; ++i) {
+    CHECK(near(blobs[i], truth[i], 0.01f));
+  }
+}
+
+TEST_CASE("Blob tracker gives up on long occlusions and stray blobs",
+          "[blob_track]") {
+  blob_tracker_t t;
+  ltr_int_blob_track_reset(&t);
+  struct blob_type truth[3], blobs[MAX_BLOBS];
+  struct bloblist_type bl = {3, 3, blobs};
+  CHECK_FALSE(ltr_int_blob_track_match(&t, &bl));
+
+  leds(0, 0, 0, truth);
+  ltr_int_blob_track_lock(&t, truth);
+  // a reflection far away doesn't steal an LED
+  blobs[0] = {200.0f, 200.0f, 50};
+  for (int i = 0; i < 3; ++i) {
+    blobs[i + 1] = truth[i];
+  }
+  bl.num_blobs = 4;
+  REQUIRE(ltr_int_blob_track_match(&t, &bl));
+  for (int i = 0; i < 3; ++i) {
+    CHECK(near(blobs[i], truth[i], 0.01f));
+  }
+
+  // with a single LED visible nothing can be trusted
+  int frames = 0;
+  do {
+    blobs[0] = truth[0];
+    bl.num_blobs = 1;
+    ++frames;
+  } while (!ltr_int_blob_track_match(&t, &bl) && t.locked && frames < 100);
+  CHECK_FALSE(t.locked);
+  CHECK(frames == BLOB_TRACK_COAST + 1);
+}
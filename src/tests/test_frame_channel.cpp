@@ -0,0 +1,190 @@
+// Unit tests for the frame channel between the master and frame viewers
+// Uses Catch2 v3 testing framework
+
+#include "../frame_channel.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static std::string channel_file() {
+  return "/tmp/ltr_test_frames_" + std::to_string(getpid());
+}
+
+// Frames are filled with a single value, so torn copies show
+static bool put_frame(frame_writer_t *w, uint32_t width, uint32_t height,
+                      uint8_t v) {
+  uint8_t *buf = ltr_int_frame_writer_begin(w, width, height);
+  if (buf == nullptr) {
+    return false;
+  }
+  memset(buf, v, width * height);
+  ltr_int_frame_writer_publish(w, v);
+  return true;
+}
+
+static bool uniform(const std::vector<uint8_t> &buf, size_t size) {
+  for (size_t i = 1; i < size; ++i) {
+    if (buf[i] != buf[0]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST_CASE("Frame channel hands viewers the newest frame", "[frame_channel]") {
+  std::string fname = channel_file();
+  frame_writer_t w;
+  ltr_int_frame_writer_init(&w, fname.c_str());
+  frame_reader_t r = {strdup(fname.c_str()), 0, nullptr};
+  std::vector<uint8_t> buf(64 * 48);
+  int width = 0, height = 0;
+
+  // nothing there until the master publishes
+  CHECK(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                 buf.data()) == -1);
+  CHECK_FALSE(ltr_int_frame_writer_wanted(&w));
+  ltr_int_frame_writer_demand(&w);
+  CHECK(ltr_int_frame_writer_wanted(&w));
+
+  for (uint8_t v = 1; v <= 5; ++v) {
+    REQUIRE(put_frame(&w, 64, 48, v));
+  }
+  REQUIRE(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                   buf.data()) == 1);
+  CHECK(width == 64);
+  CHECK(height == 48);
+  CHECK(buf[0] == 5);
+  CHECK(uniform(buf, buf.size()));
+
+  // a frame in the making doesn't replace the published one
+  uint8_t *next = ltr_int_frame_writer_begin(&w, 64, 48);
+  REQUIRE(next != nullptr);
+  memset(next, 9, 64 * 48);
+  REQUIRE(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                   buf.data()) == 1);
+  CHECK(buf[0] == 5);
+  ltr_int_frame_writer_abort(&w);
+
+  // too small a buffer gets the size only
+  width = height = 0;
+  CHECK(ltr_int_frame_reader_get(&r, &width, &height, 100, buf.data()) == 0);
+  CHECK(width == 64);
+
+  ltr_int_frame_writer_close(&w);
+  CHECK(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                 buf.data()) == -1);
+  ltr_int_frame_reader_close(&r);
+}
+
+TEST_CASE("Frame channel goes idle without viewers and resumes",
+          "[frame_channel]") {
+  std::string fname = channel_file();
+  frame_writer_t w;
+  ltr_int_frame_writer_init(&w, fname.c_str());
+  frame_reader_t r = {strdup(fname.c_str()), 0, nullptr};
+  std::vector<uint8_t> buf(32 * 32);
+  int width, height;
+
+  ltr_int_frame_writer_demand(&w);
+  REQUIRE(put_frame(&w, 32, 32, 1));
+  REQUIRE(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                   buf.data()) == 1);
+
+  // pretend nobody asked nor looked for a while
+  uint32_t past = ltr_int_frame_channel_clock() - 2 * FRAME_CHANNEL_IDLE;
+  w.demand = past;
+  r.ch->heartbeat = past;
+  CHECK_FALSE(ltr_int_frame_writer_wanted(&w));
+  // the viewer is told, and its look brings the frames back
+  CHECK(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                 buf.data()) == -1);
+  CHECK(ltr_int_frame_writer_wanted(&w));
+  // no stale frame in between
+  REQUIRE(ltr_int_frame_writer_begin(&w, 32, 32) != nullptr);
+  CHECK(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                 buf.data()) == 0);
+  ltr_int_frame_writer_publish(&w, 2);
+  CHECK(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                 buf.data()) == 1);
+
+  ltr_int_frame_writer_close(&w);
+  ltr_int_frame_reader_close(&r);
+}
+
+TEST_CASE("Frame channel readers never see torn or resized frames",
+          "[frame_channel]") {
+  std::string fname = channel_file();
+  frame_writer_t w;
+  ltr_int_frame_writer_init(&w, fname.c_str());
+  frame_reader_t r = {strdup(fname.c_str()), 0, nullptr};
+  ltr_int_frame_writer_demand(&w);
+  REQUIRE(put_frame(&w, 160, 120, 0));
+
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    for (int i = 1; i <= 3000; ++i) {
+      // grows the file once half way through
+      uint32_t width = (i < 1500) ? 160 : 320;
+      uint32_t height = (i < 1500) ? 120 : 240;
+      put_frame(&w, width, height, (uint8_t)i);
+      // a fast camera still leaves the viewers some time
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    done = true;
+  });
+  std::vector<uint8_t> buf(320 * 240);
+  int width, height, got = 0;
+  bool intact = true;
+  while (!done) {
+    if (ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                 buf.data()) == 1) {
+      ++got;
+      intact = intact && uniform(buf, width * height);
+    }
+  }
+  writer.join();
+  CHECK(intact);
+  CHECK(got > 0);
+  REQUIRE(ltr_int_frame_reader_get(&r, &width, &height, buf.size(),
+                                   buf.data()) == 1);
+  CHECK(width == 320);
+  CHECK(buf[0] == (uint8_t)3000);
+
+  ltr_int_frame_writer_close(&w);
+  ltr_int_frame_reader_close(&r);
+}
+
+TEST_CASE("Frame channel carries data of any size", "[frame_channel]") {
+  std::string fname = channel_file();
+  frame_writer_t w;
+  ltr_int_frame_writer_init(&w, fname.c_str());
+  frame_reader_t r = {strdup(fname.c_str()), 0, nullptr};
+  frame_channel_buf_t info;
+  std::vector<uint8_t> buf(100);
+
+  // an open channel lets the viewer alone start the data flowing
+  REQUIRE(ltr_int_frame_writer_open(&w, 64));
+  CHECK_FALSE(ltr_int_frame_writer_wanted(&w));
+  CHECK(ltr_int_frame_reader_read(&r, &info, buf.size(), buf.data()) == -1);
+  CHECK(ltr_int_frame_writer_wanted(&w));
+
+  uint8_t *data = ltr_int_frame_writer_begin_data(&w, 640, 480, 37);
+  REQUIRE(data != nullptr);
+  memset(data, 7, 37);
+  ltr_int_frame_writer_publish(&w, 11);
+  REQUIRE(ltr_int_frame_reader_read(&r, &info, buf.size(), buf.data()) == 1);
+  CHECK(info.size == 37);
+  CHECK(info.width == 640);
+  CHECK(info.counter == 11);
+  CHECK(buf[36] == 7);
+  // too small a buffer still learns the size
+  CHECK(ltr_int_frame_reader_read(&r, &info, 10, buf.data()) == 0);
+  CHECK(info.size == 37);
+
+  ltr_int_frame_writer_close(&w);
+  ltr_int_frame_reader_close(&r);
+}
@@ -0,0 +1,123 @@
+// Unit tests for the capture to processing frame ring
+// Uses Catch2 v3 testing framework
+
+#include "../frame_ring.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static void pushFrame(frame_ring_t *ring, unsigned int counter) {
+  struct frame_type *f = ltr_int_frame_ring_reserve(ring, 16);
+  REQUIRE(f->bitmap != nullptr);
+  f->counter = counter;
+  f->bitmap[0] = counter & 0xFF;
+  ltr_int_frame_ring_push(ring);
+}
+
+TEST_CASE("Frame ring keeps order and drops the oldest", "[frame_ring]") {
+  frame_ring_t *ring = ltr_int_frame_ring_create(3);
+  ltr_int_frame_ring_stats_t stats;
+  REQUIRE(ltr_int_frame_ring_pop(ring) == nullptr);
+
+  pushFrame(ring, 1);
+  pushFrame(ring, 2);
+  struct frame_type *f = ltr_int_frame_ring_pop(ring);
+  REQUIRE(f != nullptr);
+  CHECK(f->counter == 1);
+  CHECK(f->bitmap[0] == 1);
+
+  // 2 is still queued; 3, 4 and 5 push it out
+  for (unsigned int i = 3; i <= 5; ++i) {
+    pushFrame(ring, i);
+  }
+  for (unsigned int i = 3; i <= 5; ++i) {
+    f = ltr_int_frame_ring_pop(ring);
+    REQUIRE(f != nullptr);
+    CHECK(f->counter == i);
+    CHECK(f->bitmap[0] == i);
+  }
+  CHECK(ltr_int_frame_ring_pop(ring) == nullptr);
+
+  ltr_int_frame_ring_get_stats(ring, &stats);
+  CHECK(stats.pushed == 5);
+  CHECK(stats.dropped == 1);
+  CHECK(stats.depth == 0);
+  CHECK(stats.max_depth == 3);
+
+  CHECK(ltr_int_frame_ring_reserve(ring, 0)->bitmap == nullptr);
+  ltr_int_frame_ring_free(ring);
+}
+
+TEST_CASE("Frame ring slots carry their own runs", "[frame_ring]") {
+  frame_ring_t *ring = ltr_int_frame_ring_create(2);
+  std::vector<ltr_stripe_run_t> runs = {{1, 2, 3, 100, 0}, {4, 5, 6, 200, 0}};
+  struct frame_type *f = ltr_int_frame_ring_reserve(ring, 0);
+  ltr_int_frame_ring_set_runs(ring, runs.data(), runs.size(), true);
+  f->counter = 1;
+  ltr_int_frame_ring_push(ring);
+  // the detector reuses its runs for the next frame
+  runs[0].x = 99;
+  f = ltr_int_frame_ring_reserve(ring, 0);
+  CHECK(f->num_runs == 0);
+  CHECK(f->runs == nullptr);
+  f->counter = 2;
+  ltr_int_frame_ring_push(ring);
+
+  f = ltr_int_frame_ring_pop(ring);
+  REQUIRE(f != nullptr);
+  REQUIRE(f->num_runs == 2);
+  CHECK(f->runs_truncated);
+  CHECK(f->runs[0].x == 2);
+  CHECK(f->runs[1].value == 200);
+  f = ltr_int_frame_ring_pop(ring);
+  REQUIRE(f != nullptr);
+  CHECK(f->counter == 2);
+  CHECK(f->num_runs == 0);
+  ltr_int_frame_ring_free(ring);
+}
+
+TEST_CASE("Frame ring survives a racing consumer", "[frame_ring]") {
+  const unsigned int frames = 200000;
+  frame_ring_t *ring = ltr_int_frame_ring_create(2);
+  std::atomic<bool> done(false);
+  unsigned int received = 0;
+  unsigned int last = 0;
+  bool ordered = true;
+  bool intact = true;
+
+  std::thread consumer([&]() {
+    while (true) {
+      bool finished = done.load();
+      struct frame_type *f;
+      while ((f = ltr_int_frame_ring_pop(ring)) != nullptr) {
+        ordered = ordered && (f->counter > last);
+        intact = intact && (f->bitmap[0] == (f->counter & 0xFF)) &&
+                 (f->bloblist.num_blobs == f->counter % MAX_BLOBS);
+        last = f->counter;
+        ++received;
+      }
+      if (finished) {
+        break;
+      }
+    }
+  });
+  for (unsigned int i = 1; i <= frames; ++i) {
+    struct frame_type *f = ltr_int_frame_ring_reserve(ring, 16);
+    f->counter = i;
+    f->bloblist.num_blobs = i % MAX_BLOBS;
+    f->bitmap[0] = i & 0xFF;
+    ltr_int_frame_ring_push(ring);
+  }
+  done.store(true);
+  consumer.join();
+
+  ltr_int_frame_ring_stats_t stats;
+  ltr_int_frame_ring_get_stats(ring, &stats);
+  CHECK(ordered);
+  CHECK(intact);
+  CHECK(last == frames);
+  CHECK(stats.pushed == frames);
+  CHECK(received + stats.dropped == frames);
+  ltr_int_frame_ring_free(ring);
+}
@@ -0,0 +1,93 @@
+// Unit tests for the threshold/luma conversion kernels
+// Uses Catch2 v3 testing framework
+
+#include "../image_convert.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Odd pixel count so every kernel has to run its scalar tail too
+static const size_t PIXELS = 640 * 3 + 13;
+
+static std::vector<unsigned char> randomBuffer(size_t size, unsigned seed) {
+  std::vector<unsigned char> buf(size);
+  srand(seed);
+  for (size_t i = 0; i < size; ++i) {
+    buf[i] = rand() & 0xFF;
+  }
+  return buf;
+}
+
+static void checkKernel(ltr_int_bw_kernel_t ref, ltr_int_bw_kernel_t tested,
+                        size_t bytes_per_pixel) {
+  std::vector<unsigned char> src =
+      randomBuffer(PIXELS * bytes_per_pixel, 1234);
+  const unsigned int thresholds[] = {0, 1, 64, 127, 128, 200, 254, 255, 300};
+  for (unsigned int thr : thresholds) {
+    // Also check unaligned starts and short runs
+    for (size_t offset = 0; offset < 3; ++offset) {
+      for (size_t pixels : {PIXELS - offset, (size_t)31, (size_t)0}) {
+        std::vector<unsigned char> expected(PIXELS + 1, 0xAA);
+        std::vector<unsigned char> got(PIXELS + 1, 0xAA);
+        const unsigned char *s = src.data() + offset * bytes_per_pixel;
+        ref(s, expected.data() + offset, pixels, thr);
+        tested(s, got.data() + offset, pixels, thr);
+        INFO("threshold " << thr << ", offset " << offset << ", pixels "
+                          << pixels);
+        REQUIRE(got == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE("Scalar kernels follow the documented formula", "[image_convert]") {
+  const ltr_int_bw_kernels_t *ref = ltr_int_bw_kernel(0);
+  REQUIRE(ref != nullptr);
+  REQUIRE(std::string(ref->name) == "scalar");
+
+  const unsigned char yuyv[] = {10, 1, 200, 2, 129, 3, 128, 4};
+  unsigned char out[4];
+  ref->yuyv(yuyv, out, 4, 128);
+  CHECK(out[0] == 0);
+  CHECK(out[1] == 200);
+  CHECK(out[2] == 129);
+  CHECK(out[3] == 0);
+
+  const unsigned char white[] = {255, 255, 255};
+  const unsigned char red[] = {255, 0, 0};
+  ref->rgb(white, out, 1, 0);
+  CHECK(out[0] == 235);
+  ref->rgb(red, out, 1, 0);
+  CHECK(out[0] == 82);
+  ref->bgr(red, out, 1, 0);
+  CHECK(out[0] == 41);
+  ref->rgb(white, out, 1, 235);
+  CHECK(out[0] == 0);
+}
+
+TEST_CASE("All kernel sets are bit identical to scalar", "[image_convert]") {
+  const ltr_int_bw_kernels_t *ref = ltr_int_bw_kernel(0);
+  REQUIRE(ref != nullptr);
+  REQUIRE(ltr_int_bw_select_kernels() != nullptr);
+
+  for (unsigned int i = 1; i < ltr_int_bw_kernel_count(); ++i) {
+    const ltr_int_bw_kernels_t *k = ltr_int_bw_kernel(i);
+    if (k == nullptr) {
+      WARN("Kernel set " << i << " not supported by this CPU, skipping");
+      continue;
+    }
+    SECTION(std::string(k->name) + " YUYV") {
+      checkKernel(ref->yuyv, k->yuyv, 2);
+    }
+    SECTION(std::string(k->name) + " luma plane") {
+      checkKernel(ref->luma, k->luma, 1);
+    }
+    SECTION(std::string(k->name) + " RGB3") {
+      checkKernel(ref->rgb, k->rgb, 3);
+    }
+    SECTION(std::string(k->name) + " BGR3") {
+      checkKernel(ref->bgr, k->bgr, 3);
+    }
+  }
+}
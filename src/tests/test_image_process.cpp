@@ -0,0 +1,346 @@
+// Unit tests and benchmark for the blob detector in image_process
+// Uses Catch2 v3 testing framework
+
+#include "../image_process.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static const int W = 640;
+static const int H = 480;
+
+static void drawSquare(std::vector<unsigned char> &bmp, int x, int y, int size,
+                       unsigned char val) {
+  for (int j = y; j < y + size; ++j) {
+    for (int i = x; i < x + size; ++i) {
+      bmp[j * W + i] = val;
+    }
+  }
+}
+
+// Sparse single pixel noise plus a few LEDs; hundreds of stripes per frame
+static std::vector<unsigned char> noisyFrame(unsigned seed, int noise_pixels) {
+  std::vector<unsigned char> bmp(W * H, 0);
+  srand(seed);
+  for (int i = 0; i < noise_pixels; ++i) {
+    bmp[rand() % (W * H)] = 100 + rand() % 155;
+  }
+  drawSquare(bmp, 100, 100, 6, 255);
+  drawSquare(bmp, 300, 120, 6, 255);
+  drawSquare(bmp, 500, 300, 6, 255);
+  return bmp;
+}
+
+static int detect(std::vector<unsigned char> &bmp, struct blob_type *blobs,
+                  unsigned int max_blobs, int min_pts, int max_pts) {
+  struct bloblist_type bl;
+  bl.blobs = blobs;
+  bl.num_blobs = max_blobs;
+  bl.expected_blobs = 3;
+  image_t img = {W, H, bmp.data(), 1.0f};
+  ltr_int_to_stripes(&img);
+  ltr_int_stripes_to_blobs(max_blobs, &bl, min_pts, max_pts, &img);
+  return bl.num_blobs;
+}
+
+TEST_CASE("Blobs are found and merged", "[image_process]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> bmp(W * H, 0);
+  // U shape - the arms only join at the bottom row
+  drawSquare(bmp, 10, 10, 3, 200);
+  drawSquare(bmp, 20, 10, 3, 200);
+  for (int i = 10; i < 23; ++i) {
+    bmp[13 * W + i] = 200;
+  }
+  // Diagonal neighbours belong to the same blob
+  bmp[50 * W + 50] = 100;
+  bmp[51 * W + 51] = 100;
+  // Lone square with known centre
+  drawSquare(bmp, 301, 201, 5, 255);
+
+  struct blob_type blobs[10];
+  REQUIRE(detect(bmp, blobs, 10, 1, 1000) == 3);
+  int found = 0;
+  for (int i = 0; i < 3; ++i) {
+    if (blobs[i].score == 25) {
+      // centre pixel (303, 203) in camera coordinates
+      CHECK(blobs[i].x == Catch::Approx((W - 1) / 2.0 - 303));
+      CHECK(blobs[i].y == Catch::Approx((H - 1) / 2.0 - 203));
+      ++found;
+    } else if (blobs[i].score == 31) {
+      ++found;
+    } else if (blobs[i].score == 2) {
+      CHECK(blobs[i].x == Catch::Approx((W - 1) / 2.0 - 50.5));
+      ++found;
+    }
+  }
+  CHECK(found == 3);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Stripes added out of order still merge", "[image_process]") {
+  ltr_int_prepare_for_processing(W, H);
+  image_t img = {W, H, nullptr, 1.0f};
+  // vline, hstart, hstop, sum_x, sum, points
+  stripe_t stripes[] = {{5, 10, 12, 3, 3, 3},
+                        {5, 2, 4, 3, 3, 3},
+                        {6, 5, 9, 10, 5, 5},
+                        {6, 40, 40, 0, 1, 1}};
+  for (stripe_t &s : stripes) {
+    REQUIRE(ltr_int_add_stripe(&s, &img));
+  }
+  struct blob_type blobs[10];
+  struct bloblist_type bl;
+  bl.blobs = blobs;
+  bl.num_blobs = 10;
+  bl.expected_blobs = 3;
+  ltr_int_stripes_to_blobs(10, &bl, 1, 1000, &img);
+  REQUIRE(bl.num_blobs == 2);
+  CHECK(blobs[0].score == 11);
+  CHECK(blobs[1].score == 1);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Blob size limits are honoured", "[image_process]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> bmp = noisyFrame(42, 2000);
+  struct blob_type blobs[10];
+  REQUIRE(detect(bmp, blobs, 10, 20, 1000) == 3);
+  for (int i = 0; i < 3; ++i) {
+    CHECK(blobs[i].score == 36);
+  }
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Blob detection on noisy frames", "[.][benchmark]") {
+  ltr_int_prepare_for_processing(W, H);
+  struct blob_type blobs[10];
+  for (int noise : {500, 5000, 20000}) {
+    std::vector<unsigned char> src = noisyFrame(1, noise);
+    std::vector<unsigned char> bmp(src.size());
+    BENCHMARK("640x480, " + std::to_string(noise) + " noise pixels") {
+      bmp = src;
+      return detect(bmp, blobs, 10, 20, 1000);
+    };
+  }
+  ltr_int_cleanup_after_processing();
+}
+
+static int scan(const std::vector<unsigned char> &frame, struct blob_type *blobs,
+                std::vector<unsigned char> &row_buf, bool in_place = false) {
+  struct bloblist_type bl;
+  bl.blobs = blobs;
+  bl.num_blobs = 10;
+  bl.expected_blobs = 3;
+  image_t img = {W, H, nullptr, 1.0f};
+  ltr_int_scan_frame(frame.data(), W, 1, H,
+                     in_place ? nullptr : ltr_int_bw_kernel(0)->luma, 50,
+                     row_buf.data(), &img);
+  ltr_int_stripes_to_blobs(10, &bl, 4, 1000, &img);
+  return bl.num_blobs;
+}
+
+TEST_CASE("ROI tracking scans windows and falls back", "[image_process]") {
+  ltr_int_prepare_for_processing(W, H);
+  ltr_int_set_roi(true, 10, 5);
+  std::vector<unsigned char> row_buf(W);
+  struct blob_type blobs[10], reference[10];
+  ltr_int_roi_stats_t stats;
+
+  std::vector<unsigned char> frame(W * H, 0);
+  drawSquare(frame, 100, 100, 6, 255);
+  drawSquare(frame, 300, 120, 6, 255);
+  drawSquare(frame, 500, 300, 6, 255);
+  // Full scan locks on
+  REQUIRE(scan(frame, reference, row_buf) == 3);
+
+  // Small move - found through the windows, same result as a full scan
+  std::vector<unsigned char> moved(W * H, 0);
+  drawSquare(moved, 103, 98, 6, 255);
+  drawSquare(moved, 300, 123, 6, 255);
+  drawSquare(moved, 497, 300, 6, 255);
+  // Oversized clutter far from the LEDs is never seen through the windows
+  drawSquare(moved, 10, 400, 40, 255);
+  REQUIRE(scan(moved, blobs, row_buf) == 3);
+  ltr_int_get_roi_stats(&stats);
+  CHECK(stats.roi_frames == 1);
+  CHECK(blobs[0].x == Catch::Approx((W - 1) / 2.0 - 105.5));
+  CHECK(blobs[2].x == Catch::Approx((W - 1) / 2.0 - 499.5));
+
+  // Lost LED forces full scans until all of them are back
+  drawSquare(moved, 300, 123, 6, 0);
+  REQUIRE(scan(moved, blobs, row_buf) == 2);
+  REQUIRE(scan(moved, blobs, row_buf) == 2);
+  ltr_int_get_roi_stats(&stats);
+  CHECK(stats.fallback_missing == 1);
+  CHECK(stats.roi_frames == 2);
+
+  // LED escaping its window
+  REQUIRE(scan(frame, reference, row_buf) == 3);
+  drawSquare(frame, 100, 100, 6, 0);
+  drawSquare(frame, 110, 100, 6, 255);
+  scan(frame, blobs, row_buf);
+  ltr_int_get_roi_stats(&stats);
+  CHECK(stats.fallback_edge == 1);
+  REQUIRE(scan(frame, blobs, row_buf) == 3);
+
+  // Periodic full scans
+  for (int i = 0; i < 10; ++i) {
+    scan(frame, blobs, row_buf);
+  }
+  ltr_int_get_roi_stats(&stats);
+  CHECK(stats.fallback_interval >= 1);
+
+  ltr_int_set_roi(false, 10, 5);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Full frame versus ROI scanning", "[.][benchmark]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> row_buf(W);
+  std::vector<unsigned char> frame = noisyFrame(1, 500);
+  struct blob_type blobs[10];
+  ltr_int_set_roi(false, 16, 1000000);
+  BENCHMARK("640x480 full scan") { return scan(frame, blobs, row_buf); };
+  ltr_int_set_roi(true, 16, 1000000);
+  BENCHMARK("640x480 ROI scan") { return scan(frame, blobs, row_buf); };
+  ltr_int_set_roi(false, 16, 30);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Banded scanning matches the serial path", "[image_process]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> row_buf(W);
+  struct blob_type serial[10], banded[10];
+  for (unsigned seed : {1u, 2u, 3u}) {
+    std::vector<unsigned char> frame = noisyFrame(seed, 20000);
+    // LED straddling the seams of every band split tried below
+    drawSquare(frame, 200, 116, 10, 255);
+    drawSquare(frame, 400, 236, 10, 255);
+    for (int threads : {2, 3, 4, 8}) {
+      ltr_int_set_processing_threads(1);
+      int n = scan(frame, serial, row_buf);
+      ltr_int_set_processing_threads(threads);
+      INFO("seed " << seed << ", threads " << threads);
+      REQUIRE(scan(frame, banded, row_buf) == n);
+      for (int i = 0; i < n; ++i) {
+        CHECK(banded[i].x == serial[i].x);
+        CHECK(banded[i].y == serial[i].y);
+        CHECK(banded[i].score == serial[i].score);
+      }
+      std::vector<unsigned char> a = frame, b = frame;
+      ltr_int_set_processing_threads(1);
+      n = detect(a, serial, 10, 1, 1000);
+      ltr_int_set_processing_threads(threads);
+      REQUIRE(detect(b, banded, 10, 1, 1000) == n);
+      CHECK(a == b);
+      for (int i = 0; i < n; ++i) {
+        CHECK(banded[i].x == serial[i].x);
+        CHECK(banded[i].score == serial[i].score);
+      }
+    }
+  }
+  ltr_int_set_processing_threads(1);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Detector instances run side by side", "[image_process]") {
+  // reference results from the process wide detector
+  ltr_int_prepare_for_processing(W, H);
+  struct blob_type expected[2][10];
+  int expected_n[2];
+  std::vector<unsigned char> frames[2] = {noisyFrame(4, 5000),
+                                          noisyFrame(5, 5000)};
+  drawSquare(frames[1], 50, 400, 8, 255);
+  for (int k = 0; k < 2; ++k) {
+    std::vector<unsigned char> bmp = frames[k];
+    expected_n[k] = detect(bmp, expected[k], 10, 1, 1000);
+  }
+  ltr_int_cleanup_after_processing();
+
+  bool same[2] = {true, true};
+  std::thread workers[2];
+  for (int k = 0; k < 2; ++k) {
+    workers[k] = std::thread([&, k]() {
+      ltr_blob_detector_t *d = ltr_int_detector_create();
+      ltr_int_detector_prepare(d, W, H);
+      ltr_int_detector_set_threads(d, 2 + k);
+      ltr_int_detector_set_roi(d, k == 0, 16, 30);
+      for (int i = 0; i < 50; ++i) {
+        std::vector<unsigned char> bmp = frames[k];
+        struct blob_type blobs[10];
+        struct bloblist_type bl = {10, 3, blobs};
+        image_t img = {W, H, bmp.data(), 1.0f};
+        ltr_int_detector_to_stripes(d, &img);
+        ltr_int_detector_stripes_to_blobs(d, 10, &bl, 1, 1000, &img);
+        if ((int)bl.num_blobs != expected_n[k]) {
+          same[k] = false;
+          continue;
+        }
+        for (unsigned int j = 0; j < bl.num_blobs; ++j) {
+          if ((blobs[j].x != expected[k][j].x) ||
+              (blobs[j].score != expected[k][j].score)) {
+            same[k] = false;
+          }
+        }
+      }
+      ltr_int_detector_free(d);
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  CHECK(same[0]);
+  CHECK(same[1]);
+}
+
+TEST_CASE("Serial versus banded scanning", "[.][benchmark]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> row_buf(W);
+  std::vector<unsigned char> frame = noisyFrame(1, 5000);
+  struct blob_type blobs[10];
+  for (int threads : {1, 2, 4}) {
+    ltr_int_set_processing_threads(threads);
+    BENCHMARK("640x480, " + std::to_string(threads) + " bands") {
+      return scan(frame, blobs, row_buf);
+    };
+  }
+  ltr_int_set_processing_threads(1);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Luma plane scanned in place matches the converted one",
+          "[image_process]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> row_buf(W);
+  struct blob_type converted[10], in_place[10];
+  std::vector<unsigned char> frame = noisyFrame(7, 20000);
+  // pixels right at the threshold stay dark
+  drawSquare(frame, 50, 400, 6, 50);
+  drawSquare(frame, 60, 400, 6, 51);
+  for (int threads : {1, 4}) {
+    ltr_int_set_processing_threads(threads);
+    int n = scan(frame, converted, row_buf);
+    std::vector<unsigned char> untouched = frame;
+    REQUIRE(scan(frame, in_place, row_buf, true) == n);
+    CHECK(frame == untouched);
+    for (int i = 0; i < n; ++i) {
+      CHECK(in_place[i].x == converted[i].x);
+      CHECK(in_place[i].y == converted[i].y);
+      CHECK(in_place[i].score == converted[i].score);
+    }
+  }
+  ltr_int_set_processing_threads(1);
+  ltr_int_cleanup_after_processing();
+}
+
+TEST_CASE("Converted versus in place luma scanning", "[.][benchmark]") {
+  ltr_int_prepare_for_processing(W, H);
+  std::vector<unsigned char> row_buf(W);
+  std::vector<unsigned char> frame = noisyFrame(1, 500);
+  struct blob_type blobs[10];
+  BENCHMARK("640x480 converted") { return scan(frame, blobs, row_buf); };
+  BENCHMARK("640x480 in place") { return scan(frame, blobs, row_buf, true); };
+  ltr_int_cleanup_after_processing();
+}
@@ -0,0 +1,124 @@
+// Unit tests for the sequence counter protecting the client pose channel
+// Uses Catch2 v3 testing framework
+
+#include "../ipc_utils.h"
+#include "../ltlib.h"
+#include "../utils.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+// Every field of the pose carries the same value, so a torn copy shows
+static void fill(struct ltr_comm *com, uint32_t v) {
+  com->full_pose.pose.counter = v;
+  com->full_pose.pose.yaw = (float)v;
+  com->full_pose.pose.tz = (float)v;
+  com->full_pose.timestamp = (int)v;
+  com->timestamp = v;
+  for (int i = 0; i < BLOB_ELEMENTS * MAX_BLOBS; ++i) {
+    com->full_pose.blob_list[i] = (float)v;
+  }
+}
+
+static bool consistent(const struct ltr_comm &c) {
+  uint32_t v = c.full_pose.pose.counter;
+  if ((c.full_pose.pose.yaw != (float)v) || (c.full_pose.pose.tz != (float)v) ||
+      (c.full_pose.timestamp != (int)v) || (c.timestamp != v)) {
+    return false;
+  }
+  for (int i = 0; i < BLOB_ELEMENTS * MAX_BLOBS; ++i) {
+    if (c.full_pose.blob_list[i] != (float)v) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST_CASE("Seq read refuses data while a write is in progress", "[ipc_seq]") {
+  struct ltr_comm com, tmp;
+  memset(&com, 0, sizeof(com));
+  fill(&com, 1);
+  REQUIRE(ltr_int_seq_read(&com.seq, &tmp, &com, sizeof(com)));
+  CHECK(tmp.full_pose.pose.counter == 1);
+
+  ltr_int_seq_write_begin(&com.seq);
+  fill(&com, 2);
+  CHECK_FALSE(ltr_int_seq_read(&com.seq, &tmp, &com, sizeof(com)));
+  ltr_int_seq_write_end(&com.seq);
+  REQUIRE(ltr_int_seq_read(&com.seq, &tmp, &com, sizeof(com)));
+  CHECK(tmp.full_pose.pose.counter == 2);
+  CHECK(com.seq == 2);
+}
+
+TEST_CASE("Seq readers never see a torn pose", "[ipc_seq]") {
+  static struct ltr_comm com;
+  memset(&com, 0, sizeof(com));
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    for (uint32_t v = 1; v <= 200000; ++v) {
+      ltr_int_seq_write_begin(&com.seq);
+      fill(&com, v);
+      ltr_int_seq_write_end(&com.seq);
+    }
+    done = true;
+  });
+  int torn = 0, reads = 0;
+  while (!done) {
+    struct ltr_comm tmp;
+    if (ltr_int_seq_read(&com.seq, &tmp, &com, sizeof(com))) {
+      ++reads;
+      if (!consistent(tmp)) {
+        ++torn;
+      }
+    }
+  }
+  writer.join();
+  CHECK(reads > 0);
+  CHECK(torn == 0);
+}
+
+TEST_CASE("Futex waiters time out and wake on a new sequence", "[ipc_seq]") {
+  static uint32_t seq = 2;
+  CHECK(ltr_int_futex_wait(&seq, 2, 20) == 0);
+  // value already moved on, nothing to sleep for
+  CHECK(ltr_int_futex_wait(&seq, 0, 1000) == 1);
+
+  std::atomic<int> woke(-2);
+  std::thread waiter([&]() { woke = ltr_int_futex_wait(&seq, 2, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ltr_int_seq_write_begin(&seq);
+  ltr_int_seq_write_end(&seq);
+  ltr_int_futex_wake(&seq);
+  waiter.join();
+  CHECK(woke == 1);
+  CHECK(seq == 4);
+}
+
+TEST_CASE("Client channel keeps the layout of released clients",
+          "[ipc_seq]") {
+  // offsets lock-taking clients of the first release read, 32 and 64 bit
+  CHECK(offsetof(struct ltr_comm, full_pose) == 4);
+  CHECK(offsetof(struct ltr_comm, dead_man_button) == 312);
+  CHECK(offsetof(struct ltr_comm, preparing_start) == 313);
+  // the seq counter lives in their tail padding and right after it
+  CHECK(offsetof(struct ltr_comm, has_seq) == 314);
+  CHECK(offsetof(struct ltr_comm, waiters) == 315);
+  CHECK(offsetof(struct ltr_comm, seq) == 316);
+  CHECK(offsetof(struct ltr_comm, cmd_seq) == 320);
+  CHECK(offsetof(struct ltr_comm, timestamp) == 328);
+  CHECK(sizeof(struct ltr_comm) == 344);
+}
+
+TEST_CASE("Channel keeps 32 bit timestamps for older clients", "[ipc_seq]") {
+  int64_t now = ltr_int_make_ts(5000, 250);
+  CHECK(ltr_int_legacy_ts(now) == (5000 % 1024) * 1000000 + 250);
+  CHECK(ltr_int_unwrap_legacy_ts(ltr_int_legacy_ts(now), now) == now);
+  CHECK(ltr_int_unwrap_legacy_ts(ltr_int_legacy_ts(now - 40000), now) ==
+        now - 40000);
+  // taken before the 32 bit timestamp last wrapped
+  int64_t wrap = ltr_int_make_ts(5120, 0);
+  CHECK(ltr_int_unwrap_legacy_ts(ltr_int_legacy_ts(wrap - 10), wrap + 10) ==
+        wrap - 10);
+}
@@ -0,0 +1,62 @@
+// Unit tests for the latency trace histograms
+// Uses Catch2 v3 testing framework
+
+#include "../latency_trace.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Trace histogram percentiles stay within a bucket",
+          "[latency_trace]") {
+  ltr_trace_hist_t hist;
+  memset(&hist, 0, sizeof(hist));
+  CHECK(ltr_int_trace_hist_percentile(&hist, 50.0) == 0);
+
+  // 1..10000us, evenly spread
+  for (unsigned int us = 1; us <= 10000; ++us) {
+    ltr_int_trace_hist_add(&hist, us);
+  }
+  CHECK(hist.count == 10000);
+  CHECK(hist.max_us == 10000);
+  const double percentiles[] = {50.0, 95.0, 99.0};
+  for (double p : percentiles) {
+    double exact = p * 100.0;
+    unsigned int got = ltr_int_trace_hist_percentile(&hist, p);
+    CHECK(got >= exact);
+    CHECK(got <= exact * 1.125 + 1);
+  }
+  CHECK(ltr_int_trace_hist_percentile(&hist, 100.0) == 10000);
+
+  // small values are exact, huge ones land in the last bucket
+  memset(&hist, 0, sizeof(hist));
+  ltr_int_trace_hist_add(&hist, 7);
+  CHECK(ltr_int_trace_hist_percentile(&hist, 50.0) == 7);
+  ltr_int_trace_hist_add(&hist, 100000000);
+  CHECK(hist.max_us == 100000000);
+  CHECK(ltr_int_trace_hist_percentile(&hist, 100.0) > 4000000);
+}
+
+TEST_CASE("Trace histogram counts concurrent samples", "[latency_trace]") {
+  ltr_trace_hist_t hist;
+  memset(&hist, 0, sizeof(hist));
+  const unsigned int per_thread = 20000;
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0; t < 4; ++t) {
+    threads.emplace_back([&hist, t, per_thread]() {
+      for (unsigned int i = 0; i < per_thread; ++i) {
+        ltr_int_trace_hist_add(&hist, t * 1000 + i % 500);
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  uint64_t total = 0;
+  for (uint64_t b : hist.buckets) {
+    total += b;
+  }
+  CHECK(hist.count == 4 * per_thread);
+  CHECK(total == 4 * per_thread);
+  CHECK(hist.max_us == 3499);
+}
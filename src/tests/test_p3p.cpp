@@ -0,0 +1,142 @@
+// Accuracy tests and benchmark for the closed form P3P solver
+// Uses Catch2 v3 testing framework
+
+#include "../p3p.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <cmath>
+#include <cstdlib>
+
+// Cap model (mm), roughly what the TrackClip Pro/cap presets describe
+static double model[3][3] = {
+    {0.0, 0.0, 0.0}, {-70.0, -45.0, -95.0}, {70.0, -45.0, -95.0}};
+
+static double rnd(double lo, double hi) {
+  return lo + (hi - lo) * (rand() / (double)RAND_MAX);
+}
+
+static void rotation(double pitch, double yaw, double roll, double r[3][3]) {
+  double cp = cos(pitch), sp = sin(pitch), cy = cos(yaw), sy = sin(yaw),
+         cr = cos(roll), sr = sin(roll);
+  double rx[3][3] = {{1, 0, 0}, {0, cp, -sp}, {0, sp, cp}};
+  double ry[3][3] = {{cy, 0, sy}, {0, 1, 0}, {-sy, 0, cy}};
+  double rz[3][3] = {{cr, -sr, 0}, {sr, cr, 0}, {0, 0, 1}};
+  double t[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      t[i][j] = 0;
+      for (int k = 0; k < 3; ++k) {
+        t[i][j] += ry[i][k] * rx[k][j];
+      }
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      r[i][j] = 0;
+      for (int k = 0; k < 3; ++k) {
+        r[i][j] += rz[i][k] * t[k][j];
+      }
+    }
+  }
+}
+
+// Places the model in front of the camera and computes the exact bearings
+static void scene(double pts[3][3], double bearings[3][3], double deg) {
+  double r[3][3];
+  rotation(rnd(-deg, deg) * M_PI / 180, rnd(-deg, deg) * M_PI / 180,
+           rnd(-deg / 2, deg / 2) * M_PI / 180, r);
+  double t[3] = {rnd(-150, 150), rnd(-100, 100), rnd(400, 1200)};
+  for (int i = 0; i < 3; ++i) {
+    double len = 0.0;
+    for (int j = 0; j < 3; ++j) {
+      pts[i][j] = t[j];
+      for (int k = 0; k < 3; ++k) {
+        pts[i][j] += r[j][k] * model[i][k];
+      }
+      len += pts[i][j] * pts[i][j];
+    }
+    len = sqrt(len);
+    for (int j = 0; j < 3; ++j) {
+      bearings[i][j] = pts[i][j] / len;
+    }
+  }
+}
+
+// Worst point position error of the candidate closest to the truth
+static double bestError(double pts[3][3], double bearings[3][3],
+                        double depths[P3P_MAX_SOLUTIONS][3], int n) {
+  double best = 1e30;
+  for (int s = 0; s < n; ++s) {
+    double worst = 0.0;
+    for (int i = 0; i < 3; ++i) {
+      double d2 = 0.0;
+      for (int j = 0; j < 3; ++j) {
+        double e = depths[s][i] * bearings[i][j] - pts[i][j];
+        d2 += e * e;
+      }
+      worst = std::max(worst, sqrt(d2));
+    }
+    best = std::min(best, worst);
+  }
+  return best;
+}
+
+TEST_CASE("P3P recovers synthetic poses", "[p3p]") {
+  srand(42);
+  double pts[3][3], bearings[3][3], depths[P3P_MAX_SOLUTIONS][3];
+  double max_err = 0.0;
+  for (int i = 0; i < 2000; ++i) {
+    scene(pts, bearings, 60.0);
+    int n = ltr_int_p3p(bearings, model, depths);
+    REQUIRE(n >= 1);
+    REQUIRE(n <= P3P_MAX_SOLUTIONS);
+    max_err = std::max(max_err, bestError(pts, bearings, depths, n));
+  }
+  // micrometers at arm's length
+  CHECK(max_err < 1e-3);
+}
+
+TEST_CASE("P3P candidates all satisfy the model distances", "[p3p]") {
+  srand(7);
+  double pts[3][3], bearings[3][3], depths[P3P_MAX_SOLUTIONS][3];
+  for (int i = 0; i < 500; ++i) {
+    scene(pts, bearings, 80.0);
+    int n = ltr_int_p3p(bearings, model, depths);
+    for (int s = 0; s < n; ++s) {
+      for (int a = 0; a < 3; ++a) {
+        int b = (a + 1) % 3;
+        double d2 = 0.0, m2 = 0.0;
+        for (int j = 0; j < 3; ++j) {
+          double e = depths[s][a] * bearings[a][j] -
+                     depths[s][b] * bearings[b][j];
+          d2 += e * e;
+          m2 += (model[a][j] - model[b][j]) * (model[a][j] - model[b][j]);
+        }
+        CHECK(std::fabs(sqrt(d2) - sqrt(m2)) < 1e-3);
+      }
+    }
+  }
+}
+
+TEST_CASE("P3P rejects degenerate input", "[p3p]") {
+  double collinear[3][3] = {{0, 0, 0}, {10, 0, 0}, {20, 0, 0}};
+  double bearings[3][3] = {{0, 0, 1}, {0, 0, 1}, {0, 0, 1}};
+  double depths[P3P_MAX_SOLUTIONS][3];
+  int n = ltr_int_p3p(bearings, collinear, depths);
+  CHECK(n >= 0);
+  CHECK(n <= P3P_MAX_SOLUTIONS);
+}
+
+TEST_CASE("P3P solver speed", "[.][benchmark]") {
+  srand(1);
+  const int scenes = 64;
+  static double pts[scenes][3][3], bearings[scenes][3][3];
+  for (int i = 0; i < scenes; ++i) {
+    scene(pts[i], bearings[i], 60.0);
+  }
+  double depths[P3P_MAX_SOLUTIONS][3];
+  int next = 0;
+  BENCHMARK("closed form P3P") {
+    next = (next + 1) % scenes;
+    return ltr_int_p3p(bearings[next], model, depths);
+  };
+}
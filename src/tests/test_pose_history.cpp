@@ -0,0 +1,91 @@
+// Unit tests for the pose history kept in the client channel file
+// Uses Catch2 v3 testing framework
+
+#include "../pose_history.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+static void push(pose_history_t *h, uint32_t n) {
+  linuxtrack_pose_t pose = {};
+  pose.counter = n;
+  pose.yaw = (float)n;
+  pose.raw_yaw = 2.0f * n;
+  ltr_int_pose_history_push(h, 1000 * (int64_t)n, &pose);
+}
+
+TEST_CASE("Pose history follows the channel in the client file",
+          "[pose_history]") {
+  // 32bit clients share the file with 64bit servers
+  CHECK(sizeof(struct ltr_comm) % 8 == 0);
+  CHECK(offsetof(pose_history_slot_t, timestamp) == 8);
+  CHECK(sizeof(pose_history_slot_t) == 80);
+  CHECK(LTR_COMM_FILE_SIZE == sizeof(struct ltr_comm) + 8 + 80 * 64);
+}
+
+TEST_CASE("Pose history hands out the latest poses oldest first",
+          "[pose_history]") {
+  static pose_history_t h;
+  ltr_int_pose_history_reset(&h);
+  linuxtrack_timed_pose_t out[POSE_HISTORY_SLOTS + 8];
+  CHECK(ltr_int_pose_history_read(&h, INT64_MIN, INT64_MAX, out, 8) == 0);
+
+  for (uint32_t n = 1; n <= 5; ++n) {
+    push(&h, n);
+  }
+  REQUIRE(ltr_int_pose_history_read(&h, INT64_MIN, INT64_MAX, out, 8) == 5);
+  CHECK(out[0].pose.counter == 1);
+  CHECK(out[4].pose.counter == 5);
+  CHECK(out[4].timestamp == 5000);
+  CHECK(out[4].pose.raw_yaw == 10.0f);
+
+  for (uint32_t n = 6; n <= 200; ++n) {
+    push(&h, n);
+  }
+  REQUIRE(ltr_int_pose_history_read(&h, INT64_MIN, INT64_MAX, out, 3) == 3);
+  CHECK(out[0].pose.counter == 198);
+  CHECK(out[2].pose.counter == 200);
+  // only a ring's worth is kept
+  REQUIRE(ltr_int_pose_history_read(&h, INT64_MIN, INT64_MAX, out,
+                                    POSE_HISTORY_SLOTS + 8) ==
+          POSE_HISTORY_SLOTS);
+  CHECK(out[0].pose.counter == 200 - POSE_HISTORY_SLOTS + 1);
+
+  // a time range, inclusive at both ends
+  REQUIRE(ltr_int_pose_history_read(&h, 150000, 160000, out, 64) == 11);
+  CHECK(out[0].pose.counter == 150);
+  CHECK(out[10].pose.counter == 160);
+  CHECK(ltr_int_pose_history_read(&h, 10000, 20000, out, 64) == 0);
+}
+
+TEST_CASE("Pose history readers never see torn poses", "[pose_history]") {
+  static pose_history_t h;
+  ltr_int_pose_history_reset(&h);
+  std::atomic<int> reads(0);
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    // keeps going until the reader had its share, however it's scheduled
+    for (uint32_t n = 1; (n <= 100000) || (reads < 1000); ++n) {
+      push(&h, n);
+    }
+    done = true;
+  });
+  linuxtrack_timed_pose_t out[16];
+  bool intact = true;
+  while (!done) {
+    int n = ltr_int_pose_history_read(&h, INT64_MIN, INT64_MAX, out, 16);
+    for (int i = 0; i < n; ++i) {
+      uint32_t c = out[i].pose.counter;
+      intact = intact && (out[i].pose.yaw == (float)c) &&
+               (out[i].timestamp == 1000 * (int64_t)c) &&
+               ((i == 0) || (out[i - 1].pose.counter + 1 == c));
+    }
+    if (n > 0) {
+      ++reads;
+    }
+  }
+  writer.join();
+  CHECK(reads >= 1000);
+  CHECK(intact);
+}
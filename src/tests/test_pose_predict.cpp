@@ -0,0 +1,87 @@
+// Unit tests for sampling poses at a given time
+// Uses Catch2 v3 testing framework
+
+#include "../pose_predict.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <vector>
+
+using Catch::Approx;
+
+// Poses 10ms apart with yaw following f and tz its negative
+template <typename F>
+static std::vector<linuxtrack_timed_pose_t> track(int n, F f) {
+  std::vector<linuxtrack_timed_pose_t> poses(n);
+  for (int i = 0; i < n; ++i) {
+    poses[i] = {};
+    poses[i].timestamp = 1000000 + 10000 * i;
+    poses[i].pose.counter = i;
+    poses[i].pose.yaw = f(i);
+    poses[i].pose.raw_yaw = f(i);
+    poses[i].pose.tz = -f(i);
+  }
+  return poses;
+}
+
+TEST_CASE("Extrapolation factor rounds out far predictions",
+          "[pose_predict]") {
+  CHECK(ltr_int_extrapolation_factor(0, 10000, 10000) == 0.0f);
+  CHECK(ltr_int_extrapolation_factor(0, 10000, 15000) == Approx(0.5f));
+  CHECK(ltr_int_extrapolation_factor(0, 10000, 40000) == Approx(3.0f));
+  float far = ltr_int_extrapolation_factor(0, 10000, 1000000);
+  CHECK(far > 3.0f);
+  CHECK(far < 5.0f);
+  // equal timestamps don't divide by zero
+  CHECK(ltr_int_extrapolation_factor(10000, 10000, 20000) == 0.0f);
+}
+
+TEST_CASE("Poses are interpolated between samples", "[pose_predict]") {
+  auto poses = track(5, [](int i) { return 2.0f * i; });
+  linuxtrack_pose_t p;
+  ltr_int_predict_pose(poses.data(), 5, 1025000, LINUXTRACK_PREDICT_LINEAR,
+                       &p);
+  CHECK(p.yaw == Approx(5.0f));
+  CHECK(p.tz == Approx(-5.0f));
+  CHECK(p.counter == 4);
+  // before the oldest sample the oldest one is it
+  ltr_int_predict_pose(poses.data(), 5, 500000, LINUXTRACK_PREDICT_ACCEL, &p);
+  CHECK(p.yaw == 0.0f);
+}
+
+TEST_CASE("Linear prediction follows constant motion", "[pose_predict]") {
+  auto poses = track(4, [](int i) { return 3.0f * i; });
+  linuxtrack_pose_t p;
+  // half a frame ahead of the newest pose at 1030000
+  ltr_int_predict_pose(poses.data(), 4, 1035000, LINUXTRACK_PREDICT_LINEAR,
+                       &p);
+  CHECK(p.yaw == Approx(10.5f));
+  CHECK(p.raw_yaw == Approx(10.5f));
+  // no acceleration to add either
+  ltr_int_predict_pose(poses.data(), 4, 1035000, LINUXTRACK_PREDICT_ACCEL,
+                       &p);
+  CHECK(p.yaw == Approx(10.5f));
+  // a single pose is all there is
+  ltr_int_predict_pose(poses.data(), 1, 1035000, LINUXTRACK_PREDICT_LINEAR,
+                       &p);
+  CHECK(p.yaw == 0.0f);
+}
+
+TEST_CASE("Acceleration prediction follows a parabola and is clamped",
+          "[pose_predict]") {
+  auto poses = track(3, [](int i) { return 1.0f * i * i; });
+  linuxtrack_pose_t p;
+  // yaw 0, 1, 4; next frame lands at 9
+  ltr_int_predict_pose(poses.data(), 3, 1030000, LINUXTRACK_PREDICT_ACCEL,
+                       &p);
+  CHECK(p.yaw == Approx(9.0f));
+  CHECK(p.tz == Approx(-9.0f));
+  ltr_int_predict_pose(poses.data(), 3, 1030000, LINUXTRACK_PREDICT_LINEAR,
+                       &p);
+  CHECK(p.yaw == Approx(7.0f));
+
+  // a jitter spike doesn't fling the pose further than twice the motion
+  auto spike = track(3, [](int i) { return (i == 1) ? -20.0f : 0.1f * i; });
+  ltr_int_predict_pose(spike.data(), 3, 1030000, LINUXTRACK_PREDICT_ACCEL,
+                       &p);
+  float step = 0.2f + 20.0f;
+  CHECK(p.yaw == Approx(0.2f + 2.0f * step));
+}
@@ -0,0 +1,171 @@
+// Unit tests for the master to slave pose ring
+// Uses Catch2 v3 testing framework
+
+#include "../pose_ring.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// The ring works the same in plain memory as in the shared file
+static std::unique_ptr<pose_ring_t> make_ring() {
+  std::unique_ptr<pose_ring_t> ring(new pose_ring_t);
+  memset(ring.get(), 0, sizeof(pose_ring_t));
+  ring->slots = POSE_RING_SLOTS;
+  return ring;
+}
+
+static linuxtrack_full_pose_t pose_no(uint32_t v) {
+  linuxtrack_full_pose_t p;
+  memset(&p, 0, sizeof(p));
+  p.pose.counter = v;
+  p.pose.yaw = (float)v;
+  p.timestamp = v;
+  for (int i = 0; i < BLOB_ELEMENTS * MAX_BLOBS; ++i) {
+    p.blob_list[i] = (float)v;
+  }
+  return p;
+}
+
+static bool consistent(const linuxtrack_full_pose_t &p) {
+  uint32_t v = p.pose.counter;
+  if ((p.pose.yaw != (float)v) || (p.timestamp != v)) {
+    return false;
+  }
+  for (int i = 0; i < BLOB_ELEMENTS * MAX_BLOBS; ++i) {
+    if (p.blob_list[i] != (float)v) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST_CASE("Pose ring delivers poses in order", "[pose_ring]") {
+  auto ring = make_ring();
+  linuxtrack_full_pose_t p = pose_no(0);
+  ltr_int_pose_ring_publish(ring.get(), &p);
+
+  // readers only see what was published after they attached
+  pose_ring_reader_t a, b;
+  ltr_int_pose_ring_attach(&a, ring.get());
+  ltr_int_pose_ring_attach(&b, ring.get());
+  CHECK_FALSE(ltr_int_pose_ring_read(&a, &p));
+  for (uint32_t i = 1; i <= 10; ++i) {
+    p = pose_no(i);
+    ltr_int_pose_ring_publish(ring.get(), &p);
+  }
+  for (uint32_t i = 1; i <= 10; ++i) {
+    REQUIRE(ltr_int_pose_ring_read(&a, &p));
+    CHECK(p.pose.counter == i);
+  }
+  CHECK_FALSE(ltr_int_pose_ring_read(&a, &p));
+  REQUIRE(ltr_int_pose_ring_read(&b, &p));
+  CHECK(p.pose.counter == 1);
+  CHECK(a.dropped == 0);
+  CHECK(ring->dropped == 0);
+}
+
+TEST_CASE("Lagging pose ring reader skips ahead", "[pose_ring]") {
+  auto ring = make_ring();
+  pose_ring_reader_t r;
+  ltr_int_pose_ring_attach(&r, ring.get());
+  const uint32_t total = 3 * POSE_RING_SLOTS;
+  for (uint32_t i = 0; i < total; ++i) {
+    linuxtrack_full_pose_t p = pose_no(i);
+    ltr_int_pose_ring_publish(ring.get(), &p);
+  }
+  linuxtrack_full_pose_t p;
+  REQUIRE(ltr_int_pose_ring_read(&r, &p));
+  uint32_t first = p.pose.counter;
+  CHECK(first == total - (POSE_RING_SLOTS - 1));
+  CHECK(r.dropped == first);
+  CHECK(ring->dropped == first);
+  uint32_t last = first;
+  while (ltr_int_pose_ring_read(&r, &p)) {
+    CHECK(p.pose.counter == last + 1);
+    last = p.pose.counter;
+  }
+  CHECK(last == total - 1);
+}
+
+TEST_CASE("Pose ring wait times out and wakes", "[pose_ring]") {
+  auto ring = make_ring();
+  pose_ring_reader_t r;
+  ltr_int_pose_ring_attach(&r, ring.get());
+  CHECK_FALSE(ltr_int_pose_ring_wait(&r, 20));
+
+  std::thread writer([&ring]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    linuxtrack_full_pose_t p = pose_no(5);
+    ltr_int_pose_ring_publish(ring.get(), &p);
+  });
+  CHECK(ltr_int_pose_ring_wait(&r, 5000));
+  writer.join();
+  linuxtrack_full_pose_t p;
+  REQUIRE(ltr_int_pose_ring_read(&r, &p));
+  CHECK(p.pose.counter == 5);
+}
+
+TEST_CASE("Pose ring readers never see torn poses", "[pose_ring]") {
+  auto ring = make_ring();
+  std::atomic<bool> done(false);
+  const uint32_t total = 200000;
+  std::thread writer([&]() {
+    for (uint32_t i = 1; i <= total; ++i) {
+      linuxtrack_full_pose_t p = pose_no(i);
+      ltr_int_pose_ring_publish(ring.get(), &p);
+    }
+    done = true;
+  });
+  pose_ring_reader_t r;
+  ltr_int_pose_ring_attach(&r, ring.get());
+  uint32_t last = 0, got = 0;
+  bool ordered = true, intact = true;
+  linuxtrack_full_pose_t p;
+  while (true) {
+    bool finished = done;
+    if (!ltr_int_pose_ring_read(&r, &p)) {
+      if (finished) {
+        break;
+      }
+      continue;
+    }
+    ++got;
+    intact = intact && consistent(p);
+    ordered = ordered && (p.pose.counter > last);
+    last = p.pose.counter;
+  }
+  writer.join();
+  CHECK(intact);
+  CHECK(ordered);
+  CHECK(got > 0);
+  CHECK(got + r.dropped <= total);
+}
+
+TEST_CASE("Pose ring carries the master's filtered poses", "[pose_ring]") {
+  auto ring = make_ring();
+  pose_ring_reader_t a, b;
+  ltr_int_pose_ring_attach(&a, ring.get());
+  ltr_int_pose_ring_attach(&b, ring.get());
+  linuxtrack_full_pose_t p = pose_no(1);
+  linuxtrack_pose_t filtered[POSE_RING_PROFILES];
+  memset(filtered, 0, sizeof(filtered));
+  filtered[3] = p.pose;
+  filtered[3].yaw = 42.0f;
+  ltr_int_pose_ring_publish_filtered(ring.get(), &p, 1u << 3, filtered);
+  ltr_int_pose_ring_publish(ring.get(), &p);
+
+  bool have = false;
+  REQUIRE(ltr_int_pose_ring_read_profile(&a, 3, &p, &have));
+  CHECK(have);
+  CHECK(p.pose.yaw == 42.0f);
+  CHECK(p.blob_list[0] == 1.0f);
+  // the next pose wasn't filtered, neither are other profiles
+  REQUIRE(ltr_int_pose_ring_read_profile(&a, 3, &p, &have));
+  CHECK_FALSE(have);
+  CHECK(p.pose.yaw == 1.0f);
+  REQUIRE(ltr_int_pose_ring_read_profile(&b, 2, &p, &have));
+  CHECK_FALSE(have);
+  CHECK(p.pose.yaw == 1.0f);
+}
@@ -0,0 +1,73 @@
+// Accuracy tests and benchmark for the response curve lookup tables
+// Uses Catch2 v3 testing framework
+
+#include "../spline.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <cmath>
+
+static void build(float dz, float lc, float rc, splines &pts,
+                  spline_lut &lut) {
+  splines_def def = {dz, lc, rc};
+  ltr_int_curve2pts(&def, &pts);
+  ltr_int_spline_lut(&pts, &lut);
+}
+
+// Largest difference between the table and the analytic curve
+static float maxError(const splines &pts, const spline_lut &lut) {
+  float worst = 0.0f;
+  for (int i = -20000; i <= 20000; ++i) {
+    float x = i / 20000.0f;
+    float e = std::fabs(ltr_int_spline_lut_point(&lut, x) -
+                        ltr_int_spline_point(&pts, x));
+    worst = std::max(worst, e);
+  }
+  return worst;
+}
+
+TEST_CASE("Curve table follows the analytic curve", "[spline]") {
+  static splines pts;
+  static spline_lut lut;
+  float worst = 0.0f;
+  for (float dz = 0.0f; dz < 0.55f; dz += 0.1f) {
+    for (int i = 0; i <= 20; ++i) {
+      float c = i / 20.0f;
+      build(dz, c, 1.0f - c, pts, lut);
+      worst = std::max(worst, maxError(pts, lut));
+    }
+  }
+  // output is normalized to the axis limit, so this is 0.1% of full scale
+  CHECK(worst < 1e-3f);
+}
+
+TEST_CASE("Curve table keeps the dead zone and the end points", "[spline]") {
+  static splines pts;
+  static spline_lut lut;
+  build(0.2f, 0.7f, 0.3f, pts, lut);
+  CHECK(ltr_int_spline_lut_point(&lut, 0.0f) == 0.0f);
+  CHECK(ltr_int_spline_lut_point(&lut, 0.19f) == 0.0f);
+  CHECK(ltr_int_spline_lut_point(&lut, -0.19f) == 0.0f);
+  CHECK(ltr_int_spline_lut_point(&lut, 1.0f) == Catch::Approx(1.0f));
+  CHECK(ltr_int_spline_lut_point(&lut, -1.0f) == Catch::Approx(-1.0f));
+  CHECK(ltr_int_spline_lut_point(&lut, 0.5f) > 0.0f);
+  CHECK(ltr_int_spline_lut_point(&lut, -0.5f) < 0.0f);
+
+  // dead zone covering everything must not blow up
+  build(1.0f, 0.5f, 0.5f, pts, lut);
+  CHECK(ltr_int_spline_lut_point(&lut, 0.99f) == 0.0f);
+  CHECK(std::isfinite(ltr_int_spline_lut_point(&lut, 1.0f)));
+}
+
+TEST_CASE("Curve table speed", "[.][benchmark]") {
+  static splines pts;
+  static spline_lut lut;
+  build(0.1f, 0.8f, 0.8f, pts, lut);
+  float x = -1.0f;
+  BENCHMARK("analytic curve") {
+    x = (x > 1.0f) ? -1.0f : x + 0.001f;
+    return ltr_int_spline_point(&pts, x);
+  };
+  BENCHMARK("lookup table") {
+    x = (x > 1.0f) ? -1.0f : x + 0.001f;
+    return ltr_int_spline_lut_point(&lut, x);
+  };
+}
@@ -0,0 +1,141 @@
+// Unit tests for the stripe stream records and the runs kept by the detector
+// Uses Catch2 v3 testing framework
+
+#include "../image_process.h"
+#include "../stripe_stream.h"
+#include "catch2/catch_amalgamated.hpp"
+#include <vector>
+
+static std::vector<uint8_t> encode(uint32_t counter, int w, int h,
+                                   const std::vector<ltr_stripe_run_t> &runs,
+                                   const std::vector<ltr_stripe_blob_t> &blobs) {
+  ltr_stripe_frame_t hdr = {};
+  hdr.counter = counter;
+  hdr.timestamp = 1000 * (int64_t)counter;
+  hdr.width = w;
+  hdr.height = h;
+  hdr.num_runs = runs.size();
+  hdr.num_blobs = blobs.size();
+  std::vector<uint8_t> rec(ltr_int_stripe_frame_size(runs.size(), blobs.size()));
+  REQUIRE(ltr_int_stripe_frame_encode(rec.data(), rec.size(), &hdr,
+                                      runs.data(), blobs.data()) == rec.size());
+  return rec;
+}
+
+TEST_CASE("Stripe records decode back to the frame", "[stripe_stream]") {
+  std::vector<ltr_stripe_run_t> runs = {
+      {2, 3, 4, 200, 0}, {3, 2, 6, 180, 0}, {9, 8, 10, 255, 0}};
+  std::vector<ltr_stripe_blob_t> blobs = {{4.5f, 2.5f, 10}, {10.0f, 9.0f, 2}};
+  std::vector<uint8_t> rec = encode(7, 16, 10, runs, blobs);
+  CHECK(rec.size() ==
+        sizeof(ltr_stripe_frame_t) + 3 * sizeof(ltr_stripe_run_t) +
+            2 * sizeof(ltr_stripe_blob_t));
+
+  int w = 0, h = 0;
+  std::vector<uint8_t> img(16 * 10, 0x55);
+  CHECK(ltr_int_stripe_frame_decode(rec.data(), rec.size(), &w, &h, 10,
+                                    img.data()) == 0);
+  CHECK(w == 16);
+  CHECK(h == 10);
+  REQUIRE(ltr_int_stripe_frame_decode(rec.data(), rec.size(), &w, &h,
+                                      img.size(), img.data()) == 1);
+  int lit = 0;
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      uint8_t v = img[y * w + x];
+      if (v != 0) {
+        ++lit;
+      }
+      if ((y == 2) && (x >= 3) && (x < 7)) {
+        CHECK(v == 200);
+      }
+      if ((y == 3) && (x >= 2) && (x < 8)) {
+        CHECK(v == 180);
+      }
+    }
+  }
+  // the last run is clipped at the right edge
+  CHECK(lit == 4 + 6 + 8);
+  CHECK(img[9 * 16 + 15] == 255);
+
+  ltr_stripe_blob_t out[4];
+  REQUIRE(ltr_int_stripe_frame_blobs(rec.data(), rec.size(), out, 1) == 2);
+  CHECK(out[0].x == 4.5f);
+  CHECK(out[0].y == 2.5f);
+  CHECK(out[0].score == 10);
+
+  // short or damaged records are refused
+  CHECK(ltr_int_stripe_frame_decode(rec.data(), rec.size() - 1, &w, &h,
+                                    img.size(), img.data()) == -1);
+  rec[0] ^= 0xFF;
+  CHECK(ltr_int_stripe_frame_blobs(rec.data(), rec.size(), out, 4) == -1);
+}
+
+TEST_CASE("Stripe recordings are walked record by record", "[stripe_stream]") {
+  std::vector<uint8_t> file;
+  for (uint32_t i = 0; i < 5; ++i) {
+    std::vector<ltr_stripe_run_t> runs(i, {1, 1, 1, 99, 0});
+    std::vector<ltr_stripe_blob_t> blobs(5 - i, {1.0f, 1.0f, 1});
+    std::vector<uint8_t> rec = encode(i, 32, 24, runs, blobs);
+    file.insert(file.end(), rec.begin(), rec.end());
+  }
+  size_t pos = 0;
+  uint32_t expected = 0;
+  ltr_stripe_frame_t hdr;
+  while (ltr_int_stripe_frame_header(file.data() + pos, file.size() - pos,
+                                     &hdr)) {
+    CHECK(hdr.counter == expected);
+    CHECK(hdr.timestamp == 1000 * (int64_t)expected);
+    CHECK(hdr.num_runs == expected);
+    CHECK(hdr.num_blobs == 5 - expected);
+    pos += hdr.size;
+    ++expected;
+  }
+  CHECK(expected == 5);
+  CHECK(pos == file.size());
+}
+
+TEST_CASE("Kept runs reproduce the scanned frame", "[stripe_stream]") {
+  const int W = 320, H = 240;
+  std::vector<uint8_t> frame(W * H, 0);
+  // a run of its own intensity on every line
+  for (int y = 0; y < H; ++y) {
+    int x = (y * 37) % (W - 8);
+    for (int k = 0; k < 1 + y % 7; ++k) {
+      frame[y * W + x + k] = 40 + (y % 200);
+    }
+  }
+  ltr_int_prepare_for_processing(W, H);
+  ltr_int_keep_stripe_runs(true);
+  for (int threads : {1, 4}) {
+    ltr_int_set_processing_threads(threads);
+    std::vector<uint8_t> bmp = frame;
+    struct blob_type blobs[10];
+    struct bloblist_type bl = {10, 3, blobs};
+    image_t img = {W, H, bmp.data(), 1.0f};
+    ltr_int_to_stripes(&img);
+    ltr_int_stripes_to_blobs(10, &bl, 1, 1000, &img);
+
+    const ltr_stripe_run_t *runs;
+    bool truncated;
+    unsigned int n = ltr_int_get_stripe_runs(&runs, &truncated);
+    CHECK_FALSE(truncated);
+    REQUIRE(n > 0);
+    for (unsigned int i = 1; i < n; ++i) {
+      CHECK(runs[i - 1].y <= runs[i].y);
+    }
+    std::vector<ltr_stripe_run_t> kept(runs, runs + n);
+    std::vector<uint8_t> rec = encode(1, W, H, kept, {});
+    std::vector<uint8_t> out(W * H);
+    int w, h;
+    REQUIRE(ltr_int_stripe_frame_decode(rec.data(), rec.size(), &w, &h,
+                                        out.size(), out.data()) == 1);
+    INFO("threads " << threads);
+    CHECK(out == frame);
+  }
+  ltr_int_set_processing_threads(1);
+  ltr_int_cleanup_after_processing();
+  const ltr_stripe_run_t *runs;
+  bool truncated;
+  CHECK(ltr_int_get_stripe_runs(&runs, &truncated) == 0);
+}
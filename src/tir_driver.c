@@ -108,7 +108,7 @@ int ltr_int_tracker_get_frame(struct camera_control_block *ccb, struct frame_typ
     ltr_int_set_threshold_tir(tmp_thr);
   }
   int res = ltr_int_read_blobs_tir(&(f->bloblist), ltr_int_tir_get_min_blob(), 
-				ltr_int_tir_get_max_blob(), &img, &info);
+				ltr_int_tir_get_max_blob(), &img, &info, &(f->usec));
   *frame_acquired = true;
   return res;
 }
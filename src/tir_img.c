@@ -539,7 +539,8 @@ bool process_packet(unsigned char data[], size_t *ptr, size_t size)
 
 
 
-int ltr_int_read_blobs_tir(struct bloblist_type *blt, int min, int max, image_t *img, tir_info *info)
+int ltr_int_read_blobs_tir(struct bloblist_type *blt, int min, int max, image_t *img, tir_info *info,
+                           int64_t *capture_ts)
 {
   assert(blt != NULL);
   assert(img != NULL);
@@ -547,6 +548,8 @@ int ltr_int_read_blobs_tir(struct bloblist_type *blt, int min, int max, image_t
   p_img = img;
   static size_t size = 0;
   static size_t ptr = 0;
+  static int64_t packet_ts = 0;
+  static int64_t frame_ts = -1;
   bool have_frame = false;
   while(1){
     if(ptr >= size){
@@ -555,8 +558,15 @@ int ltr_int_read_blobs_tir(struct bloblist_type *blt, int min, int max, image_t
 	ltr_int_log_message("Problem reading data from USB!\n");
         return -1;
       }
+      packet_ts = ltr_int_get_ts();
+    }
+    if(frame_ts < 0){
+      frame_ts = packet_ts;
     }
     if((have_frame = process_packet(ltr_int_packet, &ptr, size)) == true){
+      *capture_ts = frame_ts;
+      //the rest of the packet belongs to the next frame already
+      frame_ts = (ptr < size) ? packet_ts : -1;
       break;
     }
     if(ltr_int_got_new_request()){
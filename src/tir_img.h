@@ -5,6 +5,8 @@
 #include "image_process.h"
 #include "tir_hw.h"
 
-int ltr_int_read_blobs_tir(struct bloblist_type *blt, int min, int max, image_t *img, tir_info *info);
+// capture_ts receives the completion time of the transfer the frame began in
+int ltr_int_read_blobs_tir(struct bloblist_type *blt, int min, int max, image_t *img, tir_info *info,
+                           int64_t *capture_ts);
 
 #endif
@@ -6,6 +6,7 @@
 #include "pose.h"
 #include "utils.h"
 #include "pref_global.h"
+#include "latency_trace.h"
 
 /**************************/
 /* private Static members */
@@ -339,39 +340,40 @@ static int update_pose_3pt(struct frame_type *frame)
   return 0;
 }
 
-bool ltr_int_postprocess_axes(ltr_axes_t axes, linuxtrack_pose_t *pose, linuxtrack_pose_t *unfiltered)
+static bool postprocess_axes(ltr_axes_snapshot_t snap, ltr_filter_state_t *state,
+                             linuxtrack_pose_t *pose, linuxtrack_pose_t *unfiltered)
 {
 //  printf(">>Pre: %f %f %f  %f %f %f\n", pose->raw_pitch, pose->raw_yaw, pose->raw_roll,
 //         pose->raw_tx, pose->raw_ty, pose->raw_tz);
 //  static float filterfactor=1.0;
 //  ltr_int_get_filter_factor(&filterfactor);
-  static float filtered_angles[3] = {0.0f, 0.0f, 0.0f};
-  static float filtered_translations[3] = {0.0f, 0.0f, 0.0f};
+  float *filtered_angles = state->angles;
+  float *filtered_translations = state->translations;
   //ltr_int_get_axes_ff(axes, filter_factors);
   double raw_angles[3];
 
   //Single point must be "denormalized"
 
-  raw_angles[0] = unfiltered->pitch = ltr_int_val_on_axis(axes, PITCH, pose->raw_pitch);
-  raw_angles[1] = unfiltered->yaw = ltr_int_val_on_axis(axes, YAW, pose->raw_yaw);
-  raw_angles[2] = unfiltered->roll = ltr_int_val_on_axis(axes, ROLL, pose->raw_roll);
+  raw_angles[0] = unfiltered->pitch = ltr_int_snapshot_val_on_axis(snap, PITCH, pose->raw_pitch);
+  raw_angles[1] = unfiltered->yaw = ltr_int_snapshot_val_on_axis(snap, YAW, pose->raw_yaw);
+  raw_angles[2] = unfiltered->roll = ltr_int_snapshot_val_on_axis(snap, ROLL, pose->raw_roll);
   //printf(">>Raw: %f %f %f\n", raw_angles[0], raw_angles[1], raw_angles[2]);
 
   if(!ltr_int_is_vector_finite(raw_angles)){
     return false;
   }
 
-  pose->pitch = clamp_angle(ltr_int_filter_axis(axes, PITCH, raw_angles[0], &(filtered_angles[0])));
-  pose->yaw = clamp_angle(ltr_int_filter_axis(axes, YAW, raw_angles[1], &(filtered_angles[1])));
-  pose->roll = clamp_angle(ltr_int_filter_axis(axes, ROLL, raw_angles[2], &(filtered_angles[2])));
+  pose->pitch = clamp_angle(ltr_int_snapshot_filter_axis(snap, PITCH, raw_angles[0], &(filtered_angles[0])));
+  pose->yaw = clamp_angle(ltr_int_snapshot_filter_axis(snap, YAW, raw_angles[1], &(filtered_angles[1])));
+  pose->roll = clamp_angle(ltr_int_snapshot_filter_axis(snap, ROLL, raw_angles[2], &(filtered_angles[2])));
 
   double rotated[3];
   double transform[3][3];
 
   double displacement[3];
-  displacement[0] = ltr_int_val_on_axis(axes, TX, pose->raw_tx);
-  displacement[1] = ltr_int_val_on_axis(axes, TY, pose->raw_ty);
-  displacement[2] = ltr_int_val_on_axis(axes, TZ, pose->raw_tz);
+  displacement[0] = ltr_int_snapshot_val_on_axis(snap, TX, pose->raw_tx);
+  displacement[1] = ltr_int_snapshot_val_on_axis(snap, TY, pose->raw_ty);
+  displacement[2] = ltr_int_snapshot_val_on_axis(snap, TZ, pose->raw_tz);
   if(ltr_int_do_tr_align()){
     //printf("Translations: Aligned\n");
     ltr_int_euler_to_matrix(pose->pitch / 180.0 * M_PI, pose->yaw / 180.0 * M_PI,
@@ -394,16 +396,34 @@ bool ltr_int_postprocess_axes(ltr_axes_t axes, linuxtrack_pose_t *pose, linuxtra
   }
 
   pose->tx =
-    ltr_int_filter_axis(axes, TX, unfiltered->tx, &(filtered_translations[0]));
+    ltr_int_snapshot_filter_axis(snap, TX, unfiltered->tx, &(filtered_translations[0]));
   pose->ty =
-    ltr_int_filter_axis(axes, TY, unfiltered->ty, &(filtered_translations[1]));
+    ltr_int_snapshot_filter_axis(snap, TY, unfiltered->ty, &(filtered_translations[1]));
   pose->tz =
-    ltr_int_filter_axis(axes, TZ, unfiltered->tz, &(filtered_translations[2]));
+    ltr_int_snapshot_filter_axis(snap, TZ, unfiltered->tz, &(filtered_translations[2]));
   //printf(">>Post: %f %f %f  %f %f %f\n", pose->pitch, pose->yaw, pose->roll, pose->tx, pose->ty, pose->tz);
   return true;
 }
 
 
+bool ltr_int_postprocess_axes_state(ltr_axes_t axes, ltr_filter_state_t *state,
+                                    linuxtrack_pose_t *pose, linuxtrack_pose_t *unfiltered)
+{
+  //one consistent view of the axes for the whole pose, without locking
+  unsigned int ticket;
+  ltr_axes_snapshot_t snap = ltr_int_axes_snapshot_get(axes, &ticket);
+  bool res = postprocess_axes(snap, state, pose, unfiltered);
+  ltr_int_axes_snapshot_put(axes, ticket);
+  return res;
+}
+
+bool ltr_int_postprocess_axes(ltr_axes_t axes, linuxtrack_pose_t *pose, linuxtrack_pose_t *unfiltered)
+{
+  static ltr_filter_state_t state;
+  return ltr_int_postprocess_axes_state(axes, &state, pose, unfiltered);
+}
+
+
 static uint32_t counter_d = 0;
 
 int ltr_int_update_pose(struct frame_type *frame)
@@ -415,7 +435,7 @@ int ltr_int_update_pose(struct frame_type *frame)
   }
   unsigned int i;
   ltr_int_remove_camera_rotation(frame->bloblist);
-  ltr_int_pose_sort_blobs(frame->bloblist);
+  ltr_int_pose_match_blobs(&(frame->bloblist));
   pthread_mutex_lock(&pose_mutex);
   current_pose.pose.resolution_x = frame->width;
   current_pose.pose.resolution_y = frame->height;
@@ -448,6 +468,7 @@ int ltr_int_update_pose(struct frame_type *frame)
       res = -1;
     }
   }
+  ltr_int_trace_point(LTR_TRACE_UPDATE_POSE, frame->usec);
   return res;
 }
 
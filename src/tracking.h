@@ -27,6 +27,17 @@ int ltr_int_update_pose(struct frame_type *frame);
 int ltr_int_recenter_tracking();
 int ltr_int_tracking_get_pose(linuxtrack_full_pose_t *pose);
 bool ltr_int_postprocess_axes(ltr_axes_t axes, linuxtrack_pose_t *pose, linuxtrack_pose_t *unfiltered);
+
+//Filter memory of one postprocessing stream (zeroed to start)
+typedef struct{
+  float angles[3];
+  float translations[3];
+} ltr_filter_state_t;
+
+//Same as above, but keeping the filter memory in the state given, so
+//  one process can postprocess several profiles
+bool ltr_int_postprocess_axes_state(ltr_axes_t axes, ltr_filter_state_t *state,
+                                    linuxtrack_pose_t *pose, linuxtrack_pose_t *unfiltered);
 /*
 double ltr_int_nonlinfilt(double x, 
               double y_minus_1,
@@ -10,6 +10,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -413,24 +414,44 @@ void ltr_int_check_root() {
 }
 
 // Used to get timestamp with ~us precision;
-//  Overflows every 1024 seconds!
-static const int c_MAX_SEC = 1024;
-int ltr_int_get_ts() {
+//  microseconds of CLOCK_MONOTONIC, the clock V4L2 stamps buffers with.
+int64_t ltr_int_get_ts() {
   struct timespec t;
-  int usecs;
   clock_gettime(CLOCK_MONOTONIC, &t);
+  return ltr_int_make_ts(t.tv_sec, t.tv_nsec / 1000);
+}
+
+// Converts a CLOCK_MONOTONIC time to the timestamp format above
+int64_t ltr_int_make_ts(long sec, long usec) {
+  return (int64_t)sec * 1000000 + usec;
+}
+
+static const int64_t c_LEGACY_TS_WRAP = 1024 * (int64_t)1000000;
 
-  usecs = (t.tv_sec & (c_MAX_SEC - 1)) * 1000000 + (t.tv_nsec / 1000);
-  return usecs;
+// Converts a timestamp to the 32bit format of older releases, wrapping
+//  every 1024s; their clients still read it from the client channel.
+int ltr_int_legacy_ts(int64_t ts) {
+  return (int)(ts % c_LEGACY_TS_WRAP);
 }
 
-// Returns difference between two timestamps in us.
-//  Takes care of possible timestamp overflow.
-//  Return value is invalid if the difference is larger than 1024 seconds.
-int ltr_int_ts_diff(int ts1, int ts2) {
-  int d = ts2 - ts1;
-  if (d < 0) {
-    d += c_MAX_SEC * 1000000;
+// Expands a 32bit timestamp taken less than 1024s before now
+int64_t ltr_int_unwrap_legacy_ts(int ts, int64_t now) {
+  int64_t age = (ltr_int_legacy_ts(now) - (int64_t)ts) % c_LEGACY_TS_WRAP;
+  if (age < 0) {
+    age += c_LEGACY_TS_WRAP;
+  }
+  return now - age;
+}
+
+// Returns difference between two timestamps in us,
+//  saturated to the int range.
+int ltr_int_ts_diff(int64_t ts1, int64_t ts2) {
+  int64_t d = ts2 - ts1;
+  if (d > INT_MAX) {
+    return INT_MAX;
+  }
+  if (d < INT_MIN) {
+    return INT_MIN;
   }
-  return d;
+  return (int)d;
 }
@@ -6,6 +6,7 @@
 #endif
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -40,8 +41,11 @@ typedef enum { DBG_CHECK, DBG_ON, DBG_OFF } dbg_flag_type;
 dbg_flag_type ltr_int_get_dbg_flag(const int flag);
 void ltr_int_usleep(unsigned int usec);
 void ltr_int_check_root();
-int ltr_int_get_ts();
-int ltr_int_ts_diff(int ts1, int ts2);
+int64_t ltr_int_get_ts();
+int64_t ltr_int_make_ts(long sec, long usec);
+int ltr_int_ts_diff(int64_t ts1, int64_t ts2);
+int ltr_int_legacy_ts(int64_t ts);
+int64_t ltr_int_unwrap_legacy_ts(int ts, int64_t now);
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,10 @@ static bool flip = false;
 static char *cascade = NULL;
 static float exp_filt = 0.1;
 static int optim_level = 0;
+static bool roi = false;
+static int roi_padding = 16;
+static int roi_interval = 30;
+static int proc_threads = 1;
 
 static char max_blob_key[] = "Max-blob";
 static char min_blob_key[] = "Min-blob";
@@ -33,6 +37,10 @@ static char flip_key[] = "Upside-down";
 static char cascade_key[] = "Cascade";
 static char exp_filter_key[] = "Exp-filter-factor";
 static char optim_key[] = "Optimization-level";
+static char roi_key[] = "Roi-tracking";
+static char roi_padding_key[] = "Roi-padding";
+static char roi_interval_key[] = "Roi-full-scan-interval";
+static char proc_threads_key[] = "Processing-threads";
 
 bool ltr_int_wc_init_prefs()
 {
@@ -97,6 +105,22 @@ bool ltr_int_wc_init_prefs()
   if(!ltr_int_get_key_int(dev, optim_key, &optim_level)){
     optim_level= 0;
   }
+  tmp = ltr_int_get_key(dev, roi_key);
+  if(tmp != NULL){
+    roi = (strcasecmp(tmp, "Yes") == 0) ? true : false;
+    free(tmp);
+  }else{
+    roi = false;
+  }
+  if(!ltr_int_get_key_int(dev, roi_padding_key, &roi_padding)){
+    roi_padding = 16;
+  }
+  if(!ltr_int_get_key_int(dev, roi_interval_key, &roi_interval)){
+    roi_interval = 30;
+  }
+  if(!ltr_int_get_key_int(dev, proc_threads_key, &proc_threads)){
+    proc_threads = 1;
+  }
   free(dev);
   return true;
 }
@@ -277,3 +301,59 @@ bool ltr_int_wc_set_optim_level(int opt)
   return ltr_int_change_key_int(ltr_int_get_device_section(), optim_key, opt);
 }
 
+
+bool ltr_int_wc_get_roi()
+{
+  return roi;
+}
+
+bool ltr_int_wc_set_roi(bool new_roi)
+{
+  char yes[] = "Yes";
+  char no[] = "No";
+  char *val = (new_roi) ? yes : no;
+  roi = new_roi;
+  return ltr_int_change_key(ltr_int_get_device_section(), roi_key, val);
+}
+
+int ltr_int_wc_get_roi_padding()
+{
+  return roi_padding;
+}
+
+bool ltr_int_wc_set_roi_padding(int val)
+{
+  if(val < 1){
+    val = 1;
+  }
+  roi_padding = val;
+  return ltr_int_change_key_int(ltr_int_get_device_section(), roi_padding_key, val);
+}
+
+int ltr_int_wc_get_roi_interval()
+{
+  return roi_interval;
+}
+
+bool ltr_int_wc_set_roi_interval(int val)
+{
+  if(val < 1){
+    val = 1;
+  }
+  roi_interval = val;
+  return ltr_int_change_key_int(ltr_int_get_device_section(), roi_interval_key, val);
+}
+
+int ltr_int_wc_get_processing_threads()
+{
+  return proc_threads;
+}
+
+bool ltr_int_wc_set_processing_threads(int val)
+{
+  if(val < 1){
+    val = 1;
+  }
+  proc_threads = val;
+  return ltr_int_change_key_int(ltr_int_get_device_section(), proc_threads_key, val);
+}
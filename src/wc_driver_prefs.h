@@ -42,6 +42,18 @@ bool ltr_int_wc_set_eff(float new_eff);
 int ltr_int_wc_get_optim_level();
 bool ltr_int_wc_set_optim_level(int opt);
 
+bool ltr_int_wc_get_roi();
+bool ltr_int_wc_set_roi(bool new_roi);
+
+int ltr_int_wc_get_roi_padding();
+bool ltr_int_wc_set_roi_padding(int val);
+
+int ltr_int_wc_get_roi_interval();
+bool ltr_int_wc_set_roi_interval(int val);
+
+int ltr_int_wc_get_processing_threads();
+bool ltr_int_wc_set_processing_threads(int val);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,8 +3,11 @@
 #include <stdio.h>
 #undef _GNU_SOURCE
 
+#include "image_convert.h"
+#include "latency_trace.h"
 #include "pref.h"
 #include "pref_global.h"
+#include "replay_driver.h"
 #include "runloop.h"
 #include "utils.h"
 #include "wc_driver_prefs.h"
@@ -15,6 +18,7 @@
 #include <fcntl.h>
 #include <linux/videodev2.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -45,11 +49,19 @@ typedef struct {
   int w;
   int h;
   unsigned char *bw_frame;
+  unsigned char *row_buf;
   unsigned int threshold;
   int min_blob_pixels;
   int max_blob_pixels;
   __u32 fourcc;
+  size_t frame_size;         // sizeimage of the capture format
+  enum v4l2_memory memory; // MMAP, or USERPTR when the device takes it
   bool flip;
+  const ltr_int_bw_kernels_t *kernels;
+  dbg_flag_type record; // dump raw luma frames for the replay driver
+  FILE *record_idx;
+  unsigned char *record_buf;
+  unsigned int recorded;
 } webcam_info;
 
 static webcam_info wc_info;
@@ -436,7 +448,11 @@ static bool set_capture_format(struct camera_control_block *ccb) {
   }
   ccb->pixel_width = wc_info.w = fmt.fmt.pix.width;
   ccb->pixel_height = wc_info.h = fmt.fmt.pix.height;
+  wc_info.frame_size = fmt.fmt.pix.sizeimage;
+  free(wc_info.bw_frame);
+  free(wc_info.row_buf);
   wc_info.bw_frame = (unsigned char *)ltr_int_my_malloc(wc_info.w * wc_info.h);
+  wc_info.row_buf = (unsigned char *)ltr_int_my_malloc(wc_info.w);
   ltr_int_log_message("Switch of the format successfull!\n");
   return true;
 }
@@ -464,22 +480,66 @@ static bool set_stream_params() {
 }
 
 /*
- * Sends request to driver for mmap-able buffers
+ * Unmaps (or frees) streaming buffers...
+ *
+ * Returns TRUE on success, FALSE otherwise
+ */
+static bool release_buffers() {
+  if (NULL == buffers) {
+    ltr_int_log_message("Trying to release already released buffers...\n");
+    return false;
+  }
+  if (wc_info.memory == V4L2_MEMORY_USERPTR) {
+    // the driver keeps the pages of queued buffers pinned and could still
+    //   capture into them; take them all back before freeing
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (-1 == v4l2_ioctl(wc_info.fd, VIDIOC_STREAMOFF, &type)) {
+      ltr_int_log_message("Problem stopping streaming!\n");
+    }
+    struct v4l2_requestbuffers reqb;
+    memset(&reqb, 0, sizeof(reqb));
+    reqb.count = 0;
+    reqb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    reqb.memory = V4L2_MEMORY_USERPTR;
+    if (0 != v4l2_ioctl(wc_info.fd, VIDIOC_REQBUFS, &reqb)) {
+      ltr_int_log_message("Couldn't release streaming buffers! (%s)\n",
+                          strerror(errno));
+    }
+  }
+  unsigned int cntr;
+  for (cntr = 0; cntr < wc_info.buffers; ++cntr) {
+    if (wc_info.memory == V4L2_MEMORY_USERPTR) {
+      free(buffers[cntr].start);
+    } else if ((buffers[cntr].start != NULL) &&
+               (-1 == v4l2_munmap(buffers[cntr].start, buffers[cntr].length))) {
+      ltr_int_log_message("Munmap failed!\n");
+    }
+  }
+  free(buffers);
+  buffers = NULL;
+  ltr_int_log_message("Buffers unmapped!\n");
+  return true;
+}
+
+/*
+ * Sends request to driver for streaming buffers of given type
  * Uses constant NUM_OF_BUFFERS
  *
  * Returns number of buffers granted
  */
-static int request_streaming_buffers() {
+static int request_streaming_buffers(enum v4l2_memory memory) {
   struct v4l2_requestbuffers reqb;
   memset(&reqb, 0, sizeof(reqb));
   reqb.count = NUM_OF_BUFFERS;
   reqb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  reqb.memory = V4L2_MEMORY_MMAP;
+  reqb.memory = memory;
 
   // request buffers from driver
   if (0 != v4l2_ioctl(wc_info.fd, VIDIOC_REQBUFS, &reqb)) {
-    ltr_int_log_message("Couldn't get streaming buffers! (%s)\n",
-                        strerror(errno));
+    if (memory == V4L2_MEMORY_MMAP) {
+      ltr_int_log_message("Couldn't get streaming buffers! (%s)\n",
+                          strerror(errno));
+    }
     return 0;
   }
   if (reqb.count < NUM_OF_BUFFERS) {
@@ -492,14 +552,54 @@ static int request_streaming_buffers() {
 }
 
 /*
- * Prepares buffers for streaming (mmaps them and allocs
- * space for output BW frames)
+ * Allocates page aligned buffers the device captures into directly;
+ * frames are then processed where they land, without any mmap.
+ *
+ * Returns TRUE on success, FALSE if the device can't do USERPTR
+ */
+static bool setup_userptr_buffers() {
+  if (wc_info.frame_size == 0) {
+    return false;
+  }
+  wc_info.buffers = request_streaming_buffers(V4L2_MEMORY_USERPTR);
+  if (0 == wc_info.buffers) {
+    return false;
+  }
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t length = (wc_info.frame_size + page - 1) & ~(page - 1);
+  wc_info.memory = V4L2_MEMORY_USERPTR;
+  buffers = ltr_int_my_malloc(wc_info.buffers * sizeof(mmap_buffer));
+  memset(buffers, 0, sizeof(mmap_buffer) * wc_info.buffers);
+
+  unsigned int cntr;
+  for (cntr = 0; cntr < wc_info.buffers; ++cntr) {
+    if (posix_memalign(&(buffers[cntr].start), page, length) != 0) {
+      ltr_int_log_message("Can't allocate capture buffer!\n");
+      return false;
+    }
+    buffers[cntr].length = length;
+  }
+  ltr_int_log_message("Userptr setup successfull!\n");
+  return true;
+}
+
+/*
+ * Prepares buffers for streaming (user allocated where the device
+ * supports it, mmaps them otherwise)
  *
  * Returns TRUE on success, FALSE otherwise
  */
 static bool setup_streaming_buffers() {
   ltr_int_log_message("Setting up buffers for streaming...\n");
-  wc_info.buffers = request_streaming_buffers();
+  if (setup_userptr_buffers()) {
+    return true;
+  }
+  if (buffers != NULL) {
+    // partially allocated userptr buffers
+    release_buffers();
+  }
+  wc_info.memory = V4L2_MEMORY_MMAP;
+  wc_info.buffers = request_streaming_buffers(V4L2_MEMORY_MMAP);
   if (0 == wc_info.buffers) {
     ltr_int_log_message("Request for buffers failed...\n");
     return false;
@@ -535,28 +635,6 @@ static bool setup_streaming_buffers() {
   return true;
 }
 
-/*
- * Unmaps and frees streaming buffers...
- *
- * Returns TRUE on success, FALSE otherwise
- */
-static bool release_buffers() {
-  if (NULL == buffers) {
-    ltr_int_log_message("Trying to release already released buffers...\n");
-    return false;
-  }
-  unsigned int cntr;
-  for (cntr = 0; cntr < wc_info.buffers; ++cntr) {
-    if (-1 == v4l2_munmap(buffers[cntr].start, buffers[cntr].length)) {
-      ltr_int_log_message("Munmap failed!\n");
-    }
-  }
-  free(buffers);
-  buffers = NULL;
-  ltr_int_log_message("Buffers unmapped!\n");
-  return true;
-}
-
 static bool read_img_processing_prefs() {
 #ifdef OPENCV
   wc_info.threshold = 0;
@@ -566,6 +644,11 @@ static bool read_img_processing_prefs() {
   wc_info.min_blob_pixels = ltr_int_wc_get_min_blob();
   wc_info.max_blob_pixels = ltr_int_wc_get_max_blob();
   wc_info.flip = ltr_int_wc_get_flip();
+#ifndef OPENCV
+  ltr_int_set_roi(ltr_int_wc_get_roi(), ltr_int_wc_get_roi_padding(),
+                  ltr_int_wc_get_roi_interval());
+  ltr_int_set_processing_threads(ltr_int_wc_get_processing_threads());
+#endif
   return true;
 }
 
@@ -584,6 +667,11 @@ int ltr_int_tracker_init(struct camera_control_block *ccb) {
   }
   wc_info.fd = fd;
   wc_info.expecting_blobs = MAX_BLOBS;
+  wc_info.kernels = ltr_int_bw_select_kernels();
+  ltr_int_log_message("Using %s frame conversion kernels.\n",
+                      wc_info.kernels->name);
+  wc_info.record = ltr_int_get_dbg_flag('c');
+  wc_info.recorded = 0;
 
   if (set_capture_format(ccb) != true) {
     ltr_int_log_message("Couldn't set capture format!\n");
@@ -626,6 +714,16 @@ int ltr_int_tracker_close() {
   ltr_int_log_message("Webcam shutting down!\n");
   release_buffers();
   free(wc_info.bw_frame);
+  free(wc_info.row_buf);
+  wc_info.bw_frame = NULL;
+  wc_info.row_buf = NULL;
+  if (wc_info.record_idx != NULL) {
+    ltr_int_log_message("Recorded %u frames.\n", wc_info.recorded);
+    fclose(wc_info.record_idx);
+    wc_info.record_idx = NULL;
+  }
+  free(wc_info.record_buf);
+  wc_info.record_buf = NULL;
   v4l2_close(wc_info.fd);
 #ifdef OPENCV
   ltr_int_stop_face_detect();
@@ -645,8 +743,12 @@ int ltr_int_tracker_resume() {
     memset(&buf, 0, sizeof(buf));
 
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = wc_info.memory;
     buf.index = cntr;
+    if (wc_info.memory == V4L2_MEMORY_USERPTR) {
+      buf.m.userptr = (unsigned long)buffers[cntr].start;
+      buf.length = buffers[cntr].length;
+    }
 
     if (0 != v4l2_ioctl(wc_info.fd, VIDIOC_QBUF, &buf)) {
       ltr_int_log_message("Queuing of buffer failed...\n");
@@ -672,62 +774,115 @@ int ltr_int_tracker_pause() {
   return 0;
 }
 
-static void get_bw_image(unsigned char *source_buf, unsigned char *dest_buf,
-                         unsigned int bytes_used) {
-  unsigned int cntr, cntr1;
+static size_t frame_pixels(unsigned int bytes_used, unsigned int bpp) {
+  size_t pixels = (size_t)wc_info.w * wc_info.h;
+  return (bytes_used / bpp < pixels) ? bytes_used / bpp : pixels;
+}
+
+// Picks the conversion kernel for the current format; bpp is source bytes
+//   per pixel, pixels the number of pixels the frame really contains.
+static bool select_bw_kernel(unsigned int bytes_used, ltr_int_bw_kernel_t *kernel,
+                             size_t *bpp, size_t *pixels) {
+  const ltr_int_bw_kernels_t *k = wc_info.kernels;
 
   if (wc_info.fourcc == *(__u32 *)"YUYV") {
-    for (cntr = cntr1 = 0; cntr < bytes_used; cntr += 2, ++cntr1) {
-      if (source_buf[cntr] > wc_info.threshold) {
-        dest_buf[cntr1] = source_buf[cntr];
-      } else {
-        dest_buf[cntr1] = 0;
-      }
-    }
+    *kernel = k->yuyv;
+    *bpp = 2;
   } else if ((wc_info.fourcc == *(__u32 *)"YU12") ||
-             (wc_info.fourcc == *(__u32 *)"YV12")) {
-    for (cntr = 0; cntr < (unsigned int)wc_info.w * wc_info.h; ++cntr) {
-      if (source_buf[cntr] > wc_info.threshold) {
-        dest_buf[cntr] = source_buf[cntr];
-      } else {
-        dest_buf[cntr] = 0;
-      }
-    }
+             (wc_info.fourcc == *(__u32 *)"YV12") ||
+             (wc_info.fourcc == *(__u32 *)"GREY")) {
+    // only the luma plane is used
+    *kernel = k->luma;
+    *bpp = 1;
+    *pixels = (size_t)wc_info.w * wc_info.h;
+    return true;
   } else if (wc_info.fourcc == *(__u32 *)"RGB3") {
-    float y;
-    for (cntr = cntr1 = 0; cntr < bytes_used; cntr += 3, ++cntr1) {
-      // Y  =      (0.257 * R) + (0.504 * G) + (0.098 * B) + 16
-      y = 0.257 * ((float)source_buf[cntr]) +
-          0.504 * ((float)source_buf[cntr + 1]) +
-          0.098 * ((float)source_buf[cntr + 2]) + 16;
-      if (y > 255)
-        y = 255.0;
-      if (y > wc_info.threshold) {
-        dest_buf[cntr1] = y;
-      } else {
-        dest_buf[cntr1] = 0;
-      }
-    }
+    *kernel = k->rgb;
+    *bpp = 3;
   } else if (wc_info.fourcc == *(__u32 *)"BGR3") {
-    float y;
-    for (cntr = cntr1 = 0; cntr < bytes_used; cntr += 3, ++cntr1) {
-      // Y  =      (0.257 * R) + (0.504 * G) + (0.098 * B) + 16
-      y = 0.257 * ((float)source_buf[cntr + 2]) +
-          0.504 * ((float)source_buf[cntr + 1]) +
-          0.098 * ((float)source_buf[cntr + 0]) + 16;
-      if (y > 255)
-        y = 255.0;
-      if (y > wc_info.threshold) {
-        dest_buf[cntr1] = y;
-      } else {
-        dest_buf[cntr1] = 0;
-      }
-    }
+    *kernel = k->bgr;
+    *bpp = 3;
   } else {
-    for (cntr = 0; cntr < (unsigned int)wc_info.w * wc_info.h; ++cntr) {
-      dest_buf[cntr] = 0;
+    return false;
+  }
+  *pixels = frame_pixels(bytes_used, *bpp);
+  return true;
+}
+
+#ifdef OPENCV
+static void get_bw_image(unsigned char *source_buf, unsigned char *dest_buf,
+                         unsigned int bytes_used) {
+  ltr_int_bw_kernel_t kernel;
+  size_t bpp, pixels;
+
+  if (select_bw_kernel(bytes_used, &kernel, &bpp, &pixels)) {
+    kernel(source_buf, dest_buf, pixels, wc_info.threshold);
+  } else {
+    memset(dest_buf, 0, (size_t)wc_info.w * wc_info.h);
+  }
+}
+#else
+// Thresholds the frame row by row straight into the blob detector; when
+//   nobody looks at the frame, no full bitmap is written at all.
+static void bw_rows_to_stripes(const unsigned char *source_buf,
+                               unsigned int bytes_used, image_t *img) {
+  ltr_int_bw_kernel_t kernel;
+  size_t bpp, pixels;
+
+  if (!select_bw_kernel(bytes_used, &kernel, &bpp, &pixels)) {
+    if (img->bitmap != NULL) {
+      memset(img->bitmap, 0, (size_t)wc_info.w * wc_info.h);
     }
+    return;
+  }
+  if ((bpp == 1) && (img->bitmap == NULL)) {
+    // luma plane - threshold it right in the dequeued buffer
+    kernel = NULL;
   }
+  ltr_int_scan_frame(source_buf, (size_t)wc_info.w * bpp, bpp,
+                     pixels / wc_info.w, kernel, wc_info.threshold,
+                     wc_info.row_buf, img);
+}
+#endif
+
+// Saves the frame as a luma plane the replay driver can feed back later
+static void record_frame(const unsigned char *source_buf,
+                         unsigned int bytes_used, int64_t usec) {
+  ltr_int_bw_kernel_t kernel;
+  size_t bpp, pixels;
+  if (!select_bw_kernel(bytes_used, &kernel, &bpp, &pixels)) {
+    return;
+  }
+  if (wc_info.record_idx == NULL) {
+    wc_info.record_idx = fopen(REPLAY_INDEX, "w");
+    if (wc_info.record_idx == NULL) {
+      ltr_int_log_message("Can't create %s, not recording!\n", REPLAY_INDEX);
+      wc_info.record = DBG_OFF;
+      return;
+    }
+    wc_info.record_buf =
+        (unsigned char *)ltr_int_my_malloc((size_t)wc_info.w * wc_info.h);
+  }
+  memset(wc_info.record_buf, 0, (size_t)wc_info.w * wc_info.h);
+  kernel(source_buf, wc_info.record_buf, pixels, 0);
+  char name[] = "rXXXXXXX.data";
+  snprintf(name, sizeof(name), "r%07u.data", wc_info.recorded++ % 10000000);
+  FILE *f = fopen(name, "wb");
+  if (f != NULL) {
+    fwrite(wc_info.record_buf, 1, (size_t)wc_info.w * wc_info.h, f);
+    fclose(f);
+    fprintf(wc_info.record_idx, "%s %d %d %lld\n", name, wc_info.w, wc_info.h,
+            (long long)usec);
+  }
+}
+
+// Capture time of the buffer, if the driver stamps it with the same clock
+static int64_t buffer_ts(const struct v4l2_buffer *buf) {
+  if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+      V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    return ltr_int_make_ts(buf->timestamp.tv_sec, buf->timestamp.tv_usec);
+  }
+  return ltr_int_get_ts();
 }
 
 int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
@@ -740,7 +895,7 @@ int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
   struct v4l2_buffer buf;
   memset(&buf, 0, sizeof(buf));
   buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  buf.memory = V4L2_MEMORY_MMAP;
+  buf.memory = wc_info.memory;
 
   int res;
   struct pollfd pfd = {
@@ -782,18 +937,30 @@ int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
     }
   }
   assert(buf.index < wc_info.buffers);
+  f->usec = buffer_ts(&buf);
+  ltr_int_trace_point(LTR_TRACE_DEQUEUE, f->usec);
 
   unsigned char *source_buf = (buffers[buf.index]).start;
-  unsigned char *dest_buf = (f->bitmap != NULL) ? f->bitmap : wc_info.bw_frame;
-  get_bw_image(source_buf, dest_buf, buf.bytesused);
+  if (wc_info.record == DBG_ON) {
+    record_frame(source_buf, buf.bytesused, f->usec);
+  }
+  image_t img = {
+      .bitmap = f->bitmap, .w = wc_info.w, .h = wc_info.h, .ratio = 1.0f};
+#ifndef OPENCV
+  bw_rows_to_stripes(source_buf, buf.bytesused, &img);
+#else
+  if (img.bitmap == NULL) {
+    img.bitmap = wc_info.bw_frame;
+  }
+  get_bw_image(source_buf, img.bitmap, buf.bytesused);
+#endif
+  ltr_int_trace_point(LTR_TRACE_THRESHOLD, f->usec);
   // ltr_int_log_message("%d points found!\n", pts);
 
   if (-1 == v4l2_ioctl(wc_info.fd, VIDIOC_QBUF, &buf)) {
     ltr_int_log_message("Error queuing buffer!\n");
   }
   // ltr_int_log_message("Queued buffer %d\n", buf.index);
-  image_t img = {
-      .bitmap = dest_buf, .w = wc_info.w, .h = wc_info.h, .ratio = 1.0f};
 
 #ifdef DEBUG
   // Save sequence of frames
@@ -803,14 +970,13 @@ int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
   ++frm_cntr;
   fprintf(stderr, "%s\n", fname);
   FILE *ff;
-  if ((ff = fopen(fname, "wb")) != NULL) {
-    fwrite(dest_buf, 1, wc_info.w * wc_info.h, ff);
+  if ((img.bitmap != NULL) && ((ff = fopen(fname, "wb")) != NULL)) {
+    fwrite(img.bitmap, 1, wc_info.w * wc_info.h, ff);
     fclose(ff);
   }
 #endif
 
 #ifndef OPENCV
-  ltr_int_to_stripes(&img);
   ltr_int_stripes_to_blobs(MAX_BLOBS, &(f->bloblist), wc_info.min_blob_pixels,
                            wc_info.max_blob_pixels, &img);
   if (wc_info.flip) {
@@ -823,6 +989,7 @@ int ltr_int_tracker_get_frame(struct camera_control_block *ccb,
 #else
   ltr_int_face_detect(&img, &(f->bloblist));
 #endif
+  ltr_int_trace_point(LTR_TRACE_BLOBS, f->usec);
   *frame_acquired = true;
   return 0;
 }